@@ -2,12 +2,24 @@
 
 #include <BASIS/types.h>
 #include <BASIS/buffer.h>
+#include <BASIS/camera.h>
+#include <BASIS/lod.h>
 #include <BASIS/manager.h>
+#include <BASIS/meshlet.h>
 #include <BASIS/texture.h>
 #include <BASIS/context.h>
+#include <BASIS/command_list.h>
+#include <BASIS/culling.h>
+#include <BASIS/draw_culler.h>
+#include <BASIS/gpu_memory.h>
+#include <BASIS/hiz.h>
 #include <BASIS/pipeline.h>
+#include <BASIS/profiler.h>
 #include <BASIS/exception.h>
 #include <BASIS/rendering.h>
+#include <BASIS/scene_graph.h>
+#include <BASIS/software_occlusion.h>
+#include <BASIS/upload_ring.h>
 
 /* TODO
  * - custom JSON configuration files(simdjson)
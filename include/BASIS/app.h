@@ -2,6 +2,7 @@
 #include <BASIS/BASIS.h>
 
 #include <cstdint>
+#include <optional>
 #include <string_view>
 
 #include <glm/fwd.hpp>
@@ -14,19 +15,6 @@
 namespace BASIS
 {
 
-struct Camera
-{
-	float sens{0.0025f};
-	float speed{9.f};
-	glm::vec3 pos{};
-	
-	glm::mat4 view() const;
-	glm::vec3 forward() const;
-
-	float pitch{};
-	float yaw{};   
-};
-
 enum AppFlags : std::uint8_t
 {
 	SRGB = 1 << 0,
@@ -35,7 +23,10 @@ enum AppFlags : std::uint8_t
 	UNDECORATED = 1 << 3,
 	TRANSPARENT = 1 << 4,
 	UNRESIZABLE = 1 << 5,
-	NO_VSYNC = 1 << 6
+	NO_VSYNC = 1 << 6,
+	// no window, surfaceless EGL context rendering into offscreenFramebuffer()
+	// works without display and gpu(Mesa llvmpipe), needs EGL found by BASIS_EGL build option
+	HEADLESS = 1 << 7
 };
 struct AppCreateInfo
 {
@@ -43,6 +34,8 @@ struct AppCreateInfo
 	std::uint32_t width{};
 	std::uint32_t height{};
 	std::uint8_t flags{};
+	// run() returns after that many frames, 0 - until window is closed or requestClose()
+	std::uint64_t frameLimit{};
 };
 struct App
 {
@@ -55,6 +48,12 @@ struct App
 	static std::string loadFile(std::string_view p);
 	
 	void run();
+	// run() returns after current frame
+	void requestClose() noexcept { m_closeRequested = true; }
+	
+	bool headless() const noexcept { return m_win == nullptr; }
+	// bound by Renderer::bindDefaultFramebuffer() in headless mode, nullptr otherwise
+	const Framebuffer* offscreenFramebuffer() const noexcept { return m_offscreen ? &*m_offscreen : nullptr; }
 	
 	virtual ~App();
 	protected:
@@ -62,7 +61,14 @@ struct App
 	virtual void gui([[maybe_unused]]double delta) {}
 	virtual void updateCamera([[maybe_unused]]double delta);
 	GLFWwindow* m_win{};
+	// EGLDisplay and EGLContext of headless mode
+	void* m_eglDisplay{};
+	void* m_eglContext{};
+	std::optional<Framebuffer> m_offscreen;
+	std::uint64_t m_frameLimit{};
+	bool m_closeRequested{false};
 	bool active{true};
+	bool m_showProfiler{false}; // F1
 	std::uint32_t m_width{};
 	std::uint32_t m_height{};
 	Camera  m_camera{};
@@ -36,13 +36,16 @@ struct Buffer : public IGLObject
 	explicit Buffer(ByteSpan data,std::uint32_t flags,std::string_view name="");
 	explicit Buffer(std::size_t size,std::uint32_t flags,std::string_view name="");
 	
-	void update(ByteSpan,std::size_t offs = 0) noexcept;
+	// update(), map(), fill() and invalidate() flush pending batched draws first, see Renderer::setDrawBatching()
+	void update(ByteSpan,std::size_t offs = 0);
 	
-	void* map(AccessFlags flags) noexcept;
+	void* map(AccessFlags flags);
+	// maps whole buffer for its lifetime with READ/WRITE/PERSISTENT/COHERENT bits it was created with
+	void* mapPersistent() noexcept;
 	void unmap() noexcept;
 	
-	void fill(std::uint32_t value,std::size_t offset = 0,std::size_t size = WHOLE_BUFFER) noexcept;
-	void invalidate(std::size_t offset = 0,std::size_t size = WHOLE_BUFFER) noexcept;
+	void fill(std::uint32_t value,std::size_t offset = 0,std::size_t size = WHOLE_BUFFER);
+	void invalidate(std::size_t offset = 0,std::size_t size = WHOLE_BUFFER);
 	~Buffer();
 	size_t size() const noexcept { return m_size; }
 	void* mappedMem() const noexcept { return m_mappedMem; }
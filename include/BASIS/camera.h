@@ -0,0 +1,25 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+namespace BASIS
+{
+struct Camera
+{
+	float sens{0.0025f};
+	float speed{9.f};
+	glm::vec3 pos{};
+	
+	glm::mat4 view() const;
+	glm::vec3 forward() const;
+	glm::mat4 projection(float aspect) const;
+
+	float pitch{};
+	float yaw{};   
+
+	float fov{1.0471976f}; // vertical, radians
+	float zNear{0.1f};
+	float zFar{1000.f};
+};
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <BASIS/types.h>
+#include <BASIS/manager.h>
+
+#include <vector>
+#include <cstdint>
+
+namespace BASIS
+{
+struct Buffer;
+struct Pipeline;
+struct Renderer;
+
+// 64 bit sort keys, packets are executed in ascending key order
+// opaque:		layer 8 | pipeline 16 | material 16 | depth 24(front to back)
+// translucent:	layer 8 | depth 24(back to front) | pipeline 16 | material 16
+// pipeline is GL program id, depth is normalized view depth [0,1]
+std::uint64_t opaqueSortKey(std::uint8_t layer,const Pipeline& pipeline,std::uint16_t material,float depth);
+std::uint64_t translucentSortKey(std::uint8_t layer,const Pipeline& pipeline,std::uint16_t material,float depth);
+
+// one indexed draw and everything it binds
+struct DrawPacket
+{
+	std::uint64_t key{};
+	const Pipeline* pipeline{};
+	const Buffer* vertexBuffer{};	// binding 0
+	const Buffer* idxBuffer{};
+	std::uint32_t vertexStride{sizeof(Vertex)};
+	IndexType idxType{IndexType::UINT};
+	std::uint32_t idxCount{};
+	std::uint32_t firstIdx{};
+	std::int32_t vertexOffset{};
+	std::uint32_t instanceCount{1};
+	std::uint32_t firstInstance{};
+};
+// gl calls issued by CommandList::execute()
+struct CommandListStats
+{
+	std::uint32_t draws{};
+	std::uint32_t pipelineBinds{};
+	std::uint32_t vertexBufferBinds{};
+	std::uint32_t indexBufferBinds{};
+};
+// deferred draws, sorted by key so state changes happen only between groups
+// usage: clear(), draw() in any order, sort(), execute() while rendering
+struct CommandList
+{
+	void reserve(std::size_t count);
+	void clear() noexcept;
+
+	void draw(const DrawPacket& packet);
+	// packets of other list go after already recorded ones
+	void append(const CommandList& other);
+	// primitive of model, firstInstance is passed through so shaders can fetch per draw data with it
+	void draw(
+		std::uint64_t key,
+		const Pipeline& pipeline,
+		const GLTFModel& model,
+		const Primitive& primitive,
+		std::uint32_t firstInstance = 0);
+
+	// LSD radix sort of keys, bytes equal for all packets are skipped
+	// packets with equal keys keep submission order
+	void sort();
+	// replays packets in sorted order(submission order if sort() wasn't called)
+	// redundant pipeline and buffer binds are skipped, binds made outside of list are not trusted
+	CommandListStats execute(Renderer& renderer) const;
+
+	std::size_t size() const noexcept { return m_packets.size(); }
+	private:
+	std::vector<DrawPacket> m_packets;
+	std::vector<std::uint32_t> m_order;
+	// scratch of sort()
+	std::vector<std::uint64_t> m_keys,m_keysTmp;
+	std::vector<std::uint32_t> m_orderTmp;
+};
+// command lists recorded by worker threads during frame, one per job(not per thread)
+// so merged order never depends on scheduling, recording doesn't touch gl
+// usage:
+//	frame.resize(jobs);
+//	defaultThreadPool().parallelFor(jobs,[&](std::size_t job){ frame[job].draw(...); });
+//	renderer.submitAtEndFrame(frame);
+struct FrameCommands
+{
+	explicit FrameCommands(std::size_t jobCount = 0);
+
+	// drops everything recorded so far
+	void resize(std::size_t jobCount);
+	void clear() noexcept;
+	CommandList& operator[](std::size_t job) { return m_jobs[job]; }
+	std::size_t jobCount() const noexcept { return m_jobs.size(); }
+
+	// gl thread only, merges job lists in job order and sorts them
+	const CommandList& merge();
+	private:
+	std::vector<CommandList> m_jobs;
+	CommandList m_merged;
+};
+}
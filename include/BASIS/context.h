@@ -3,10 +3,14 @@
 #include <BASIS/types.h>
 #include <BASIS/pipeline.h>
 
+#include <vector>
 #include <string>
+#include <optional>
+#include <unordered_map>
 
 namespace BASIS
 {
+struct Renderer;
 struct DeviceLimits
 {
 	std::int32_t maxTextureSize;     // GL_MAX_TEXTURE_SIZE
@@ -82,9 +86,94 @@ struct DeviceProperties
 	std::string_view shadingLanguageVersion;
 	std::int32_t glVersionMajor;
 	std::int32_t glVersionMinor;
+	bool bindlessTextures; // GL_ARB_bindless_texture, software drivers often lack it
+	bool indirectCountDraws; // GL 4.6 or GL_ARB_indirect_parameters
 	DeviceLimits limits;
 };
 
+// state calls per kind, RenderingContext counts issued and filtered out ones
+// Renderer::endFrame() moves them into FrameStats and starts over
+struct StateCalls
+{
+	std::uint32_t programs{};
+	std::uint32_t vertexArrays{};
+	std::uint32_t framebuffers{};
+	std::uint32_t textures{};
+	std::uint32_t samplers{};
+	std::uint32_t bufferRanges{};
+	std::uint32_t vertexBuffers{};
+	std::uint32_t indexBuffers{};
+	std::uint32_t capabilities{};
+	std::uint32_t blendFuncs{};
+	std::uint32_t pipelineStates{};
+
+	std::uint32_t total() const noexcept
+	{
+		return programs + pipelineStates + vertexArrays + framebuffers + textures + samplers +
+		bufferRanges + vertexBuffers + indexBuffers + capabilities + blendFuncs;
+	}
+};
+struct BufferRange
+{
+	bool operator==(const BufferRange&) const noexcept = default;
+	std::uint32_t buffer{};
+	std::uint64_t offset{};
+	std::uint64_t size{};
+};
+struct VertexBufferBinding
+{
+	bool operator==(const VertexBufferBinding&) const noexcept = default;
+	std::uint32_t buffer{};
+	std::uint64_t offset{};
+	std::uint64_t stride{};
+};
+// DSA binds buffers to vertex array itself, so they're shadowed per vertex array
+struct VertexArrayBindings
+{
+	std::uint32_t elementBuffer{};
+	std::vector<VertexBufferBinding> vertexBuffers;
+};
+struct BlendFuncs
+{
+	bool operator==(const BlendFuncs&) const noexcept = default;
+	Factor srcRGB{};
+	Factor dstRGB{};
+	Factor srcAlpha{};
+	Factor dstAlpha{};
+};
+
+// gl object ids are reused after deletion, so wrappers report deletions
+// and shadowed bindings of that object are dropped before they could match a new one
+enum class GLObjectType : std::uint8_t
+{
+	BUFFER,
+	TEXTURE,
+	SAMPLER,
+	FRAMEBUFFER,
+	PROGRAM
+};
+void notifyObjectDeleted(GLObjectType type,std::uint32_t id) noexcept;
+
+// bytes passed to Buffer::update() and Texture::update(), gl thread only
+struct UploadedBytes
+{
+	std::uint64_t buffers{};
+	std::uint64_t textures{};
+};
+void notifyBufferUpload(std::uint64_t bytes) noexcept;
+void notifyTextureUpload(std::uint64_t bytes) noexcept;
+// returns bytes counted since last call
+UploadedBytes takeUploadedBytes() noexcept;
+
+// Renderer with pending batched draws, set while its batch isn't empty, gl thread only
+// buffer and texture updates and static Renderer functions flush it before touching gl state
+void setBatchingRenderer(Renderer* renderer) noexcept;
+void flushBatchedDraws();
+
+// framebuffer bound by Renderer::bindDefaultFramebuffer(), 0 unless App is headless
+void setDefaultFramebuffer(std::uint32_t id) noexcept;
+std::uint32_t defaultFramebuffer() noexcept;
+
 struct RenderingContext
 {
 	RenderingContext();
@@ -93,19 +182,41 @@ struct RenderingContext
 	
 	bool isRendering{false};
 	bool isComputeActive{false};
+	bool isRenderingSuspended{false}; // beginCompute() inside frame
 	bool isIdxBufferBound{false};
 	bool lastPipelineWasCompute{false};
 	
 	std::uint32_t fbo{};
 	std::uint32_t vao{};
 
-	std::shared_ptr<const PipelineInfo> lastPipelineInfo;
+	// set by Renderer::bindPipeline(), direct state changes reset it
+	const PipelineState* lastPipelineState{};
 	std::uint32_t lastBoundPipeline{};
 	
 	IndexType idxType{IndexType::UINT};
 	PrimitiveMode primitiveMode{PrimitiveMode::TRIANGLES};
+
+	// shadow of gl state set through Renderer, 0 ids and missing entries mean unknown
+	std::vector<std::uint32_t> textureUnits;
+	std::vector<std::uint32_t> samplerUnits;
+	std::vector<BufferRange> uniformBuffers;
+	std::vector<BufferRange> storageBuffers;
+	std::unordered_map<std::uint32_t,VertexArrayBindings> vertexArrays;
+	std::unordered_map<std::uint32_t,bool> capabilities;
+	std::optional<BlendFuncs> blendFuncs;
+
+	StateCalls issued;
+	StateCalls elided;
 	
 	bool checkExtensionSupport(std::string_view requestedExt);
+	// forgets all shadowed state, must be called after gl state was changed directly
+	void invalidate();
+	// forgets bindings of gl objects deleted since last call
+	void syncDeletions();
+	private:
+	void invalidateBindings();
+	void forgetObject(GLObjectType type,std::uint32_t id) noexcept;
+	std::uint64_t m_deletionEpoch{};
 };
 	
 };
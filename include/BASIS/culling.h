@@ -0,0 +1,48 @@
+#pragma once
+
+#include <BASIS/camera.h>
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+namespace BASIS
+{
+struct Primitive;
+struct SceneGraph;
+
+// normalized planes pointing inside: left right bottom top near far
+struct Frustum
+{
+	glm::vec4 planes[6]{};
+
+	static Frustum fromMatrix(const glm::mat4& viewProj);
+	static Frustum fromCamera(const Camera& camera,float aspect);
+};
+// boxes as structure of arrays so they can be tested 8(AVX2) or 4(SSE) at a time
+struct BoxSoA
+{
+	std::vector<float> cx,cy,cz; // center
+	std::vector<float> ex,ey,ez; // half extent
+
+	void push(const glm::vec3& center,const glm::vec3& extent);
+	void clear() noexcept;
+	std::size_t size() const noexcept { return cx.size(); }
+};
+// world space center and half extent of box enclosing transformed primitive AABB(Arvo)
+void primitiveWorldBox(const glm::mat4& world,const Primitive& prim,glm::vec3& center,glm::vec3& extent);
+// appends indices of boxes which intersect frustum to out
+void cullBoxes(const BoxSoA& boxes,const Frustum& frustum,std::vector<std::uint32_t>& out);
+
+struct VisiblePrimitive
+{
+	std::uint32_t node{};		// SceneGraph node
+	std::uint32_t primitive{};	// index inside node mesh
+};
+// tests world space boxes of every primitive in scene(update() must be called before)
+// nodes are processed in parallel, out is ordered the same way as nodes and primitives
+void cullScene(const SceneGraph& scene,const Frustum& frustum,std::vector<VisiblePrimitive>& out);
+}
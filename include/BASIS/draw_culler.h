@@ -0,0 +1,116 @@
+#pragma once
+
+#include <BASIS/types.h>
+#include <BASIS/buffer.h>
+#include <BASIS/meshlet.h>
+#include <BASIS/pipeline.h>
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+namespace BASIS
+{
+struct Renderer;
+struct SceneGraph;
+
+// one primitive instance, matches std430 layout used by culling shader
+struct DrawRecord
+{
+	glm::vec3 center{};			// object space bounding sphere
+	float radius{};
+	std::uint32_t firstIdx{};
+	std::uint32_t idxCount{};
+	std::int32_t vertexOffset{};
+	std::uint32_t transform{};	// index into transforms passed to DrawCuller::setTransforms()
+	std::uint32_t materialIdx{};
+	std::uint32_t shortIndices{}; // 1 - IndexType::USHORT, 0 - IndexType::UINT
+	std::uint32_t pad[2]{};
+};
+// GLSL mirrors of DrawRecord and DrawIndexedIndirectCommand for culling shaders, goes right after #version
+constexpr inline const char* DRAW_RECORD_GLSL = R"(
+struct DrawRecord
+{
+	vec3 center;
+	float radius;
+	uint firstIdx;
+	uint idxCount;
+	int vertexOffset;
+	uint transform;
+	uint materialIdx;
+	uint shortIndices;
+	uint pad0;
+	uint pad1;
+};
+struct DrawCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+)";
+// appends record for every primitive of scene nodes, transform is node index
+// so SceneGraph::worldMatrices() can be used as transforms directly
+void appendDrawRecords(const SceneGraph& scene,std::vector<DrawRecord>& out);
+
+// records and transforms of DrawCuller and HiZCuller, culled draws are written to command buckets
+// of capacity commands each, UINT ones to even and USHORT ones to odd buckets
+struct DrawRecordBuffers
+{
+	DrawRecordBuffers(std::uint32_t capacity,std::string_view recordsName,std::string_view transformsName);
+
+	// returns true if capacity grew to next power of two, buffers sized by it must be recreated
+	bool setDraws(std::span<const DrawRecord> records);
+	void setTransforms(std::span<const glm::mat4> transforms);
+	// draws UINT bucket and USHORT bucket + 1 after it, pipeline and vertex buffer must be bound
+	void draw(Renderer& renderer,const Buffer& idxBuffer,const Buffer& commands,const Buffer& counts,std::uint32_t bucket) const;
+
+	Buffer records;
+	Buffer transforms;
+	std::uint32_t capacity{};
+	std::uint32_t drawCount{};
+	bool hasShortIndices{};
+	private:
+	std::string_view m_recordsName;
+	std::string_view m_transformsName;
+};
+// frustum culls draw records on gpu and writes compacted draws for Renderer::drawIndexedIndirectCount()
+// baseInstance of every emitted draw is index of its record, so shaders can fetch transform and material with it
+// all records must live in the same vertex/index buffers(GeometryArena or single model)
+// usage: setDraws() when scene changes, setTransforms() when they move,
+// cull() inside compute section, draw() while rendering
+struct DrawCuller
+{
+	explicit DrawCuller(std::uint32_t capacity = 1024);
+
+	DrawCuller(DrawCuller&&) noexcept = default;
+	DrawCuller& operator=(DrawCuller&&) noexcept = default;
+
+	void setDraws(std::span<const DrawRecord> records);
+	void setTransforms(std::span<const glm::mat4> transforms);
+
+	void cull(Renderer& renderer,const glm::mat4& viewProj);
+	// pipeline and vertex buffer must be bound, index buffer is bound here
+	// UINT and USHORT draws are written to separate halves of command buffer and drawn separately
+	void draw(Renderer& renderer,const Buffer& idxBuffer);
+
+	// bound at binding 0 by cull(), vertex shader can bind it again to read DrawRecords
+	const Buffer& records() const noexcept { return m_draws.records; }
+	const Buffer& transforms() const noexcept { return m_draws.transforms; }
+	const Buffer& commands() const noexcept { return m_commands; }
+	const Buffer& drawCounts() const noexcept { return m_counts; }
+	std::uint32_t drawCount() const noexcept { return m_draws.drawCount; }
+	private:
+	ComputePipeline m_pipeline;
+	Buffer m_params;
+	DrawRecordBuffers m_draws;
+	Buffer m_commands;
+	Buffer m_counts;
+};
+}
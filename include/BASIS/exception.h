@@ -34,10 +34,10 @@ namespace BASIS
 	 * - file not found
 	 * - file already exists
 	 * - unsupported file format
+	 * - file can't be opened or mapped into memory(cooked model cache)
 	 * ApplicationException:
 	 * - window initialization failure
 	 * - glad initialization failure
-	 * - Bindless textures are unsupported
 	 * 
 	 * */
 	 
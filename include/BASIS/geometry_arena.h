@@ -0,0 +1,67 @@
+#pragma once
+
+#include <BASIS/buffer.h>
+
+#include <map>
+#include <span>
+#include <cstdint>
+#include <optional>
+
+namespace BASIS
+{
+// first fit free list over [0,capacity), neighbouring free blocks are merged on free()
+struct RangeAllocator
+{
+	explicit RangeAllocator(std::uint64_t capacity);
+
+	// returned offset is multiple of alignment(any value, not only powers of 2)
+	// std::nullopt if there's no free block big enough
+	std::optional<std::uint64_t> allocate(std::uint64_t size,std::uint64_t alignment);
+	void free(std::uint64_t offset,std::uint64_t size);
+	// appends free space at the end
+	void grow(std::uint64_t newCapacity);
+
+	std::uint64_t capacity() const noexcept { return m_capacity; }
+	private:
+	std::map<std::uint64_t,std::uint64_t> m_free; // offset -> size
+	std::uint64_t m_capacity{};
+};
+
+struct GeometryAllocation
+{
+	std::uint64_t offset{}; // bytes
+	std::uint64_t size{};
+};
+// one large vertex and one large index buffer shared by many models
+// buffers grow(reallocate and copy on gpu) when full, so rebind them after loading
+struct GeometryArena
+{
+	GeometryArena(std::uint64_t vertexCapacity,std::uint64_t idxCapacity);
+
+	GeometryArena(const GeometryArena&) = delete;
+	GeometryArena& operator=(const GeometryArena&) = delete;
+
+	// vertices are aligned to stride, so offset / stride can be used as base vertex
+	GeometryAllocation allocateVertices(std::span<const std::byte> data,std::uint64_t stride);
+	GeometryAllocation allocateVertices(const Buffer& src,std::uint64_t stride);
+	// aligned to 4 bytes, which fits every IndexType
+	GeometryAllocation allocateIndices(std::span<const std::byte> data);
+	GeometryAllocation allocateIndices(const Buffer& src);
+
+	void freeVertices(const GeometryAllocation& allocation);
+	void freeIndices(const GeometryAllocation& allocation);
+
+	const Buffer& vertexBuffer() const noexcept { return m_vertices.buffer; }
+	const Buffer& idxBuffer() const noexcept { return m_indices.buffer; }
+	private:
+	struct Pool
+	{
+		Buffer buffer;
+		RangeAllocator allocator;
+	};
+	GeometryAllocation allocate(Pool& pool,std::uint64_t size,std::uint64_t alignment);
+
+	Pool m_vertices;
+	Pool m_indices;
+};
+}
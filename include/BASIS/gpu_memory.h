@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+
+namespace BASIS
+{
+enum class GPUResource : std::uint32_t
+{
+	BUFFER,
+	TEXTURE,
+	// attachments are counted as textures, framebuffers only add objects
+	FRAMEBUFFER,
+	SAMPLER,
+	COUNT
+};
+const char* resourceName(GPUResource resource) noexcept;
+
+// peaks are high-water marks since start of program
+struct GPUMemoryCounter
+{
+	std::uint64_t bytes{};
+	std::uint64_t peakBytes{};
+	std::uint32_t objects{};
+	std::uint32_t peakObjects{};
+};
+struct GPUMemoryStats
+{
+	std::array<GPUMemoryCounter,static_cast<std::size_t>(GPUResource::COUNT)> resources{};
+	GPUMemoryCounter total{};
+
+	const GPUMemoryCounter& operator[](GPUResource resource) const noexcept { return resources[static_cast<std::size_t>(resource)]; }
+};
+struct GPUObjectInfo
+{
+	GPUResource resource{};
+	std::uint32_t id{};
+	std::uint64_t bytes{};
+	std::string name; // debug label given to constructor
+};
+// live objects of one kind sharing debug label
+struct GPULabelUsage
+{
+	GPUResource resource{};
+	std::string name;
+	std::uint64_t bytes{};
+	std::uint32_t objects{};
+};
+
+// Buffer, Texture, Framebuffer and Sampler register themselves on creation and deletion
+// gl objects live and die on the thread owning context, so does the registry
+void trackGPUObject(GPUResource resource,std::uint32_t id,std::uint64_t bytes,std::string_view name);
+void untrackGPUObject(GPUResource resource,std::uint32_t id) noexcept;
+
+GPUMemoryStats gpuMemoryStats() noexcept;
+// sorted from largest
+std::vector<GPUObjectInfo> liveGPUObjects();
+std::vector<GPULabelUsage> gpuMemoryByLabel();
+// prints still alive objects to stdout and returns their count, App calls it at shutdown
+std::size_t reportLiveGPUObjects();
+}
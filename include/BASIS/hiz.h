@@ -0,0 +1,77 @@
+#pragma once
+
+#include <BASIS/buffer.h>
+#include <BASIS/texture.h>
+#include <BASIS/pipeline.h>
+#include <BASIS/draw_culler.h>
+
+#include <span>
+#include <cstdint>
+
+#include <glm/mat4x4.hpp>
+
+namespace BASIS
+{
+struct Renderer;
+struct Framebuffer;
+
+enum class HiZPhase : std::uint32_t
+{
+	FIRST = 0,	// records which passed occlusion test against previous pyramid
+	SECOND = 1,	// records rejected by first phase which are visible against current pyramid
+};
+// two phase hierarchical depth occlusion culling on gpu
+// pyramid stores max depth of each texel footprint, level 0 is depth extent rounded down to power of two
+// frame(compute parts go between Renderer::beginCompute()/endCompute(), also inside beginFrame()/endFrame()):
+//	compute - cullFirstPhase()
+//	render  - draw(FIRST)
+//	compute - buildPyramid() from depth rendered so far, cullSecondPhase()
+//	render  - draw(SECOND)
+// pyramid built in the middle of the frame is used by the next first phase,
+// rebuilding it again after second phase gives more occluders at cost of another downsample chain
+// expects default gl depth range(near 0, far 1) with less or less-equal test
+struct HiZCuller
+{
+	explicit HiZCuller(glm::uvec2 depthExtent,std::uint32_t capacity = 1024);
+
+	HiZCuller(HiZCuller&&) noexcept = default;
+	HiZCuller& operator=(HiZCuller&&) noexcept = default;
+
+	// framebuffer size changed, previous pyramid is dropped
+	void resize(glm::uvec2 depthExtent);
+
+	// same records and transforms as DrawCuller
+	void setDraws(std::span<const DrawRecord> records);
+	void setTransforms(std::span<const glm::mat4> transforms);
+
+	// depth attachment must be single sampled 2D texture of given depthExtent
+	void buildPyramid(Renderer& renderer,const Framebuffer& framebuffer);
+	// frustum and occlusion test of all records, remembers viewProj for second phase
+	void cullFirstPhase(Renderer& renderer,const glm::mat4& viewProj);
+	void cullSecondPhase(Renderer& renderer);
+	// pipeline and vertex buffer must be bound, index buffer is bound here
+	void draw(Renderer& renderer,const Buffer& idxBuffer,HiZPhase phase);
+
+	const Texture& pyramid() const noexcept { return m_pyramid; }
+	const Buffer& records() const noexcept { return m_draws.records; }
+	const Buffer& transforms() const noexcept { return m_draws.transforms; }
+	const Buffer& commands() const noexcept { return m_commands; }
+	const Buffer& drawCounts() const noexcept { return m_counts; }
+	private:
+	void cull(Renderer& renderer,HiZPhase phase);
+
+	ComputePipeline m_reducePipeline;
+	ComputePipeline m_cullPipeline;
+	Sampler m_sampler;
+	Texture m_pyramid;
+	Buffer m_reduceParams;
+	Buffer m_cullParams;
+	DrawRecordBuffers m_draws;
+	Buffer m_commands;	// [phase][index type][capacity]
+	Buffer m_counts;	// [phase][index type]
+	Buffer m_retest;	// per record, 1 if rejected by first phase
+	glm::mat4 m_viewProj{1.f};
+	glm::uvec2 m_depthExtent{};
+	bool m_pyramidValid{};
+};
+}
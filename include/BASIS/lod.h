@@ -0,0 +1,30 @@
+#pragma once
+
+#include <BASIS/camera.h>
+#include <BASIS/manager.h>
+
+#include <cstdint>
+
+#include <glm/mat4x4.hpp>
+
+namespace BASIS
+{
+// index range picked for drawing, level 0 is full detail
+struct LodSelection
+{
+	std::uint32_t firstIdx{};
+	std::uint32_t idxCount{};
+	std::uint32_t level{};
+};
+// size in pixels of object space error seen from given distance
+float projectedError(float error,float distance,const Camera& camera,float viewportHeight);
+
+// picks the coarsest level whose error stays below pixelThreshold on screen
+// distance is measured to primitive bounding sphere, so primitives around camera stay at full detail
+LodSelection selectLod(
+	const Primitive& primitive,
+	const glm::mat4& model,
+	const Camera& camera,
+	float viewportHeight,
+	float pixelThreshold = 1.f);
+}
@@ -2,12 +2,17 @@
 
 #include <BASIS/types.h>
 #include <BASIS/buffer.h>
+#include <BASIS/meshlet.h>
+#include <BASIS/geometry_arena.h>
+#include <BASIS/pipeline.h>
 
 #include <string>
+#include <vector>
 #include <memory>
 #include <utility>
 #include <cstdint>
 #include <optional>
+#include <filesystem>
 #include <functional>
 #include <unordered_map>
 
@@ -27,6 +32,40 @@ struct Material;
 struct GLTFModel;
 struct SamplerInfo;
 
+enum class ModelFlagBit : std::uint32_t
+{
+	NONE = 0,
+	// vertices are stored as CompactVertex instead of Vertex, see compactVertexInputState()
+	COMPACT_VERTICES = 1 << 0,
+	// primitives are split into meshlets for gpu culling, see meshlet.h
+	MESHLETS = 1 << 1,
+	// welds duplicate vertices, reorders triangles for vertex cache and overdraw,
+	// reorders vertices for fetch locality and uses 16 bit indices where possible
+	OPTIMIZE = 1 << 2,
+	// simplified index ranges are generated for every primitive, see lod.h
+	LODS = 1 << 3,
+	// coarse copy of every primitive is kept on cpu for software occlusion, see software_occlusion.h
+	OCCLUDERS = 1 << 4,
+};
+BASIS_DECLARE_FLAG_TYPE(ModelFlags,ModelFlagBit,std::uint32_t);
+
+// gpu bytes held by model, textures shared between models are counted in each of them
+struct ModelMemoryUsage
+{
+	std::uint64_t uniqueHash{};
+	std::uint64_t geometry{}; // vertices and indices, own buffers or arena allocations
+	std::uint64_t materials{};
+	std::uint64_t meshlets{};
+	std::uint64_t textures{};
+
+	std::uint64_t total() const noexcept { return geometry + materials + meshlets + textures; }
+};
+struct TextureMemoryUsage
+{
+	std::uint64_t uniqueHash{};
+	std::uint64_t bytes{};
+};
+
 // texture/model/sampler creation/loading and caching
 struct Manager
 {
@@ -47,30 +86,84 @@ struct Manager
 	const Texture* getTexture(std::uint64_t uniqueHash,const std::uint8_t* px,std::size_t size,Format fmt = Format::UNDEFINED);
 	
 	const GLTFModel* getModel(std::uint64_t uniqueHash);
-	const GLTFModel* getModel(std::uint64_t uniqueHash,std::string_view);
+	const GLTFModel* getModel(std::uint64_t uniqueHash,std::string_view,ModelFlags flags = {});
 	
 	// for inserting hand crafted assets, will throw AssetException if asset with such hash already exists
 	void insertModel(std::uint64_t uniqueHash,GLTFModel&& model);
 	void insertTexture(std::uint64_t uniqueHash,Texture&& tex);
+
+	bool containsModel(std::uint64_t uniqueHash) const noexcept;
+
+	// frees model and its geometry, views returned by getModel() for this hash become dangling
+	void releaseModel(std::uint64_t uniqueHash);
+
+	// geometry of models loaded or inserted after this call is placed into one shared GeometryArena
+	// so every model can be drawn with the same vertex/index binding(and batched into one multi-draw)
+	void enableGeometryArena(std::uint64_t vertexBytes,std::uint64_t idxBytes);
+	const GeometryArena* geometryArena() const noexcept { return m_geometryArena.get(); }
+	bool containsTexture(std::uint64_t uniqueHash) const noexcept;
+
+	// every model/texture owned by manager sorted from largest, see gpu_memory.h for totals
+	std::vector<ModelMemoryUsage> modelMemoryUsage() const;
+	std::vector<TextureMemoryUsage> textureMemoryUsage() const;
 	
 	// used to filter needed data from Material struct and upload it into ubo
 	// (maybe you don't want all pbr bells and whistles)
 	// getModel() asserts if this one is not provided
 	std::function<Buffer(const std::vector<Material>&)> materialUploadCallback{};
+
+	// if set, getModel() stores fully processed models here and loads them back
+	// on next runs without parsing gltf, see model_cache.h
+	std::filesystem::path modelCacheDirectory{};
 		
 	private:
 	std::unordered_map<std::uint64_t,std::unique_ptr<Sampler>> m_samplers;
 	std::unordered_map<std::uint64_t,std::unique_ptr<Texture>> m_textures;
 	std::unordered_map<std::uint64_t,std::unique_ptr<GLTFModel>> m_models;
+	std::unique_ptr<GeometryArena> m_geometryArena;
+};
+// simplified version of primitive, uses the same vertices, index type and vertex offset
+struct PrimitiveLod
+{
+	std::uint32_t firstIdx{};
+	std::uint32_t idxCount{};
+	float error{}; // object space distance to full detail surface
 };
+// drawn with bindIndexBuffer(*model.idxBuffer,idxType) and drawIndexed(idxCount,firstIdx,vertexOffset)
+// firstIdx is counted in elements of idxType
 struct Primitive 
 {
 	std::uint32_t firstIdx{};
 	std::uint32_t idxCount{};
 	std::uint32_t materialIdx{};
+	IndexType idxType{IndexType::UINT};
+	std::int32_t vertexOffset{};
 
 	//KHR_material_variants
 	std::vector<std::optional<std::size_t>> mappings;
+
+	// ModelFlagBit::COMPACT_VERTICES only
+	// position = quantOffset + quantScale * CompactVertex::pos(as unorm)
+	glm::vec3 quantOffset{0.f};
+	glm::vec3 quantScale{1.f};
+
+	// ModelFlagBit::MESHLETS only, range inside GLTFModel::meshlets
+	std::uint32_t firstMeshlet{};
+	std::uint32_t meshletCount{};
+
+	// object space bounding sphere
+	glm::vec3 center{};
+	float radius{};
+	// object space bounding box
+	glm::vec3 aabbMin{};
+	glm::vec3 aabbMax{};
+
+	// ModelFlagBit::LODS only, from finest to coarsest, full detail is not included
+	std::vector<PrimitiveLod> lods;
+
+	// ModelFlagBit::OCCLUDERS only, range inside GLTFModel::occluderIndices
+	std::uint32_t firstOccluderIdx{};
+	std::uint32_t occluderIdxCount{};
 };
 struct Mesh 
 {
@@ -90,9 +183,9 @@ struct Node
 	Mesh			mesh;
 	std::int32_t	parent{-1};
 	glm::mat4		matrix{1.f};
-	glm::vec3		translation{1.f};
+	glm::vec3		translation{0.f};
 	glm::vec3		scale{1.f};
-	glm::quat		rotation{};
+	glm::quat		rotation{1.f,0.f,0.f,0.f};
 	std::vector<std::size_t> children;
 };
 
@@ -103,6 +196,24 @@ struct Vertex
 	glm::vec2 uv{};
 	glm::vec4 color{1.f};
 };
+// 20 bytes instead of 48
+// integer positions from KHR_mesh_quantization are kept as is, only rebased to unsigned
+// float positions are quantized inside primitive bounds
+struct CompactVertex
+{
+	std::uint16_t pos[4]{};		// unorm16, w is padding
+	std::uint32_t normal{};		// octahedral, snorm16x2
+	std::uint32_t uv{};			// half2
+	std::uint32_t color{~0u};	// unorm8x4
+};
+// binding 0, locations 0-3 match members of Vertex/CompactVertex
+// octahedral normal is decoded in shader:
+// vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+// if(n.z < 0) n.xy = (1.0 - abs(n.yx)) * sign(n.xy);
+// n = normalize(n);
+VertexInputState defaultVertexInputState();
+VertexInputState compactVertexInputState();
+
 struct GltfTexture
 {
 	std::uint32_t imageIdx{};
@@ -112,6 +223,7 @@ struct GltfTexture
 struct Material
 {
 	glm::vec4 baseColorFactor{};
+	// bindless handles, 0 if there's no texture or GL_ARB_bindless_texture is unsupported
 	std::uint64_t baseColorTexture{};
 	std::uint64_t metallicRoughnessTexture{};
 	
@@ -130,12 +242,32 @@ struct GLTFModel
 	std::vector<const Texture*>	images;
 	std::vector<const Sampler*>	samplers;
 	
+	// empty if geometry lives in GeometryArena, use vertices()/indices() to bind either of them
 	std::optional<Buffer>		idxBuffer;
 	std::optional<Buffer>		vertexBuffer;
+	std::uint32_t				vertexStride{sizeof(Vertex)};
+	ModelFlags					flags{};
 	std::optional<Buffer>		materialBuffer;
 
+	// ModelFlagBit::MESHLETS only
+	std::vector<Meshlet>		meshlets;
+	std::optional<Buffer>		meshletBuffer;
+
+	// ModelFlagBit::OCCLUDERS only, object space triangles, indices point into occluderPositions
+	std::vector<glm::vec3>		occluderPositions;
+	std::vector<std::uint32_t>	occluderIndices;
+
 	//KHR_material_variants
 	std::vector<std::string> materialVariants;
+
+	// set when geometry was placed into Manager's arena, then offsets inside
+	// primitives, lods and meshlets already point into arena buffers
+	const GeometryArena*		arena{};
+	GeometryAllocation			vertexAllocation{};
+	GeometryAllocation			idxAllocation{};
+
+	const Buffer& vertices() const { return arena ? arena->vertexBuffer() : *vertexBuffer; }
+	const Buffer& indices() const { return arena ? arena->idxBuffer() : *idxBuffer; }
 };
 
 }
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/vec3.hpp>
+
+// import time triangle list optimizations, indices are local to given vertex range
+// intended order: weldVertices() -> optimizeVertexCache() -> optimizeOverdraw() -> optimizeVertexFetch()
+namespace BASIS
+{
+// points indices of byte identical vertices to the first one of them
+// duplicates stay in place unreferenced, optimizeVertexFetch() drops them
+void weldVertices(std::span<std::uint32_t> indices,std::span<const std::byte> vertices,std::size_t stride);
+
+// reorders triangles for post transform cache hits(Tipsify, Sander et al. 2007)
+void optimizeVertexCache(std::span<std::uint32_t> indices,std::size_t vertexCount,std::uint32_t cacheSize = 16);
+
+// splits triangles into clusters at cache flush points and sorts them outside in,
+// so front facing surfaces tend to be drawn before the ones they cover
+// expects cache optimized order, positions are indexed with indices
+void optimizeOverdraw(std::span<std::uint32_t> indices,std::span<const glm::vec3> positions,std::uint32_t cacheSize = 16);
+
+// renumbers vertices in order of first use and drops unreferenced ones
+// returns new vertex count, vertices past it are left unspecified
+std::size_t optimizeVertexFetch(std::span<std::uint32_t> indices,std::span<std::byte> vertices,std::size_t stride);
+
+// quadric error edge collapse, vertices are only moved onto their neighbours so attributes stay valid
+// borders, uv/normal seams and vertices sharing position are locked
+// stops at targetIdxCount or when next collapse would exceed maxError(object space distance)
+// resultError receives largest error of performed collapses
+std::vector<std::uint32_t> simplify(
+	std::span<const std::uint32_t> indices,
+	std::span<const glm::vec3> positions,
+	std::size_t targetIdxCount,
+	float maxError,
+	float* resultError = nullptr);
+}
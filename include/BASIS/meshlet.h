@@ -0,0 +1,92 @@
+#pragma once
+
+#include <BASIS/buffer.h>
+#include <BASIS/pipeline.h>
+
+#include <span>
+#include <vector>
+#include <cstdint>
+
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+namespace BASIS
+{
+struct Renderer;
+
+constexpr inline std::uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr inline std::uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// contiguous range of triangles inside model index buffer
+// matches std430 layout used by culling shader
+struct Meshlet
+{
+	glm::vec3 center{};
+	float radius{};
+	// backface cone, meshlet is invisible if
+	// dot(center - camera,coneAxis) >= coneCutoff * length(center - camera) + radius
+	glm::vec3 coneAxis{0.f,0.f,1.f};
+	float coneCutoff{1.f}; // 1 - normals are spread too much, cone test is skipped
+	std::uint32_t firstIdx{};
+	std::uint32_t idxCount{};
+	std::int32_t vertexOffset{}; // base vertex of primitive
+	std::uint32_t pad{};
+};
+// DrawElementsIndirectCommand
+struct DrawIndexedIndirectCommand
+{
+	std::uint32_t count{};
+	std::uint32_t instanceCount{};
+	std::uint32_t firstIndex{};
+	std::int32_t  baseVertex{};
+	std::uint32_t baseInstance{};
+};
+
+// splits triangle list into meshlets of at most MESHLET_MAX_VERTICES/MESHLET_MAX_TRIANGLES
+// triangles are taken in index order, so it's worth to optimize vertex cache order first
+// positions are looked up with (index - vertexOffset), firstIdx is offset of indices inside index buffer
+void buildMeshlets(
+	std::span<const std::uint32_t> indices,
+	std::span<const glm::vec3> positions,
+	std::uint32_t vertexOffset,
+	std::uint32_t firstIdx,
+	std::vector<Meshlet>& out);
+
+// culls meshlets by frustum and backface cone on gpu and writes compacted draws
+// for Renderer::drawIndexedIndirectCount()
+// usage per frame: reset(), cull() for each primitive inside compute section, draw() while rendering
+struct MeshletCuller
+{
+	explicit MeshletCuller(std::uint32_t maxDraws);
+
+	MeshletCuller(MeshletCuller&&) noexcept = default;
+	MeshletCuller& operator=(MeshletCuller&&) noexcept = default;
+
+	void reset() noexcept;
+	// meshlets buffer holds Meshlet structs(GLTFModel::meshletBuffer)
+	// baseInstance is passed to every emitted draw, so vertex shader can fetch per object data with it
+	// cone test assumes model matrix without mirroring
+	void cull(
+		Renderer& renderer,
+		const Buffer& meshlets,
+		std::uint32_t firstMeshlet,
+		std::uint32_t meshletCount,
+		const glm::mat4& model,
+		const glm::mat4& viewProj,
+		const glm::vec3& cameraPos,
+		std::uint32_t baseInstance = 0);
+	// pipeline, vertex and index buffers of culled model must be bound
+	// every draw uses bound index type, primitives with different Primitive::idxType need their own culler
+	void draw(Renderer& renderer);
+
+	const Buffer& commands() const noexcept { return m_commands; }
+	const Buffer& drawCount() const noexcept { return m_count; }
+	std::uint32_t maxDraws() const noexcept { return m_maxDraws; }
+	private:
+	ComputePipeline m_pipeline;
+	Buffer m_params;
+	Buffer m_commands;
+	Buffer m_count;
+	std::uint32_t m_maxDraws{};
+};
+}
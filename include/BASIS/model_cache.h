@@ -0,0 +1,133 @@
+#pragma once
+
+#include <BASIS/manager.h>
+#include <BASIS/texture.h>
+
+#include <span>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <filesystem>
+#include <string_view>
+
+namespace BASIS
+{
+// read only memory mapping of a whole file
+struct MappedFile
+{
+	explicit MappedFile(const std::filesystem::path& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	std::span<const std::byte> bytes() const noexcept { return {static_cast<const std::byte*>(m_data),m_size}; }
+	private:
+	void* m_data{};
+	std::size_t m_size{};
+#ifdef _WIN32
+	void* m_file{};
+	void* m_mapping{};
+#endif
+};
+
+// records stored in cooked model files, all of them are trivially copyable
+// so they're used straight from the mapping
+struct CookedNode
+{
+	glm::mat4		matrix{1.f};
+	glm::vec3		translation{0.f};
+	glm::vec3		scale{1.f};
+	glm::quat		rotation{1.f,0.f,0.f,0.f};
+	std::int32_t	parent{-1};
+	std::uint32_t	firstPrimitive{};
+	std::uint32_t	primitiveCount{};
+	std::uint32_t	firstChild{};
+	std::uint32_t	childCount{};
+};
+struct CookedPrimitive
+{
+	glm::vec3 quantOffset{0.f};
+	glm::vec3 quantScale{1.f};
+	std::uint32_t firstIdx{};
+	std::uint32_t idxCount{};
+	std::uint32_t materialIdx{};
+	std::uint32_t firstMapping{};
+	std::uint32_t mappingCount{};
+	std::uint32_t firstMeshlet{};
+	std::uint32_t meshletCount{};
+	IndexType idxType{IndexType::UINT};
+	std::int32_t vertexOffset{};
+	glm::vec3 center{};
+	float radius{};
+	glm::vec3 aabbMin{};
+	glm::vec3 aabbMax{};
+	std::uint32_t firstLod{};
+	std::uint32_t lodCount{};
+	std::uint32_t firstOccluderIdx{};
+	std::uint32_t occluderIdxCount{};
+};
+// gltf texture indices used by material, -1 if there's none
+// bindless handles from Material are only valid for current context so they're rebuilt on load
+struct CookedMaterialTextures
+{
+	std::int32_t baseColor{-1};
+	std::int32_t metallicRoughness{-1};
+};
+// image is either a path to external file or encoded(png,ktx2...) bytes
+struct CookedImage
+{
+	std::string_view path;
+	std::span<const std::byte> bytes;
+};
+
+// everything needed to rebuild GLTFModel without touching gltf
+// when written, views point into loader's vectors, when read - into file mapping
+struct CookedModel
+{
+	std::uint32_t flags{};
+	std::span<const std::byte>				vertices;
+	std::span<const std::byte>				indices;
+	std::span<const CookedNode>				nodes;
+	std::span<const CookedPrimitive>		primitives;
+	std::span<const std::int64_t>			mappings; // -1 - std::nullopt
+	std::span<const std::uint64_t>			children;
+	std::span<const Material>				materials;
+	std::span<const CookedMaterialTextures>	materialTextures;
+	std::span<const GltfTexture>			textures;
+	std::span<const SamplerInfo>			samplers;
+	std::span<const Meshlet>				meshlets;
+	std::span<const PrimitiveLod>			lods;
+	std::span<const glm::vec3>				occluderPositions;
+	std::span<const std::uint32_t>			occluderIndices;
+	std::vector<CookedImage>				images;
+	std::vector<std::string_view>			materialVariants;
+};
+
+// opened cooked file, keeps mapping alive for views inside model
+struct CookedModelFile
+{
+	// returns std::nullopt if there's no cooked file or it's stale
+	// file is valid if source size and modification time match, if only time differs
+	// content hash is compared(and stored time is refreshed on match)
+	// external buffers and images recorded by writeCookedModel() are checked the same way
+	static std::optional<CookedModelFile> open(
+		const std::filesystem::path& cooked,
+		const std::filesystem::path& source,
+		std::uint32_t flags);
+
+	CookedModel model;
+	private:
+	std::unique_ptr<MappedFile> m_file;
+};
+// path of cooked file for source inside cache directory
+std::filesystem::path cookedModelPath(const std::filesystem::path& directory,const std::filesystem::path& source);
+// externalFiles are uris of .bin and image files relative to source directory
+// throws FileException or filesystem_error, half written file is removed
+void writeCookedModel(
+	const std::filesystem::path& cooked,
+	const std::filesystem::path& source,
+	const CookedModel& model,
+	std::span<const std::filesystem::path> externalFiles = {});
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <BASIS/types.h>
 #include <BASIS/interfaces.h>
 
 #include <span>
@@ -23,6 +24,7 @@ struct Shader : public IGLObject
 };
 struct VertexBinding
 {
+	bool operator==(const VertexBinding&) const noexcept = default;
 	std::uint32_t 	location{};
 	std::uint32_t 	binding{};
 	std::uint32_t 	offset{};
@@ -31,6 +33,7 @@ struct VertexBinding
 
 struct TessellationState
 {
+	bool operator==(const TessellationState&) const noexcept = default;
 	std::array<float,2> innerPatchLevel = {1.f,1.f};		// glPatchParameterfv(GL_PATCH_DEFAULT_INNER_LEVEL,);
 	std::array<float,4> outerPatchLevel = {1.f,1.f,1.f,1.f};// glPatchParameterfv(GL_PATCH_DEFAULT_OUTER_LEVEL,);
 
@@ -38,6 +41,7 @@ struct TessellationState
 };
 struct RasterizationState
 {
+	bool operator==(const RasterizationState&) const noexcept = default;
 	bool depthClampEnable         = false;
 	PolygonMode polygonMode    	  = PolygonMode::FILL;
 	CullMode cullMode             = CullMode::BACK;
@@ -50,22 +54,66 @@ struct RasterizationState
 };
 struct DepthState 
 {
+	bool operator==(const DepthState&) const noexcept = default;
 	bool depthTestEnable		= false;
 	bool depthWriteEnable		= false;
 	CompareMode depthCompareOp	= CompareMode::LESS;
 };
+struct BlendState
+{
+	bool operator==(const BlendState&) const noexcept = default;
+	bool blendEnable				= false;
+	Factor srcColorBlendFactor		= Factor::ONE;
+	Factor dstColorBlendFactor		= Factor::ZERO;
+	BlendOp colorBlendOp			= BlendOp::ADD;
+	Factor srcAlphaBlendFactor		= Factor::ONE;
+	Factor dstAlphaBlendFactor		= Factor::ZERO;
+	BlendOp alphaBlendOp			= BlendOp::ADD;
+	std::array<bool,4> colorWriteMask = {true,true,true,true}; // glColorMask
+};
+struct StencilOpState
+{
+	bool operator==(const StencilOpState&) const noexcept = default;
+	StencilOp failOp			= StencilOp::KEEP;
+	StencilOp passOp			= StencilOp::KEEP;
+	StencilOp depthFailOp		= StencilOp::KEEP;
+	CompareMode compareOp		= CompareMode::ALWAYS;
+	std::uint32_t compareMask	= 0xFF;
+	std::uint32_t writeMask		= 0xFF;
+	std::uint32_t reference		= 0;
+};
+struct StencilState
+{
+	bool operator==(const StencilState&) const noexcept = default;
+	bool stencilTestEnable = false;
+	StencilOpState front{};
+	StencilOpState back{};
+};
 
 using VertexInputState = std::vector<VertexBinding>;
 struct PipelineInfo
 {
+	bool operator==(const PipelineInfo&) const noexcept = default;
 	PrimitiveMode mode{PrimitiveMode::TRIANGLES};
 
 	DepthState			depthState{};
+	BlendState			blendState{};
+	StencilState		stencilState{};
 	VertexInputState	vertexInputState{};
 	TessellationState	tessellationState{};
 	RasterizationState	rasterizationState{};
 
 };
+// baked once per distinct PipelineInfo, pipelines with equal info share one block
+// so Renderer::bindPipeline() can skip state changes by pointer compare
+struct PipelineState
+{
+	PipelineInfo info;
+	std::uint32_t vao{};
+	// equal for blocks which differ only in vertex input,
+	// switching between them rebinds vao and nothing else
+	std::uint32_t fingerprint{};
+};
 struct PipelineCreateInfo : public PipelineInfo
 {
 	const Shader* vertex{};
@@ -81,8 +129,10 @@ struct Pipeline : public IGLObject
 	Pipeline(Pipeline&&) noexcept;
 	Pipeline& operator=(Pipeline&&) noexcept;
 	
-	// pulls info from internal pipeline cache
-	const std::shared_ptr<const PipelineInfo> info() const noexcept;
+	const PipelineInfo& info() const noexcept { return m_state->info; }
+	const PipelineState& state() const noexcept { return *m_state; }
+	private:
+	std::shared_ptr<const PipelineState> m_state;
 
 };
 struct ComputePipeline : public IGLObject
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <BASIS/timer.h>
+
+#include <span>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+// zone of default profiler lasting until end of enclosing block, name must be string literal
+// GPU variant also measures gl commands issued inside and labels them with debug group, gl thread only
+#if BASIS_PROFILE
+	#define BASIS_PROFILE_CONCAT_IMPL(a,b) a##b
+	#define BASIS_PROFILE_CONCAT(a,b) BASIS_PROFILE_CONCAT_IMPL(a,b)
+	#define BASIS_PROFILE_ZONE(name) ::BASIS::ProfileZone BASIS_PROFILE_CONCAT(profileZone,__LINE__){name}
+	#define BASIS_PROFILE_GPU_ZONE(name) ::BASIS::ProfileZone BASIS_PROFILE_CONCAT(profileZone,__LINE__){name,true}
+#else
+	#define BASIS_PROFILE_ZONE(name)
+	#define BASIS_PROFILE_GPU_ZONE(name)
+#endif
+
+namespace BASIS
+{
+// finished zone, times are nanoseconds since profiler creation on CPUTimer clock
+struct ProfileEvent
+{
+	const char* name{};
+	std::uint64_t start{};
+	std::uint64_t end{};
+	std::uint32_t thread{}; // GPU_THREAD for gpu side of zones
+	std::uint32_t depth{};
+};
+// rolling statistics of per frame zone time over last ZONE_HISTORY frames, nanoseconds
+struct ZoneStats
+{
+	const char* name{};
+	bool gpu{};
+	std::uint64_t min{};
+	std::uint64_t avg{};
+	std::uint64_t p99{};
+	std::uint32_t calls{}; // in last frame
+};
+// nested cpu zones from any thread and gpu zones from gl thread
+// every thread appends to its own buffer, newFrame() merges them
+// gpu timestamps are read back latency frames later without waiting and
+// moved onto cpu timeline with offset measured once at first gpu zone
+// usage: setEnabled(true)(disabled by default, App does it with F1),
+// newFrame() once per frame(App::run() does it for defaultProfiler()), zones anywhere,
+// gui() inside ImGui frame, startCapture()/stopCapture() around frames to export
+struct Profiler
+{
+	static constexpr std::uint32_t GPU_THREAD = ~0u;
+	static constexpr std::uint32_t ZONE_HISTORY = 128;
+	// per thread between two newFrame() calls, later events are dropped
+	// so profiler without newFrame() doesn't grow without bound
+	static constexpr std::uint32_t MAX_THREAD_EVENTS = 1 << 16;
+	
+	// gpu side of zone, idx is GPUQueryPool::NO_SCOPE for cpu only zones
+	using GpuZoneId = GPUQueryPool::ScopeId;
+
+	explicit Profiler(std::uint32_t maxGpuZones = 128,std::uint32_t latency = 3);
+	// doesn't touch gl, call releaseQueries() while context is still alive
+	~Profiler();
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+	Profiler(Profiler&&) = delete;
+	Profiler& operator=(Profiler&&) = delete;
+
+	// disabled profiler makes zones cost a single atomic load
+	void setEnabled(bool enabled) noexcept { m_enabled.store(enabled,std::memory_order_relaxed); }
+	bool enabled() const noexcept { return m_enabled.load(std::memory_order_relaxed); }
+
+	// gl thread only, closes frame statistics and resolves gpu zones of old frames
+	void newFrame();
+
+	// ProfileZone is the intended interface, name must outlive profiler
+	GpuZoneId beginZone(const char* name,bool gpu);
+	void endZone(const char* name,std::uint64_t start,std::uint32_t depth,GpuZoneId gpuZone);
+
+	// every event from now on is kept until stopCapture()
+	void startCapture();
+	// writes chrome trace_event json(chrome://tracing, ui.perfetto.dev), returns false if file can't be written
+	bool stopCapture(std::string_view path);
+	bool capturing() const noexcept { return m_capturing; }
+
+	// zones of last finished frame, gpu ones come from latency frames before
+	std::span<const ProfileEvent> lastFrame() const noexcept { return m_lastFrame; }
+	std::vector<ZoneStats> stats() const;
+	// events dropped because of MAX_THREAD_EVENTS since start
+	std::uint64_t droppedEvents() const noexcept { return m_dropped; }
+	// flame view of last frame and statistics table, ImGui frame must be active
+	void gui();
+
+	// gl thread only, pending gpu zones are dropped, queries are recreated by next gpu zone
+	void releaseQueries();
+
+	std::uint64_t now() const noexcept { return m_clock.getTime(); }
+	private:
+	struct ThreadBuffer
+	{
+		std::mutex mutex; // only contended by newFrame()
+		std::vector<ProfileEvent> events;
+		std::uint64_t dropped{};
+	};
+	struct ZoneHistory
+	{
+		bool gpu{};
+		std::uint64_t frameTime{};
+		std::uint32_t frameCalls{};
+		std::uint32_t lastCalls{};
+		std::uint32_t count{};
+		std::uint32_t head{};
+		std::array<std::uint64_t,ZONE_HISTORY> samples{};
+	};
+	ThreadBuffer& threadBuffer();
+	void record(const ProfileEvent& event);
+	void calibrate();
+
+	CPUTimer m_clock;
+	std::atomic<bool> m_enabled{false};
+	// identifies profiler in thread local buffer lookup, addresses may be reused
+	const std::uint32_t m_id;
+	mutable std::mutex m_mutex;
+
+	std::vector<std::unique_ptr<ThreadBuffer>> m_threads;
+	std::vector<ProfileEvent> m_lastFrame;
+	std::uint64_t m_dropped{};
+	std::uint64_t m_frameStart{};
+	std::uint64_t m_lastFrameStart{},m_lastFrameEnd{};
+	// keyed by zone name, cpu and gpu sides are kept apart
+	std::unordered_map<std::string_view,ZoneHistory> m_cpuHistory,m_gpuHistory;
+
+	bool m_capturing{false};
+	std::vector<ProfileEvent> m_capture;
+
+	// created by first gpu zone, gl thread only
+	std::unique_ptr<GPUQueryPool> m_gpuQueries;
+	// pool copies zone names, this maps them back to literals events point to
+	std::unordered_map<std::string_view,const char*> m_gpuNames;
+	std::uint32_t m_maxGpuZones{};
+	std::uint32_t m_latency{};
+	// gpu time - cpu time, 0 until first gpu zone
+	std::int64_t m_gpuOffset{};
+	bool m_calibrated{false};
+};
+// lazily created profiler used by BASIS_PROFILE_ZONE
+Profiler& defaultProfiler();
+
+struct ProfileZone
+{
+	explicit ProfileZone(const char* name,bool gpu = false,Profiler& profiler = defaultProfiler());
+	~ProfileZone();
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+	private:
+	Profiler* m_profiler{};
+	const char* m_name{};
+	std::uint64_t m_start{};
+	std::uint32_t m_depth{};
+	Profiler::GpuZoneId m_gpuZone{};
+};
+}
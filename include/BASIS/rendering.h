@@ -5,26 +5,131 @@
 #include <BASIS/context.h>
 #include <BASIS/texture.h>
 #include <BASIS/manager.h>
+#include <BASIS/meshlet.h>
 #include <BASIS/pipeline.h>
 #include <BASIS/framebuffer.h>
+#include <BASIS/command_list.h>
 
 
 #include <span>
+#include <array>
+#include <memory>
+#include <functional>
+#include <vector>
 #include <cstdint>
 
 #include <glm/mat4x4.hpp>
 
 namespace BASIS
 {
+// upper bound of Renderer::setFramesInFlight()
+constexpr inline std::uint32_t MAX_FRAMES_IN_FLIGHT = 3;
+
+// Renderer entry points timed when call timing is on, times are inclusive(bind includes flushed draws)
+enum class RendererCall : std::uint32_t
+{
+	DRAW,
+	DRAW_INDEXED,
+	DRAW_INDIRECT,
+	DRAW_INDEXED_INDIRECT,
+	DRAW_INDIRECT_COUNT,
+	DRAW_INDEXED_INDIRECT_COUNT,
+	FLUSH_DRAWS,
+	DISPATCH,
+	BIND_PIPELINE,
+	BIND_COMPUTE_PIPELINE,
+	BIND_VERTEX_BUFFER,
+	BIND_INDEX_BUFFER,
+	BIND_BUFFER_RANGE,
+	BIND_TEXTURE,
+	BIND_FRAMEBUFFER,
+	COUNT
+};
+constexpr inline std::uint32_t CALL_TIME_BUCKETS = 24;
+// bucket i counts calls which took [2^i,2^(i+1)) ns, last one everything longer
+struct CallHistogram
+{
+	std::array<std::uint32_t,CALL_TIME_BUCKETS> buckets{};
+	std::uint64_t totalTime{};
+	std::uint32_t calls{};
+};
+// work submitted between two Renderer::endFrame() calls
+struct FrameStats
+{
+	std::uint32_t draws{};
+	std::uint32_t indexedDraws{};
+	std::uint32_t indirectDraws{};
+	std::uint32_t indexedIndirectDraws{};
+	std::uint32_t indirectCountDraws{};
+	std::uint32_t indexedIndirectCountDraws{};
+	// glMultiDrawElementsIndirect calls of draw batching and drawIndexed() calls merged into them
+	std::uint32_t multiDrawBatches{};
+	std::uint32_t batchedDraws{};
+	// drawCount of indirect calls, maxDrawCount for count variants
+	std::uint64_t indirectCommands{};
+	// direct draws only, indirect ones aren't known on cpu
+	std::uint64_t instances{};
+	std::uint64_t vertices{};
+	std::uint64_t indices{};
+	std::uint32_t dispatches{};
+	std::uint32_t indirectDispatches{};
+
+	StateCalls issued;
+	StateCalls elided;
+	UploadedBytes uploaded;
+
+	bool callTiming{};
+	std::array<CallHistogram,static_cast<std::size_t>(RendererCall::COUNT)> callTimes{};
+};
 // main structure responsible for rendering
 // all static functions influence only global gl context and don't need checks
 // non static function introduce some context changes and/or check context flags
+// binds and state changes are filtered against RenderingContext shadow,
+// call context->invalidate() after touching that state with raw gl
 // should be used once per app
 struct Renderer
 {
 	std::unique_ptr<RenderingContext> context = std::make_unique<RenderingContext>();
+
+	// waits for frames in flight, so their fences are deleted and callbacks run
+	~Renderer();
+
+	// while enabled drawIndexed() only records commands, consecutive ones are issued as one
+	// glMultiDrawElementsIndirect when pipeline, bindings or other state change through Renderer
+	// and at endFrame(), draws keep order, per draw data goes through firstInstance(gl_BaseInstance)
+	// static functions and buffer and texture updates flush the batch themselves,
+	// direct gl calls need flushDraws() before them
+	void setDrawBatching(bool enable);
+	bool drawBatching() const noexcept { return m_drawBatching; }
+	void flushDraws();
+
+	// cpu runs at most framesInFlight frames ahead of gpu,
+	// beginFrame() waits for fence of frame which used the same frameIndex() before
 	void beginFrame();
+	// executes frames queued by submitAtEndFrame() in queue order, then clears them and fences frame
 	void endFrame();
+
+	// 1 - MAX_FRAMES_IN_FLIGHT, outside of frame only, waits for gpu to finish all frames
+	void setFramesInFlight(std::uint32_t count);
+	std::uint32_t framesInFlight() const noexcept { return static_cast<std::uint32_t>(m_frames.size()); }
+	// slot of current frame, per frame resources indexed by it are not read by gpu anymore once beginFrame() returns
+	std::uint32_t frameIndex() const noexcept { return m_frameIndex; }
+	std::uint64_t frameNumber() const noexcept { return m_frameNumber; }
+	// nanoseconds last beginFrame() spent waiting for gpu
+	std::uint64_t fenceWaitTime() const noexcept { return m_fenceWaitTime; }
+	// stats of last finished frame
+	const FrameStats& frameStats() const noexcept { return m_lastFrameStats; }
+	// per call cpu time histograms, costs two clock reads per call
+	void setCallTiming(bool enable) noexcept { m_frameStats.callTiming = enable; }
+	// ImGui window with frameStats() and gpuMemoryStats(), ImGui frame must be active
+	void statsGui() const;
+	// called on gl thread once gpu finished current frame(or last one when called outside of frame),
+	// at latest in beginFrame() reusing its slot
+	void onFrameCompleted(std::function<void()> callback);
+	// waits for all frames in flight and runs their callbacks
+	void waitIdle();
+	// may be called inside frame, pending batched draws are flushed and
+	// draws are rejected until endCompute() resumes the frame
 	void beginCompute();
 	void endCompute();
 	
@@ -69,6 +174,7 @@ struct Renderer
 		std::uint64_t size = WHOLE_BUFFER,
 		std::uint64_t offs = 0);
 	
+	// indirect count draws need DeviceProperties::indirectCountDraws, 4.5 contexts may lack them
 	void drawIndirectCount(
 		const Buffer& commandBuffer,
 		const Buffer& countBuffer,
@@ -95,13 +201,16 @@ struct Renderer
 	std::uint64_t countBufferOffset = 0);
 	
 	void bindSampledImage(std::uint32_t index, const Texture& texture, const Sampler& sampler);
+	// single level of texture for image load/store
+	void bindImage(std::uint32_t index,const Texture& texture,std::uint32_t level,AccessFlags access);
 	
 	void clearColor(float r,float g,float b,float a);
 	void clear(MaskFlags mask);
 	
 	void bindFramebuffer(const Framebuffer& fbo);
 	
-	static void bindDefaultFramebuffer();
+	// window's framebuffer, App::offscreenFramebuffer() in headless mode
+	void bindDefaultFramebuffer();
 	static void blitFramebuffer(
 		const Framebuffer& src,
 		const Framebuffer& dst,
@@ -114,11 +223,18 @@ struct Renderer
 	static bool isValidDrawFramebuffer(const Framebuffer& fb);
 	static bool isValidReadFramebuffer(const Framebuffer& fb);
 
-	static void enableCapability(Cap capability);
-	static void disableCapability(Cap capability);
+	static void memoryBarrier(MemoryBarrierFlags flags);
+
+	// frame must stay alive until endFrame()
+	void submitAtEndFrame(FrameCommands& frame);
+	// stats of lists executed by last endFrame()
+	const CommandListStats& submitStats() const noexcept { return m_submitStats; }
+
+	void enableCapability(Cap capability);
+	void disableCapability(Cap capability);
 	
-	static void blendFunc(Factor src,Factor dst);
-	static void blendFuncSeparate(Factor srcRGB,Factor dstRGB,Factor srcAlpha,Factor dstAlpha);
+	void blendFunc(Factor src,Factor dst);
+	void blendFuncSeparate(Factor srcRGB,Factor dstRGB,Factor srcAlpha,Factor dstAlpha);
 	
 	static void setUniform(
 		std::uint8_t size,
@@ -139,7 +255,29 @@ struct Renderer
 		const float* val,
 		bool transpose=false);
 	
-	
+	private:
+	struct FrameSlot
+	{
+		void* fence{}; // GLsync
+		std::vector<std::function<void()>> callbacks;
+	};
+	// blocking waits if wait is set, returns if frame is done
+	bool retireFrame(FrameSlot& frame,bool wait);
+
+	std::vector<FrameSlot> m_frames = std::vector<FrameSlot>(2);
+	std::uint32_t m_frameIndex{};
+	std::uint64_t m_frameNumber{};
+	std::uint64_t m_fenceWaitTime{};
+	FrameStats m_frameStats;
+	FrameStats m_lastFrameStats;
+
+	bool m_drawBatching{false};
+	std::vector<DrawIndexedIndirectCommand> m_batch;
+	// written at increasing offsets and orphaned once full, so batches in flight aren't overwritten
+	std::unique_ptr<Buffer> m_batchBuffer;
+	std::size_t m_batchOffset{};
+	std::vector<FrameCommands*> m_pendingFrames;
+	CommandListStats m_submitStats;
 };
 	
 }
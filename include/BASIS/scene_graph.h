@@ -0,0 +1,71 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <cstdint>
+
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace BASIS
+{
+struct Node;
+struct GLTFModel;
+
+// T * R * S
+glm::mat4 composeTransform(const glm::vec3& translation,const glm::quat& rotation,const glm::vec3& scale);
+// inverse of composeTransform() for matrices without shear
+void decomposeTransform(const glm::mat4& matrix,glm::vec3& translation,glm::quat& rotation,glm::vec3& scale);
+
+// flat node hierarchy stored as parallel arrays
+// parents always come before their children, so world transforms are resolved
+// in one linear pass which only touches subtrees under modified nodes
+struct SceneGraph
+{
+	static constexpr std::int32_t NO_PARENT = -1;
+
+	// parent must already be in graph
+	std::uint32_t addNode(
+		std::int32_t parent,
+		const glm::vec3& translation = glm::vec3(0.f),
+		const glm::quat& rotation = glm::quat(1.f,0.f,0.f,0.f),
+		const glm::vec3& scale = glm::vec3(1.f),
+		const Node* source = nullptr);
+	// appends whole node tree of model, returns index of first added node
+	// model nodes are reachable through source()
+	std::uint32_t addModel(const GLTFModel& model,std::int32_t parent = NO_PARENT);
+
+	void setTranslation(std::uint32_t node,const glm::vec3& translation);
+	void setRotation(std::uint32_t node,const glm::quat& rotation);
+	void setScale(std::uint32_t node,const glm::vec3& scale);
+
+	// recomputes local matrices of modified nodes and world matrices of their subtrees
+	void update();
+
+	std::uint32_t size() const noexcept { return static_cast<std::uint32_t>(m_parents.size()); }
+	std::int32_t parent(std::uint32_t node) const noexcept { return m_parents[node]; }
+	const Node* source(std::uint32_t node) const noexcept { return m_sources[node]; }
+	const glm::vec3& translation(std::uint32_t node) const noexcept { return m_translations[node]; }
+	const glm::quat& rotation(std::uint32_t node) const noexcept { return m_rotations[node]; }
+	const glm::vec3& scale(std::uint32_t node) const noexcept { return m_scales[node]; }
+
+	// valid after update()
+	const glm::mat4& world(std::uint32_t node) const noexcept { return m_worldMatrices[node]; }
+	std::span<const glm::mat4> worldMatrices() const noexcept { return m_worldMatrices; }
+	std::span<const glm::mat4> localMatrices() const noexcept { return m_localMatrices; }
+	private:
+	void markDirty(std::uint32_t node);
+
+	std::vector<std::int32_t>	m_parents;
+	std::vector<const Node*>	m_sources;
+	std::vector<glm::vec3>		m_translations;
+	std::vector<glm::quat>		m_rotations;
+	std::vector<glm::vec3>		m_scales;
+	std::vector<glm::mat4>		m_localMatrices;
+	std::vector<glm::mat4>		m_worldMatrices;
+	std::vector<std::uint8_t>	m_dirty;
+	// nothing before it is dirty, so update() starts here
+	std::uint32_t m_firstDirty{};
+};
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <BASIS/culling.h>
+
+#include <span>
+#include <vector>
+#include <cstdint>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+namespace BASIS
+{
+struct Primitive;
+struct GLTFModel;
+struct SceneGraph;
+
+// cpu occlusion culling against coarse depth buffer of few big occluders
+// depth is gl window depth(0 near, 1 far), buffer keeps nearest occluder per pixel
+// frame: clear(), addOccluder() for chosen occluders, rasterize(), then isVisible()/cull()
+// occluders are rasterized at pixel centers, occludees are tested conservatively against whole covered rect
+// screen is split into tiles which are rasterized in parallel, 8(AVX2) or 4(SSE) pixels at a time
+struct SoftwareOcclusion
+{
+	static constexpr std::uint32_t TILE_WIDTH = 32;
+	static constexpr std::uint32_t TILE_HEIGHT = 16;
+
+	// resolution is rounded up to whole tiles
+	explicit SoftwareOcclusion(glm::uvec2 resolution = {256,128});
+
+	void clear();
+	// triangles are transformed and binned to tiles, nothing is drawn until rasterize()
+	// triangles crossing near plane are dropped, so occluders never hide more than they should
+	void addOccluder(std::span<const glm::vec3> positions,std::span<const std::uint32_t> indices,const glm::mat4& modelViewProj);
+	// coarse triangles generated by ModelFlagBit::OCCLUDERS
+	void addOccluder(const GLTFModel& model,const Primitive& prim,const glm::mat4& modelViewProj);
+	void rasterize();
+
+	// world space box as center and half extent, false if it's hidden or outside the screen
+	// safe to call from many threads after rasterize()
+	bool isVisible(const glm::vec3& center,const glm::vec3& extent,const glm::mat4& viewProj) const;
+	// removes occluded primitives from cullScene() output, order of the rest is kept
+	void cull(const SceneGraph& scene,const glm::mat4& viewProj,std::vector<VisiblePrimitive>& items) const;
+
+	glm::uvec2 resolution() const noexcept { return {m_width,m_height}; }
+	std::span<const float> depth() const noexcept { return m_depth; }
+	private:
+	// edge functions are >= 0 inside, depth is plane over screen
+	struct Triangle
+	{
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		float zA,zB,zC;
+		std::int32_t minX,minY,maxX,maxY;
+	};
+	void rasterizeTile(std::uint32_t tile);
+
+	std::uint32_t m_width{};
+	std::uint32_t m_height{};
+	std::uint32_t m_tilesX{};
+	std::uint32_t m_tilesY{};
+	std::vector<float> m_depth;
+	std::vector<float> m_tileMaxDepth; // farthest depth inside tile
+	std::vector<Triangle> m_triangles;
+	std::vector<std::vector<std::uint32_t>> m_bins; // triangles overlapping tile
+};
+}
@@ -3,6 +3,8 @@
 #include <BASIS/types.h>
 #include <BASIS/interfaces.h>
 
+#include <memory>
+#include <vector>
 #include <cstdint>
 
 #define GLM_ENABLE_EXPERIMENTAL
@@ -65,14 +67,13 @@ struct SamplerInfo
 // can be created standalone, but better use getSampler in Manager class
 struct Sampler : public IGLObject
 {
-	Sampler(const SamplerInfo& inf);
+	Sampler(const SamplerInfo& inf,std::string_view name="");
+	~Sampler();
 	Sampler& operator=(Sampler&&) noexcept;
 	Sampler(Sampler&&) noexcept;
 	const SamplerInfo& info() const noexcept { return m_info; }
 	private:
 	SamplerInfo m_info{};
-	Sampler(std::uint32_t id,const SamplerInfo& inf);
-	friend class Manager;
 };
 struct Texture : public IGLObject
 {	
@@ -82,6 +83,7 @@ struct Texture : public IGLObject
     Texture& operator=(Texture&& other) noexcept;
     ~Texture();
 	const TextureCreateInfo& info() const noexcept{ return m_info; }
+	std::uint64_t memorySize() const noexcept;
 
 	void update(const TextureUpdateInfo& info);
 	void mipmap();
@@ -97,9 +99,35 @@ struct Texture : public IGLObject
 
 // non-member texture-related functions
 
+// bytes of storage for all mips, layers and samples, BCn formats are counted in whole blocks
+std::uint64_t textureMemorySize(const TextureCreateInfo& info);
+
 Texture createTexture2D(glm::uvec2 size,Format fmt,std::string_view name="");
-Texture createTexture2DMip(glm::ivec2 size,Format fmt,std::uint32_t mipMaps,std::string_view name="");
+Texture createTexture2DMip(glm::uvec2 size,Format fmt,std::uint32_t mipMaps,std::string_view name="");
+
 
+// cpu side of loadTexture(): stbi decoding or ktx transcoding, doesn't touch gl
+// so it can run on worker threads, uploadImage() must be called on the thread owning context
+struct DecodedImage
+{
+	struct Region
+	{
+		std::uint32_t level{};
+		std::uint32_t face{};
+		glm::uvec3 extent{};
+		std::size_t offset{}; // from DecodedImage::data
+	};
+	TextureCreateInfo info{};
+	std::vector<Region> regions;
+	const std::uint8_t* data{};
+	// owns stbi/ktx allocation that data points into
+	std::shared_ptr<void> storage;
+	UploadType uploadType = UploadType::INFER_TYPE;
+};
+DecodedImage decodeImage(std::string_view filePath,Format fmt = Format::UNDEFINED);
+DecodedImage decodeImage(const std::byte* bytes,std::size_t size,Format fmt = Format::UNDEFINED);
+DecodedImage decodeImage(const std::uint8_t* bytes,std::size_t size,Format fmt = Format::UNDEFINED);
+Texture uploadImage(const DecodedImage& image,std::string_view name="");
 
 Texture loadTexture(std::string_view filePath,Format fmt = Format::UNDEFINED);
 Texture loadTexture(const std::byte* bytes,std::size_t size,Format fmt = Format::UNDEFINED);
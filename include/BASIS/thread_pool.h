@@ -0,0 +1,56 @@
+#pragma once
+
+#include <mutex>
+#include <queue>
+#include <memory>
+#include <future>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <condition_variable>
+
+namespace BASIS
+{
+// fixed amount of worker threads for cpu side work(asset decoding, culling etc.)
+// jobs must never touch gl, everything that needs context stays on the thread which owns it
+struct ThreadPool
+{
+	// 0 - use std::thread::hardware_concurrency()
+	explicit ThreadPool(std::uint32_t threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	ThreadPool(ThreadPool&&) = delete;
+	ThreadPool& operator=(ThreadPool&&) = delete;
+
+	template<typename F>
+	std::future<std::invoke_result_t<F>> submit(F&& func)
+	{
+		using R = std::invoke_result_t<F>;
+		auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(func));
+		auto future = task->get_future();
+		push([task]{ (*task)(); });
+		return future;
+	}
+	// calls func(i) for every i in [0,count) and blocks until all of them are done
+	// calling thread takes part in the work, so it's fine to call it from inside a job
+	// first exception thrown by func is rethrown after all chunks are finished
+	void parallelFor(std::size_t count,const std::function<void(std::size_t)>& func,std::size_t grain = 1);
+
+	std::uint32_t size() const noexcept { return static_cast<std::uint32_t>(m_workers.size()); }
+	private:
+	void push(std::function<void()>&& job);
+	void workerLoop();
+
+	std::vector<std::thread> m_workers;
+	std::queue<std::function<void()>> m_jobs;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	bool m_stop{false};
+};
+// lazily created pool shared by Manager and other subsystems
+ThreadPool& defaultThreadPool();
+}
@@ -2,7 +2,11 @@
 
 #include <BASIS/interfaces.h>
 
+#include <span>
 #include <chrono>
+#include <string>
+#include <vector>
+#include <string_view>
 
 struct CPUTimer : public ITimer
 {
@@ -22,6 +26,7 @@ struct CPUTimer : public ITimer
 private:
 	std::chrono::time_point<highClock> m_start{};
 };
+// waits for gpu on every call, which skews what it measures, GPUQueryPool doesn't
 struct GPUTimer : public ITimer
 {
 	GPUTimer() noexcept;
@@ -38,4 +43,86 @@ struct GPUTimer : public ITimer
 private:
 	std::uint64_t m_start{};
 	std::uint32_t m_query{};
-};
\ No newline at end of file
+};
+// gpu duration of named scope in nanoseconds
+struct GPUScopeTime
+{
+	std::string name;
+	std::uint64_t time{};
+	// raw GL_TIMESTAMP values and nesting depth inside frame
+	std::uint64_t start{};
+	std::uint64_t end{};
+	std::uint32_t depth{};
+};
+// timestamp query pairs for scopes of each frame, read back latency frames later
+// when they're long finished, so nothing waits or flushes
+// usage:
+//	pool.beginFrame();
+//	{
+//		auto scope = pool.scope("shadows");
+//		...
+//	}
+//	pool.endFrame();
+//	pool.getTime("shadows"); // from latency frames ago
+struct GPUQueryPool
+{
+	static constexpr std::uint32_t NO_SCOPE = ~0u;
+	// tagged with frame scope was begun in, scope still open when its slot is reused
+	// is ignored by end(), tags are unique across pools
+	struct ScopeId
+	{
+		std::uint32_t idx{NO_SCOPE};
+		std::uint32_t slot{};
+		std::uint64_t frame{};
+	};
+	struct Scope
+	{
+		Scope(GPUQueryPool& pool,ScopeId id) noexcept : m_pool(&pool),m_id(id) {}
+		~Scope() { if(m_pool) m_pool->end(m_id); }
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	private:
+		GPUQueryPool* m_pool;
+		ScopeId m_id;
+	};
+	explicit GPUQueryPool(std::uint32_t maxScopes = 64,std::uint32_t latency = 3);
+	~GPUQueryPool() noexcept;
+
+	GPUQueryPool(const GPUQueryPool&) = delete;
+	GPUQueryPool& operator=(const GPUQueryPool&) = delete;
+
+	GPUQueryPool(GPUQueryPool&& other) noexcept = default;
+	GPUQueryPool& operator=(GPUQueryPool&& other) noexcept;
+
+	// collects results of frame which used the same slot, if gpu is still behind they're dropped
+	// returns true if results() were replaced
+	bool beginFrame();
+	void endFrame();
+
+	// scopes may nest and stay open across endFrame(), scopes past maxScopes per frame aren't measured
+	ScopeId begin(std::string_view name);
+	void end(const ScopeId& scope);
+	Scope scope(std::string_view name) { return Scope(*this,begin(name)); }
+
+	// latest resolved frame in begin() order
+	std::span<const GPUScopeTime> results() const noexcept { return m_results; }
+	// 0 if scope wasn't resolved
+	std::uint64_t getTime(std::string_view name) const noexcept;
+private:
+	struct Frame
+	{
+		std::vector<std::uint32_t> queries; // begin,end per scope
+		std::vector<std::string> names;
+		std::vector<std::uint32_t> depths;
+		std::uint32_t used{};
+		std::uint64_t frame{}; // tag of frame which used slot last
+	};
+	void release() noexcept;
+
+	std::vector<Frame> m_frames;
+	std::vector<GPUScopeTime> m_results;
+	std::uint32_t m_maxScopes{};
+	std::uint32_t m_frame{};
+	std::uint32_t m_depth{};
+	bool m_inFrame{false};
+};
@@ -156,6 +156,27 @@ enum class MaskFlagBit : std::uint32_t
 };
 BASIS_DECLARE_FLAG_TYPE(MaskFlags,MaskFlagBit,std::uint32_t);
 
+// glMemoryBarrier
+enum class MemoryBarrierBit : std::uint32_t
+{
+	VERTEX_ATTRIB_ARRAY	= 0x00000001,
+	ELEMENT_ARRAY		= 0x00000002,
+	UNIFORM				= 0x00000004,
+	TEXTURE_FETCH		= 0x00000008,
+	SHADER_IMAGE_ACCESS	= 0x00000020,
+	COMMAND				= 0x00000040,
+	PIXEL_BUFFER		= 0x00000080,
+	TEXTURE_UPDATE		= 0x00000100,
+	BUFFER_UPDATE		= 0x00000200,
+	FRAMEBUFFER			= 0x00000400,
+	TRANSFORM_FEEDBACK	= 0x00000800,
+	ATOMIC_COUNTER		= 0x00001000,
+	SHADER_STORAGE		= 0x00002000,
+	QUERY_BUFFER		= 0x00008000,
+	ALL					= 0xFFFFFFFF
+};
+BASIS_DECLARE_FLAG_TYPE(MemoryBarrierFlags,MemoryBarrierBit,std::uint32_t);
+
 enum class CullMode : std::uint32_t
 {
 	NONE = 0,
@@ -317,6 +338,25 @@ enum class Factor : std::uint32_t
 	ONE_MINUS_CONSTANT_COLOR = 0x8002,
 	ONE_MINUS_CONSTANT_ALPHA = 0x8004,
 };
+enum class BlendOp : std::uint32_t
+{
+	ADD = 0x8006,
+	MIN = 0x8007,
+	MAX = 0x8008,
+	SUBTRACT = 0x800A,
+	REVERSE_SUBTRACT = 0x800B,
+};
+enum class StencilOp : std::uint32_t
+{
+	KEEP = 0x1E00,
+	ZERO = 0x0000,
+	REPLACE = 0x1E01,
+	INVERT = 0x150A,
+	INCREMENT_CLAMP = 0x1E02,
+	DECREMENT_CLAMP = 0x1E03,
+	INCREMENT_WRAP = 0x8507,
+	DECREMENT_WRAP = 0x8508,
+};
 enum class ShaderType : std::uint32_t 
 {
 	VERTEX          = 0x8B31, 
@@ -391,20 +431,20 @@ enum class Format : std::uint32_t
 	RGBA8UI = fmtCtor(false, 4, UploadFormat::RGBA_INTEGER, false, 0x8D7C), 
 	RGBA16I = fmtCtor(false, 4, UploadFormat::RGBA_INTEGER, false, 0x8D88),  
 	RGBA32I = fmtCtor(false, 4, UploadFormat::RGBA_INTEGER, false, 0x8D82),  
-	R8_SNORM = fmtCtor(false, 1, UploadFormat::RED, false, 0x8F94),  
+	R8_SNORM = fmtCtor(true, 1, UploadFormat::RED, false, 0x8F94),  
 	R3_G3_B2 = fmtCtor(true, 3, UploadFormat::RGB, false, 0x2A10),  
 	RGB10_A2 = fmtCtor(true, 4, UploadFormat::RGBA, false, 0x8059),
 	RGBA16UI = fmtCtor(false, 4, UploadFormat::RGBA_INTEGER, false, 0x8D76),
 	RGBA32UI = fmtCtor(false, 4, UploadFormat::RGBA_INTEGER, false, 0x8D70),  
-	R16_SNORM = fmtCtor(false, 1, UploadFormat::RED, false, 0x8F98), 
-	RG8_SNORM = fmtCtor(false, 2, UploadFormat::RG, false, 0x8F95), 
-	RGB8_SNORM = fmtCtor(false, 3, UploadFormat::RGB, false, 0x8F96),  
+	R16_SNORM = fmtCtor(true, 1, UploadFormat::RED, false, 0x8F98), 
+	RG8_SNORM = fmtCtor(true, 2, UploadFormat::RG, false, 0x8F95), 
+	RGB8_SNORM = fmtCtor(true, 3, UploadFormat::RGB, false, 0x8F96),  
 	RGB10_A2UI = fmtCtor(false, 4, UploadFormat::RGBA_INTEGER, false, 0x906F), 
-	RGB16_SNORM = fmtCtor(false, 3, UploadFormat::RGB, false, 0x8F9A),  
+	RGB16_SNORM = fmtCtor(true, 3, UploadFormat::RGB, false, 0x8F9A),  
 	SRGBA8 = fmtCtor(true, 4, UploadFormat::RGBA, false, 0x8C43),  
-	RG16_SNORM = fmtCtor(false, 2, UploadFormat::RG, false, 0x8F99),  
-	RGBA8_SNORM = fmtCtor(false, 4, UploadFormat::RGBA, false, 0x8F97),
-	RGBA16_SNORM = fmtCtor(false, 4, UploadFormat::RGBA, false, 0x8F9B), 
+	RG16_SNORM = fmtCtor(true, 2, UploadFormat::RG, false, 0x8F99),  
+	RGBA8_SNORM = fmtCtor(true, 4, UploadFormat::RGBA, false, 0x8F97),
+	RGBA16_SNORM = fmtCtor(true, 4, UploadFormat::RGBA, false, 0x8F9B), 
 	DEPTH_COMPONENT16 = fmtCtor(true, 1, UploadFormat::DEPTH_COMPONENT, false, 0x81A5),  
 	DEPTH_COMPONENT24 = fmtCtor(true, 1, UploadFormat::DEPTH_COMPONENT, false, 0x81A6),
 	DEPTH_COMPONENT32 = fmtCtor(true, 1, UploadFormat::DEPTH_COMPONENT, false, 0x81A7),  
@@ -434,6 +474,15 @@ enum class IndexType : std::uint32_t
 	UBYTE  = 0x1401,
 	USHORT = 0x1403, 
 };
+constexpr std::uint32_t indexSize(IndexType type)
+{
+	switch(type)
+	{
+		case IndexType::UBYTE:	return 1;
+		case IndexType::USHORT:	return 2;
+		default:				return 4;
+	}
+}
 constexpr std::uint32_t getFormatType(Format F)
 {
 	using enum Format;
@@ -459,6 +508,9 @@ constexpr std::uint32_t getFormatType(Format F)
 	case RGB8_SNORM:
 	case RGBA8_SNORM:
 		return 0x1400; 
+	case R16:
+	case RG16:
+	case RGBA16:
 	case R16UI:
 	case RG16UI:
 	case RGB16UI:
@@ -473,6 +525,10 @@ constexpr std::uint32_t getFormatType(Format F)
 	case RG16I:
 	case RGB16I:
 	case RGBA16I:
+	case R16_SNORM:
+	case RG16_SNORM:
+	case RGB16_SNORM:
+	case RGBA16_SNORM:
 		return 0x1402;
 	case R32I:
 	case RG32I:
@@ -577,6 +633,8 @@ requires is_any_same<T,
 					IndexType,
 					Filter,
 					Factor,
+					BlendOp,
+					StencilOp,
 					Cap>
 std::uint32_t enumToGL(T e)
 {
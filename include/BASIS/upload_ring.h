@@ -0,0 +1,58 @@
+#pragma once
+
+#include <BASIS/buffer.h>
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace BASIS
+{
+struct Renderer;
+
+// piece of UploadRing, offset and size go straight to Renderer::bindUniformBuffer()/bindStorageBuffer()
+struct UploadAllocation
+{
+	std::byte* data{};
+	std::uint64_t offset{};
+	std::uint64_t size{};
+};
+// per frame memory for uniforms and other data rewritten every frame
+// single persistently and coherently mapped buffer split into one region per Renderer frame slot,
+// region of Renderer::frameIndex() isn't read by gpu anymore once Renderer::beginFrame() returned,
+// so writes are plain memcpy without driver copies or stalls
+// usage:
+//	renderer.beginFrame();
+//	ring.beginFrame();
+//	auto alloc = ring.upload(objectUniforms);
+//	renderer.bindUniformBuffer(ring.buffer(),0,alloc.size,alloc.offset);
+struct UploadRing
+{
+	// allocations are aligned to both uniform and storage buffer offset alignment of renderer's context
+	// there's region for every possible slot, so Renderer::setFramesInFlight() doesn't invalidate ring
+	UploadRing(const Renderer& renderer,std::size_t frameSize);
+
+	UploadRing(UploadRing&&) noexcept = default;
+	UploadRing& operator=(UploadRing&&) noexcept = default;
+
+	// inside Renderer frame only, starts over in region of current frame slot
+	void beginFrame();
+
+	// frameSize bytes per frame at most, overflow is a bug and returns empty allocation
+	UploadAllocation allocate(std::size_t size);
+	UploadAllocation upload(ByteSpan bytes);
+
+	const Buffer& buffer() const noexcept { return m_buffer; }
+	std::size_t frameSize() const noexcept { return m_frameSize; }
+	std::size_t frameUsage() const noexcept { return m_offset; }
+	private:
+	const Renderer* m_renderer{};
+	Buffer m_buffer;
+	std::byte* m_mapped{};
+	std::size_t m_frameSize{};
+	std::size_t m_alignment{};
+	std::size_t m_frame{};
+	std::size_t m_offset{};
+	std::uint64_t m_frameNumber{~0ull}; // Renderer::frameNumber() of last beginFrame()
+};
+}
@@ -2,8 +2,12 @@
 
 #include <BASIS/app.h>
 
+#include <tuple>
+#include <chrono>
 #include <fstream>
 #include <filesystem>
+#include <string_view>
+#include <utility>
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/transform.hpp>
@@ -11,6 +15,99 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
+#if BASIS_EGL
+	#include <EGL/egl.h>
+	#include <EGL/eglext.h>
+#endif
+
+namespace
+{
+#if BASIS_EGL
+bool hasExtension(const char* extensions,std::string_view name)
+{
+	const std::string_view list = extensions ? extensions : "";
+	for(std::size_t pos{};(pos = list.find(name,pos)) != std::string_view::npos;pos += name.size())
+	{
+		// names are separated by spaces, prefixes of longer names don't count
+		const auto end = pos + name.size();
+		if((pos == 0 || list[pos - 1] == ' ') && (end == list.size() || list[end] == ' ')) return true;
+	}
+	return false;
+}
+EGLDisplay getHeadlessDisplay()
+{
+	if(hasExtension(eglQueryString(EGL_NO_DISPLAY,EGL_EXTENSIONS),"EGL_MESA_platform_surfaceless"))
+	{
+		const auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+		if(getPlatformDisplay) return getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,EGL_DEFAULT_DISPLAY,nullptr);
+	}
+	// device platforms(e.g. NVIDIA) still allow surfaceless contexts on default display
+	return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+// returns current context without any surface
+std::pair<EGLDisplay,EGLContext> createHeadlessContext(bool debug)
+{
+	EGLDisplay display = getHeadlessDisplay();
+	EGLint major{},minor{};
+	if(display == EGL_NO_DISPLAY || !eglInitialize(display,&major,&minor))
+	{
+		throw BASIS::ApplicationException("EGL initialization failure[",eglGetError(),']');
+	}
+	const char* extensions = eglQueryString(display,EGL_EXTENSIONS);
+	if(!hasExtension(extensions,"EGL_KHR_surfaceless_context") || !eglBindAPI(EGL_OPENGL_API))
+	{
+		eglTerminate(display);
+		throw BASIS::ApplicationException("EGL display doesn't support surfaceless OpenGL contexts");
+	}
+	EGLConfig config = EGL_NO_CONFIG_KHR;
+	if(!hasExtension(extensions,"EGL_KHR_no_config_context"))
+	{
+		const EGLint configAttribs[] = {EGL_RENDERABLE_TYPE,EGL_OPENGL_BIT,EGL_SURFACE_TYPE,EGL_PBUFFER_BIT,EGL_NONE};
+		EGLint count{};
+		if(!eglChooseConfig(display,configAttribs,&config,1,&count) || count == 0)
+		{
+			eglTerminate(display);
+			throw BASIS::ApplicationException("No EGL config for OpenGL");
+		}
+	}
+	// llvmpipe stops at 4.5
+	EGLContext context = EGL_NO_CONTEXT;
+	for(const EGLint minorVersion : {6,5})
+	{
+		const EGLint contextAttribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION,4,
+			EGL_CONTEXT_MINOR_VERSION,minorVersion,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK,EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_CONTEXT_OPENGL_DEBUG,debug ? EGL_TRUE : EGL_FALSE,
+			EGL_NONE};
+		context = eglCreateContext(display,config,EGL_NO_CONTEXT,contextAttribs);
+		if(context != EGL_NO_CONTEXT) break;
+	}
+	if(context == EGL_NO_CONTEXT || !eglMakeCurrent(display,EGL_NO_SURFACE,EGL_NO_SURFACE,context))
+	{
+		const auto error = eglGetError();
+		if(context != EGL_NO_CONTEXT) eglDestroyContext(display,context);
+		eglTerminate(display);
+		throw BASIS::ApplicationException("EGL context creation failure[",error,']');
+	}
+	return {display,context};
+}
+bool hasGLExtension(std::string_view name)
+{
+	std::int32_t count{};
+	glGetIntegerv(GL_NUM_EXTENSIONS,&count);
+	for(std::int32_t i{};i < count;i++)
+	{
+		if(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS,i)) == name) return true;
+	}
+	return false;
+}
+GLADapiproc getEglProcAddress(const char* name)
+{
+	return reinterpret_cast<GLADapiproc>(eglGetProcAddress(name));
+}
+#endif
+}
 namespace BASIS
 {
 std::string App::loadFile(std::string_view path)
@@ -22,73 +119,126 @@ std::string App::loadFile(std::string_view path)
 	}
 	throw FileException("File not found:",path);
 }
-App::App(const AppCreateInfo& info)
+App::App(const AppCreateInfo& info) : m_frameLimit{info.frameLimit}
 {
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-	glfwWindowHint(GLFW_SRGB_CAPABLE, info.flags & AppFlags::SRGB);
-	glfwWindowHint(GLFW_DECORATED, !(info.flags & AppFlags::UNDECORATED));
-	glfwWindowHint(GLFW_RESIZABLE, !(info.flags & AppFlags::UNRESIZABLE));
-	glfwWindowHint(GLFW_DOUBLEBUFFER, info.flags & AppFlags::DOUBLEBUFFER);
-	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT , info.flags & AppFlags::DEBUG);
-	glfwWindowHint(GLFW_TRANSPARENT_FRAMEBUFFER, info.flags & AppFlags::TRANSPARENT);
-	
-	m_win = glfwCreateWindow(info.width,info.height,info.name.data(),0,0);
-	
-	if(!m_win)
-	{
-		const char* errorMsg{};
-		glfwGetError(&errorMsg);
-		glfwTerminate();
-		throw ApplicationException("Window creation failure[",errorMsg,']');
-	}
-	glfwMakeContextCurrent(m_win);
-	if (!gladLoadGL(glfwGetProcAddress))
-	{
-		throw ApplicationException("Glad initialization failure");
-	}
 	assert(info.width != 0 && info.height != 0 && "invalid width or height");
 	m_width  = info.width;
 	m_height = info.height;
+	if(info.flags & AppFlags::HEADLESS)
+	{
+		#if BASIS_EGL
+		std::tie(m_eglDisplay,m_eglContext) = createHeadlessContext(info.flags & AppFlags::DEBUG);
+		if (!gladLoadGL(getEglProcAddress))
+		{
+			// destructor doesn't run for throwing constructor
+			eglMakeCurrent(m_eglDisplay,EGL_NO_SURFACE,EGL_NO_SURFACE,EGL_NO_CONTEXT);
+			eglDestroyContext(m_eglDisplay,m_eglContext);
+			eglTerminate(m_eglDisplay);
+			throw ApplicationException("Glad initialization failure");
+		}
+		// 4.5 contexts may still have indirect count draws through GL_ARB_indirect_parameters
+		// eglGetProcAddress returns entry points of unsupported extensions too, so extension is checked first
+		if(!glMultiDrawArraysIndirectCount && !hasGLExtension("GL_ARB_indirect_parameters"))
+		{
+			printf("GL_ARB_indirect_parameters is unsupported, Renderer::draw*IndirectCount() can't be used\n");
+		}
+		else if(!glMultiDrawArraysIndirectCount)
+		{
+			glad_glMultiDrawArraysIndirectCount = reinterpret_cast<PFNGLMULTIDRAWARRAYSINDIRECTCOUNTPROC>(getEglProcAddress("glMultiDrawArraysIndirectCountARB"));
+			glad_glMultiDrawElementsIndirectCount = reinterpret_cast<PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC>(getEglProcAddress("glMultiDrawElementsIndirectCountARB"));
+		}
+		#else
+		throw ApplicationException("HEADLESS requires BASIS_EGL build option");
+		#endif
+		
+		FramebufferCreateInfo offscreen{};
+		offscreen.colorAttachments.push_back(createTexture2D(
+			{info.width,info.height},
+			(info.flags & AppFlags::SRGB) ? Format::SRGBA8 : Format::RGBA8,
+			"offscreen color"));
+		offscreen.depthAttachment = createTexture2D({info.width,info.height},Format::DEPTH24_STENCIL8,"offscreen depth");
+		m_offscreen.emplace(std::move(offscreen),"offscreen");
+		// stencil like window's default framebuffer
+		glNamedFramebufferTexture(m_offscreen->id(),GL_DEPTH_STENCIL_ATTACHMENT,m_offscreen->info().depthAttachment->id(),0);
+		setDefaultFramebuffer(m_offscreen->id());
+		glBindFramebuffer(GL_FRAMEBUFFER,m_offscreen->id());
+		glViewport(0,0,info.width,info.height);
+	}
+	else
+	{
+		glfwInit();
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+		glfwWindowHint(GLFW_SRGB_CAPABLE, info.flags & AppFlags::SRGB);
+		glfwWindowHint(GLFW_DECORATED, !(info.flags & AppFlags::UNDECORATED));
+		glfwWindowHint(GLFW_RESIZABLE, !(info.flags & AppFlags::UNRESIZABLE));
+		glfwWindowHint(GLFW_DOUBLEBUFFER, info.flags & AppFlags::DOUBLEBUFFER);
+		glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT , info.flags & AppFlags::DEBUG);
+		glfwWindowHint(GLFW_TRANSPARENT_FRAMEBUFFER, info.flags & AppFlags::TRANSPARENT);
 	
-	// default callbacks, can be adjusted by inheriting from App class later
-	glfwSetWindowUserPointer(m_win,reinterpret_cast<void*>(this));
+		m_win = glfwCreateWindow(info.width,info.height,info.name.data(),0,0);
 	
-	glfwSetKeyCallback(m_win, [](GLFWwindow* window, int key,int, int action,int) -> void
-	{
-		App* app = static_cast<App*>(glfwGetWindowUserPointer(window));
-		if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) glfwSetWindowShouldClose(window, GL_TRUE);
-		if (key == GLFW_KEY_GRAVE_ACCENT && action == GLFW_PRESS)
+		if(!m_win)
+		{
+			const char* errorMsg{};
+			glfwGetError(&errorMsg);
+			glfwTerminate();
+			throw ApplicationException("Window creation failure[",errorMsg,']');
+		}
+		glfwMakeContextCurrent(m_win);
+		if (!gladLoadGL(glfwGetProcAddress))
 		{
-			app->active = !app->active;
-			glfwSetInputMode(window, GLFW_CURSOR, app->active ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_DISABLED);
+			throw ApplicationException("Glad initialization failure");
 		}
-		if(key == GLFW_KEY_LEFT_SHIFT && action == GLFW_PRESS) app->m_camera.speed = 18.f;
-		if(key == GLFW_KEY_LEFT_SHIFT && action == GLFW_RELEASE) app->m_camera.speed = 9.f;
-	});
 	
-	glfwSetCursorPosCallback(m_win, [](GLFWwindow* window, double X, double Y) -> void
-	{
-		App* app = static_cast<App*>(glfwGetWindowUserPointer(window));
+		// default callbacks, can be adjusted by inheriting from App class later
+		glfwSetWindowUserPointer(m_win,reinterpret_cast<void*>(this));
+	
+		glfwSetKeyCallback(m_win, [](GLFWwindow* window, int key,int, int action,int) -> void
+		{
+			App* app = static_cast<App*>(glfwGetWindowUserPointer(window));
+			if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) glfwSetWindowShouldClose(window, GL_TRUE);
+			if (key == GLFW_KEY_GRAVE_ACCENT && action == GLFW_PRESS)
+			{
+				app->active = !app->active;
+				glfwSetInputMode(window, GLFW_CURSOR, app->active ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_DISABLED);
+			}
+			if(key == GLFW_KEY_F1 && action == GLFW_PRESS)
+			{
+				// profiler costs nothing while hidden
+				app->m_showProfiler = !app->m_showProfiler;
+				defaultProfiler().setEnabled(app->m_showProfiler);
+			}
+			if(key == GLFW_KEY_LEFT_SHIFT && action == GLFW_PRESS) app->m_camera.speed = 18.f;
+			if(key == GLFW_KEY_LEFT_SHIFT && action == GLFW_RELEASE) app->m_camera.speed = 9.f;
+		});
+	
+		glfwSetCursorPosCallback(m_win, [](GLFWwindow* window, double X, double Y) -> void
+		{
+			App* app = static_cast<App*>(glfwGetWindowUserPointer(window));
 
-		app->m_cursorOffs += glm::dvec2{X - app->m_lastCursorPos.x, app->m_lastCursorPos.y - Y};
-		app->m_lastCursorPos = {X, Y};
-	});
-	glfwSetFramebufferSizeCallback(m_win, [](GLFWwindow* window,int w,int h) -> void
-	{
-		App* app = static_cast<App*>(glfwGetWindowUserPointer(window));
-		app->m_width = w;
-		app->m_height = h;
-		glViewport(0, 0, w, h);
-	});
+			app->m_cursorOffs += glm::dvec2{X - app->m_lastCursorPos.x, app->m_lastCursorPos.y - Y};
+			app->m_lastCursorPos = {X, Y};
+		});
+		glfwSetFramebufferSizeCallback(m_win, [](GLFWwindow* window,int w,int h) -> void
+		{
+			App* app = static_cast<App*>(glfwGetWindowUserPointer(window));
+			app->m_width = w;
+			app->m_height = h;
+			glViewport(0, 0, w, h);
+		});
+		if(info.flags & AppFlags::NO_VSYNC)
+		{
+			glfwSwapInterval(0);
+		}
+	}
 	
 	if(info.flags & AppFlags::DEBUG)
 	{
-	Renderer::enableCapability(Cap::DEBUG_OUTPUT);
-	Renderer::enableCapability(Cap::DEBUG_OUTPUT_SYNCHRONOUS);
+	glEnable(GL_DEBUG_OUTPUT);
+	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
 	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
 	using ui = unsigned int;
 	glDebugMessageCallback([](ui src, ui type, ui id, ui severity, int, const char* msg, const void*) -> void
@@ -148,52 +298,84 @@ App::App(const AppCreateInfo& info)
 		printf("[%d | %s | %s | %s] %s\n",id,severityOut,typeOut,srcOut,msg);
 	}, nullptr);
 	}
-	if(info.flags & AppFlags::NO_VSYNC)
-	{
-		glfwSwapInterval(0);
-	}
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
     
-	ImGui_ImplGlfw_InitForOpenGL(m_win, true);
+	if(m_win) ImGui_ImplGlfw_InitForOpenGL(m_win, true);
 	ImGui_ImplOpenGL3_Init();
 }
 
 void App::run()
 {
+	using clock = std::chrono::steady_clock;
+	const auto start = clock::now();
 	double delta{},lFrame{};
-	while (!glfwWindowShouldClose(m_win))
+	for(std::uint64_t frame{};!m_closeRequested && (m_frameLimit == 0 || frame < m_frameLimit);frame++)
 	{	
-		const auto curTime = glfwGetTime();
+		if(m_win && glfwWindowShouldClose(m_win)) break;
+		const auto curTime = m_win ? glfwGetTime() : std::chrono::duration<double>(clock::now() - start).count();
 		delta  = curTime - lFrame;
 		lFrame = curTime;
+		defaultProfiler().newFrame();
 		
 		updateCamera(delta);
-		
-		render(delta);
+		{
+			BASIS_PROFILE_GPU_ZONE("App::render");
+			render(delta);
+		}
 		ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
+		if(m_win) ImGui_ImplGlfw_NewFrame();
+		else
+		{
+			auto& io = ImGui::GetIO();
+			io.DisplaySize = ImVec2(static_cast<float>(m_width),static_cast<float>(m_height));
+			io.DeltaTime = static_cast<float>(delta);
+		}
         ImGui::NewFrame();
 		gui(delta);
+		if(m_showProfiler) defaultProfiler().gui();
 		
 		ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 		
-		glfwSwapBuffers(m_win);
-		glfwPollEvents();
+		if(m_win)
+		{
+			glfwSwapBuffers(m_win);
+			glfwPollEvents();
+		}
 	}
 }
 App::~App()
 {
+	defaultProfiler().releaseQueries();
+	if(m_offscreen)
+	{
+		setDefaultFramebuffer(0);
+		m_offscreen.reset();
+	}
+	// objects of derived app are gone by now, whatever is left leaked
+	reportLiveGPUObjects();
 	ImGui_ImplOpenGL3_Shutdown();
-	ImGui_ImplGlfw_Shutdown();
+	if(m_win) ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
-	glfwDestroyWindow(m_win);
-	glfwTerminate();
+	if(m_win)
+	{
+		glfwDestroyWindow(m_win);
+		glfwTerminate();
+	}
+	#if BASIS_EGL
+	if(m_eglDisplay)
+	{
+		eglMakeCurrent(m_eglDisplay,EGL_NO_SURFACE,EGL_NO_SURFACE,EGL_NO_CONTEXT);
+		eglDestroyContext(m_eglDisplay,m_eglContext);
+		eglTerminate(m_eglDisplay);
+	}
+	#endif
 }
 
 void App::updateCamera(double delta)
 {
+	if(!m_win) return;
 	glfwSetInputMode(m_win, GLFW_CURSOR, active ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_DISABLED);
 	if (!active)
     {
@@ -219,13 +401,4 @@ void App::updateCamera(double delta)
     m_cursorOffs = {};
 }
 
-glm::vec3 Camera::forward() const
-{
-	return glm::vec3{std::cos(pitch) * std::cos(yaw), std::sin(pitch), std::cos(pitch) * std::sin(yaw)};
-}
-glm::mat4 Camera::view() const
-{
-	return glm::lookAt(pos, pos + forward(), glm::vec3(0, 1, 0));
-}
-
 }
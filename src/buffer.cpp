@@ -1,6 +1,8 @@
 
 #include <BASIS/types.h>
 #include <BASIS/buffer.h>
+#include <BASIS/context.h>
+#include <BASIS/gpu_memory.h>
 
 #include <cassert>
 #include <utility>
@@ -26,13 +28,22 @@ Buffer::Buffer(const void* data,std::size_t size,std::uint32_t flags,std::string
 	glCreateBuffers(1, &m_id);
 	glObjectLabel(GL_BUFFER,m_id,name.size(),name.data());
 	glNamedBufferStorage(m_id, m_size, data, flags);
+	trackGPUObject(GPUResource::BUFFER,m_id,m_size,name);
 }
 
-void* Buffer::map(AccessFlags flags) noexcept
+void* Buffer::map(AccessFlags flags)
 {
+	flushBatchedDraws();
 	m_mappedMem = glMapNamedBuffer(m_id,static_cast<std::uint32_t>(flags));
 	return m_mappedMem;
 }
+void* Buffer::mapPersistent() noexcept
+{
+	using enum BufferFlags;
+	assert((m_flags & PERSISTENT) && "Buffer wasn't created with PERSISTENT flag");
+	m_mappedMem = glMapNamedBufferRange(m_id,0,m_size,m_flags & (READ | WRITE | PERSISTENT | COHERENT));
+	return m_mappedMem;
+}
 void Buffer::unmap() noexcept
 {
 	if (m_mappedMem)
@@ -43,7 +54,10 @@ void Buffer::unmap() noexcept
 }
 Buffer::~Buffer()
 {
+	if(!m_id) return;
 	glDeleteBuffers(1, &m_id);
+	untrackGPUObject(GPUResource::BUFFER,m_id);
+	notifyObjectDeleted(GLObjectType::BUFFER,m_id);
 }
 Buffer& Buffer::operator=(Buffer&& other) noexcept
 {
@@ -52,13 +66,16 @@ Buffer& Buffer::operator=(Buffer&& other) noexcept
 	return *new(this) Buffer(std::move(other));
 }
 Buffer::Buffer(Buffer&& other) noexcept :
-m_size{other.m_size}
+m_size{other.m_size},
+m_flags{other.m_flags},
+m_mappedMem{std::exchange(other.m_mappedMem,nullptr)}
 {
 	m_id = std::exchange(other.m_id,0);
 }
-void Buffer::fill(std::uint32_t value,std::size_t offset,std::size_t size) noexcept
+void Buffer::fill(std::uint32_t value,std::size_t offset,std::size_t size)
 {
 	const auto actualSize = size == WHOLE_BUFFER ? m_size : size;
+	flushBatchedDraws();
     assert(actualSize % 4 == 0 && "Size must be a multiple of 4 bytes");
     glClearNamedBufferSubData(m_id,
                               GL_R32UI,
@@ -68,14 +85,17 @@ void Buffer::fill(std::uint32_t value,std::size_t offset,std::size_t size) noexc
                               GL_UNSIGNED_INT,
                               &value);
 }
-void Buffer::invalidate(std::size_t offset,std::size_t size) noexcept
+void Buffer::invalidate(std::size_t offset,std::size_t size)
 {
+	flushBatchedDraws();
 	glInvalidateBufferSubData(m_id,offset,size == WHOLE_BUFFER ? m_size : size);
 }
-void Buffer::update(ByteSpan bytes,std::size_t offs) noexcept
+void Buffer::update(ByteSpan bytes,std::size_t offs)
 {
 	assert((m_flags & BufferFlags::DYNAMIC) && "Can't update non-dynamic buffers");
 	assert(bytes.size_bytes() + offs <= m_size && "Buffer overflow");
+	flushBatchedDraws();
+	notifyBufferUpload(bytes.size_bytes());
 	glNamedBufferSubData(m_id,offs,bytes.size_bytes(),bytes.data());
 }
 
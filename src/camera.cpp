@@ -0,0 +1,22 @@
+#include <BASIS/camera.h>
+
+#include <cmath>
+
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/matrix_clip_space.hpp>
+
+namespace BASIS
+{
+glm::vec3 Camera::forward() const
+{
+	return glm::vec3{std::cos(pitch) * std::cos(yaw), std::sin(pitch), std::cos(pitch) * std::sin(yaw)};
+}
+glm::mat4 Camera::view() const
+{
+	return glm::lookAt(pos, pos + forward(), glm::vec3(0, 1, 0));
+}
+glm::mat4 Camera::projection(float aspect) const
+{
+	return glm::perspective(fov, aspect, zNear, zFar);
+}
+}
@@ -0,0 +1,176 @@
+#include <BASIS/types.h>
+#include <BASIS/buffer.h>
+#include <BASIS/pipeline.h>
+#include <BASIS/rendering.h>
+#include <BASIS/command_list.h>
+#include <BASIS/profiler.h>
+
+#include <array>
+#include <cassert>
+#include <utility>
+#include <numeric>
+#include <algorithm>
+
+namespace
+{
+constexpr std::uint64_t depthBits = 24;
+constexpr std::uint64_t depthMask = (1ull << depthBits) - 1;
+
+std::uint64_t quantizeDepth(float depth)
+{
+	return static_cast<std::uint64_t>(std::clamp(depth,0.f,1.f) * static_cast<float>(depthMask));
+}
+}
+namespace BASIS
+{
+std::uint64_t opaqueSortKey(std::uint8_t layer,const Pipeline& pipeline,std::uint16_t material,float depth)
+{
+	return std::uint64_t{layer} << 56 |
+		std::uint64_t{pipeline.id() & 0xFFFF} << 40 |
+		std::uint64_t{material} << 24 |
+		quantizeDepth(depth);
+}
+std::uint64_t translucentSortKey(std::uint8_t layer,const Pipeline& pipeline,std::uint16_t material,float depth)
+{
+	return std::uint64_t{layer} << 56 |
+		(depthMask - quantizeDepth(depth)) << 32 |
+		std::uint64_t{pipeline.id() & 0xFFFF} << 16 |
+		material;
+}
+void CommandList::reserve(std::size_t count)
+{
+	m_packets.reserve(count);
+	m_order.reserve(count);
+}
+void CommandList::clear() noexcept
+{
+	m_packets.clear();
+	m_order.clear();
+}
+void CommandList::draw(const DrawPacket& packet)
+{
+	assert(packet.pipeline && packet.vertexBuffer && packet.idxBuffer);
+	m_order.push_back(static_cast<std::uint32_t>(m_packets.size()));
+	m_packets.push_back(packet);
+}
+void CommandList::append(const CommandList& other)
+{
+	const auto base = static_cast<std::uint32_t>(m_packets.size());
+	m_packets.insert(m_packets.end(),other.m_packets.begin(),other.m_packets.end());
+	for(std::size_t i{};i < other.m_packets.size();i++) m_order.push_back(base + static_cast<std::uint32_t>(i));
+}
+void CommandList::draw(
+	std::uint64_t key,
+	const Pipeline& pipeline,
+	const GLTFModel& model,
+	const Primitive& primitive,
+	std::uint32_t firstInstance)
+{
+	draw(DrawPacket{
+		.key = key,
+		.pipeline = &pipeline,
+		.vertexBuffer = &model.vertices(),
+		.idxBuffer = &model.indices(),
+		.vertexStride = model.vertexStride,
+		.idxType = primitive.idxType,
+		.idxCount = primitive.idxCount,
+		.firstIdx = primitive.firstIdx,
+		.vertexOffset = primitive.vertexOffset,
+		.firstInstance = firstInstance
+	});
+}
+void CommandList::sort()
+{
+	const std::size_t count = m_packets.size();
+	m_keys.resize(count);
+	m_keysTmp.resize(count);
+	m_orderTmp.resize(count);
+	std::iota(m_order.begin(),m_order.end(),0u);
+	for(std::size_t i{};i < count;i++) m_keys[i] = m_packets[i].key;
+
+	for(std::uint32_t shift{};shift < 64;shift += 8)
+	{
+		std::array<std::uint32_t,256> histogram{};
+		for(auto k : m_keys) histogram[(k >> shift) & 0xFF]++;
+		// every key has the same byte, pass wouldn't change anything
+		if(std::ranges::find(histogram,static_cast<std::uint32_t>(count)) != histogram.end()) continue;
+		std::uint32_t offset{};
+		for(auto& h : histogram) offset += std::exchange(h,offset);
+		for(std::size_t i{};i < count;i++)
+		{
+			const auto dst = histogram[(m_keys[i] >> shift) & 0xFF]++;
+			m_keysTmp[dst] = m_keys[i];
+			m_orderTmp[dst] = m_order[i];
+		}
+		m_keys.swap(m_keysTmp);
+		m_order.swap(m_orderTmp);
+	}
+}
+CommandListStats CommandList::execute(Renderer& renderer) const
+{
+	BASIS_PROFILE_GPU_ZONE("CommandList::execute");
+	CommandListStats stats;
+	// vertex array owns buffer bindings, so they're only trusted while it stays the same
+	std::uint32_t vao{};
+	const Pipeline* pipeline{};
+	const Buffer* vertexBuffer{};
+	const Buffer* idxBuffer{};
+	std::uint32_t vertexStride{};
+	IndexType idxType{};
+	for(auto i : m_order)
+	{
+		const auto& p = m_packets[i];
+		if(p.pipeline != pipeline)
+		{
+			pipeline = p.pipeline;
+			renderer.bindPipeline(*pipeline);
+			stats.pipelineBinds++;
+		}
+		if(renderer.context->vao != vao)
+		{
+			vao = renderer.context->vao;
+			vertexBuffer = idxBuffer = nullptr;
+		}
+		if(p.vertexBuffer != vertexBuffer || p.vertexStride != vertexStride)
+		{
+			vertexBuffer = p.vertexBuffer;
+			vertexStride = p.vertexStride;
+			renderer.bindVertexBuffer(*vertexBuffer,0,vertexStride);
+			stats.vertexBufferBinds++;
+		}
+		if(p.idxBuffer != idxBuffer || p.idxType != idxType)
+		{
+			idxBuffer = p.idxBuffer;
+			idxType = p.idxType;
+			renderer.bindIndexBuffer(*idxBuffer,idxType);
+			stats.indexBufferBinds++;
+		}
+		renderer.drawIndexed(p.idxCount,p.firstIdx,p.vertexOffset,p.instanceCount,p.firstInstance);
+		stats.draws++;
+	}
+	return stats;
+}
+FrameCommands::FrameCommands(std::size_t jobCount) : m_jobs(jobCount)
+{
+}
+void FrameCommands::resize(std::size_t jobCount)
+{
+	clear();
+	m_jobs.resize(jobCount);
+}
+void FrameCommands::clear() noexcept
+{
+	for(auto& job : m_jobs) job.clear();
+	m_merged.clear();
+}
+const CommandList& FrameCommands::merge()
+{
+	std::size_t total{};
+	for(const auto& job : m_jobs) total += job.size();
+	m_merged.clear();
+	m_merged.reserve(total);
+	for(const auto& job : m_jobs) m_merged.append(job);
+	m_merged.sort();
+	return m_merged;
+}
+}
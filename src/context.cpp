@@ -1,12 +1,63 @@
 #include <BASIS/context.h>
-#include <BASIS/exception.h>
+#include <BASIS/rendering.h>
 
+#include <array>
+#include <utility>
 #include <algorithm>
 
 #include <glad/gl.h>
 
+namespace
+{
+// gl objects live and die on the thread owning context
+struct DeletedObject
+{
+	BASIS::GLObjectType type{};
+	std::uint32_t id{};
+};
+// contexts lagging more than log size behind forget all bindings
+constexpr std::size_t deletionLogSize = 256;
+std::array<DeletedObject,deletionLogSize> deletionLog{};
+std::uint64_t deletionEpoch{};
+BASIS::UploadedBytes uploadedBytes{};
+std::uint32_t defaultFbo{};
+BASIS::Renderer* batchingRenderer{};
+}
 namespace BASIS
 {
+void notifyObjectDeleted(GLObjectType type,std::uint32_t id) noexcept
+{
+	deletionLog[deletionEpoch % deletionLogSize] = {type,id};
+	deletionEpoch++;
+}
+void notifyBufferUpload(std::uint64_t bytes) noexcept
+{
+	uploadedBytes.buffers += bytes;
+}
+void notifyTextureUpload(std::uint64_t bytes) noexcept
+{
+	uploadedBytes.textures += bytes;
+}
+UploadedBytes takeUploadedBytes() noexcept
+{
+	return std::exchange(uploadedBytes,{});
+}
+void setBatchingRenderer(Renderer* renderer) noexcept
+{
+	batchingRenderer = renderer;
+}
+void flushBatchedDraws()
+{
+	if(batchingRenderer) batchingRenderer->flushDraws();
+}
+void setDefaultFramebuffer(std::uint32_t id) noexcept
+{
+	defaultFbo = id;
+}
+std::uint32_t defaultFramebuffer() noexcept
+{
+	return defaultFbo;
+}
 RenderingContext::RenderingContext()
 {
 	properties.vendor = reinterpret_cast<const char*>(glGetString(GL_VENDOR));
@@ -92,11 +143,79 @@ RenderingContext::RenderingContext()
 	glGetIntegerv(GL_MAX_COMBINED_IMAGE_UNIFORMS, &limits.maxCombinedImageUniforms);
 	glGetIntegerv(GL_MAX_SERVER_WAIT_TIMEOUT, &limits.maxServerWaitTimeout);
 
-	// obligatory, as model loading heavily relies on this one
-	if(!checkExtensionSupport("GL_ARB_bindless_texture"))
+	textureUnits.resize(limits.maxCombinedTextureImageUnits);
+	samplerUnits.resize(limits.maxCombinedTextureImageUnits);
+	uniformBuffers.resize(limits.maxUniformBufferBindings);
+	storageBuffers.resize(limits.maxShaderStorageBufferBindings);
+	m_deletionEpoch = deletionEpoch;
+	// without it materials get no texture handles
+	properties.bindlessTextures = checkExtensionSupport("GL_ARB_bindless_texture");
+	// App loads ARB entry points into core ones on 4.5 contexts
+	properties.indirectCountDraws = glMultiDrawElementsIndirectCount != nullptr;
+}
+void RenderingContext::invalidate()
+{
+	invalidateBindings();
+	vao = 0;
+	capabilities.clear();
+	blendFuncs.reset();
+}
+void RenderingContext::syncDeletions()
+{
+	if(m_deletionEpoch == deletionEpoch) return;
+	if(deletionEpoch - m_deletionEpoch > deletionLogSize) invalidateBindings();
+	else
 	{
-		throw ApplicationException("Bindless textures must be supported");
+		for(auto i = m_deletionEpoch;i < deletionEpoch;i++)
+		{
+			const auto& deleted = deletionLog[i % deletionLogSize];
+			forgetObject(deleted.type,deleted.id);
+		}
 	}
+	m_deletionEpoch = deletionEpoch;
+}
+void RenderingContext::forgetObject(GLObjectType type,std::uint32_t id) noexcept
+{
+	switch(type)
+	{
+		case GLObjectType::BUFFER:
+			for(auto& range : uniformBuffers) if(range.buffer == id) range = {};
+			for(auto& range : storageBuffers) if(range.buffer == id) range = {};
+			for(auto& [vao,bindings] : vertexArrays)
+			{
+				if(bindings.elementBuffer == id) bindings.elementBuffer = 0;
+				for(auto& binding : bindings.vertexBuffers) if(binding.buffer == id) binding = {};
+			}
+			break;
+		case GLObjectType::TEXTURE:
+			std::replace(textureUnits.begin(),textureUnits.end(),id,0u);
+			break;
+		case GLObjectType::SAMPLER:
+			std::replace(samplerUnits.begin(),samplerUnits.end(),id,0u);
+			break;
+		case GLObjectType::FRAMEBUFFER:
+			// default framebuffer is 0, so unknown needs another value
+			if(fbo == id) fbo = ~0u;
+			break;
+		case GLObjectType::PROGRAM:
+			if(lastBoundPipeline == id) lastBoundPipeline = 0;
+			// deleted pipeline could take its state block with it
+			lastPipelineState = nullptr;
+			break;
+	}
+}
+void RenderingContext::invalidateBindings()
+{
+	std::fill(textureUnits.begin(),textureUnits.end(),0u);
+	std::fill(samplerUnits.begin(),samplerUnits.end(),0u);
+	std::fill(uniformBuffers.begin(),uniformBuffers.end(),BufferRange{});
+	std::fill(storageBuffers.begin(),storageBuffers.end(),BufferRange{});
+	vertexArrays.clear();
+	lastBoundPipeline = 0;
+	// deleted pipeline could take its state block with it
+	lastPipelineState = nullptr;
+	// default framebuffer is 0, so unknown needs another value
+	fbo = ~0u;
 }
 bool RenderingContext::checkExtensionSupport(std::string_view requestedExt)
 {
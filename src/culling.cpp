@@ -0,0 +1,171 @@
+#include <BASIS/culling.h>
+#include <BASIS/manager.h>
+#include <BASIS/scene_graph.h>
+#include <BASIS/thread_pool.h>
+#include <BASIS/profiler.h>
+
+#include <bit>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#define BASIS_CULL_SSE
+	#include <xmmintrin.h>
+#endif
+
+#include <glm/geometric.hpp>
+
+namespace
+{
+// nodes per job, small enough to balance uneven meshes
+constexpr std::size_t nodesPerJob = 256;
+
+bool boxVisible(const BASIS::BoxSoA& b,std::size_t i,const BASIS::Frustum& f)
+{
+	for(const auto& p : f.planes)
+	{
+		const float d = p.x * b.cx[i] + p.y * b.cy[i] + p.z * b.cz[i] + p.w;
+		const float r = std::abs(p.x) * b.ex[i] + std::abs(p.y) * b.ey[i] + std::abs(p.z) * b.ez[i];
+		if(d + r < 0.f) return false;
+	}
+	return true;
+}
+template<typename F>
+void forEachBit(std::uint32_t mask,F&& func)
+{
+	while(mask)
+	{
+		func(static_cast<std::uint32_t>(std::countr_zero(mask)));
+		mask &= mask - 1;
+	}
+}
+}
+namespace BASIS
+{
+Frustum Frustum::fromMatrix(const glm::mat4& viewProj)
+{
+	// Gribb-Hartmann, rows of clip matrix
+	Frustum out;
+	const glm::mat4 m = glm::transpose(viewProj);
+	for(int i{};i < 6;i++)
+	{
+		const glm::vec4 plane = m[3] + (i % 2 == 0 ? 1.f : -1.f) * m[i / 2];
+		out.planes[i] = plane / glm::length(glm::vec3(plane));
+	}
+	return out;
+}
+Frustum Frustum::fromCamera(const Camera& camera,float aspect)
+{
+	return fromMatrix(camera.projection(aspect) * camera.view());
+}
+void BoxSoA::push(const glm::vec3& center,const glm::vec3& extent)
+{
+	cx.push_back(center.x);
+	cy.push_back(center.y);
+	cz.push_back(center.z);
+	ex.push_back(extent.x);
+	ey.push_back(extent.y);
+	ez.push_back(extent.z);
+}
+void BoxSoA::clear() noexcept
+{
+	cx.clear(); cy.clear(); cz.clear();
+	ex.clear(); ey.clear(); ez.clear();
+}
+void primitiveWorldBox(const glm::mat4& world,const Primitive& prim,glm::vec3& center,glm::vec3& extent)
+{
+	// transformed box is bounded by |M| * extent around transformed center
+	const glm::vec3 localCenter = (prim.aabbMin + prim.aabbMax) * 0.5f;
+	const glm::vec3 localExtent = (prim.aabbMax - prim.aabbMin) * 0.5f;
+	center = glm::vec3(world * glm::vec4(localCenter,1.f));
+	extent = glm::abs(glm::vec3(world[0])) * localExtent.x +
+		glm::abs(glm::vec3(world[1])) * localExtent.y +
+		glm::abs(glm::vec3(world[2])) * localExtent.z;
+}
+void cullBoxes(const BoxSoA& b,const Frustum& f,std::vector<std::uint32_t>& out)
+{
+	const std::size_t count = b.size();
+	std::size_t i{};
+#if defined(__AVX2__)
+	for(;i + 8 <= count;i += 8)
+	{
+		const __m256 cx = _mm256_loadu_ps(b.cx.data() + i),cy = _mm256_loadu_ps(b.cy.data() + i),cz = _mm256_loadu_ps(b.cz.data() + i);
+		const __m256 ex = _mm256_loadu_ps(b.ex.data() + i),ey = _mm256_loadu_ps(b.ey.data() + i),ez = _mm256_loadu_ps(b.ez.data() + i);
+		__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for(const auto& p : f.planes)
+		{
+			__m256 d = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.x),cx),_mm256_set1_ps(p.w));
+			d = _mm256_add_ps(d,_mm256_mul_ps(_mm256_set1_ps(p.y),cy));
+			d = _mm256_add_ps(d,_mm256_mul_ps(_mm256_set1_ps(p.z),cz));
+			__m256 r = _mm256_mul_ps(_mm256_set1_ps(std::abs(p.x)),ex);
+			r = _mm256_add_ps(r,_mm256_mul_ps(_mm256_set1_ps(std::abs(p.y)),ey));
+			r = _mm256_add_ps(r,_mm256_mul_ps(_mm256_set1_ps(std::abs(p.z)),ez));
+			visible = _mm256_and_ps(visible,_mm256_cmp_ps(_mm256_add_ps(d,r),_mm256_setzero_ps(),_CMP_GE_OQ));
+		}
+		forEachBit(static_cast<std::uint32_t>(_mm256_movemask_ps(visible)),[&](std::uint32_t bit)
+		{
+			out.push_back(static_cast<std::uint32_t>(i + bit));
+		});
+	}
+#elif defined(BASIS_CULL_SSE)
+	for(;i + 4 <= count;i += 4)
+	{
+		const __m128 cx = _mm_loadu_ps(b.cx.data() + i),cy = _mm_loadu_ps(b.cy.data() + i),cz = _mm_loadu_ps(b.cz.data() + i);
+		const __m128 ex = _mm_loadu_ps(b.ex.data() + i),ey = _mm_loadu_ps(b.ey.data() + i),ez = _mm_loadu_ps(b.ez.data() + i);
+		__m128 visible = _mm_cmpeq_ps(cx,cx);
+		for(const auto& p : f.planes)
+		{
+			__m128 d = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.x),cx),_mm_set1_ps(p.w));
+			d = _mm_add_ps(d,_mm_mul_ps(_mm_set1_ps(p.y),cy));
+			d = _mm_add_ps(d,_mm_mul_ps(_mm_set1_ps(p.z),cz));
+			__m128 r = _mm_mul_ps(_mm_set1_ps(std::abs(p.x)),ex);
+			r = _mm_add_ps(r,_mm_mul_ps(_mm_set1_ps(std::abs(p.y)),ey));
+			r = _mm_add_ps(r,_mm_mul_ps(_mm_set1_ps(std::abs(p.z)),ez));
+			visible = _mm_and_ps(visible,_mm_cmpge_ps(_mm_add_ps(d,r),_mm_setzero_ps()));
+		}
+		forEachBit(static_cast<std::uint32_t>(_mm_movemask_ps(visible)),[&](std::uint32_t bit)
+		{
+			out.push_back(static_cast<std::uint32_t>(i + bit));
+		});
+	}
+#endif
+	for(;i < count;i++)
+	{
+		if(boxVisible(b,i,f)) out.push_back(static_cast<std::uint32_t>(i));
+	}
+}
+void cullScene(const SceneGraph& scene,const Frustum& frustum,std::vector<VisiblePrimitive>& out)
+{
+	BASIS_PROFILE_ZONE("cullScene");
+	const std::size_t jobs = (scene.size() + nodesPerJob - 1) / nodesPerJob;
+	std::vector<std::vector<VisiblePrimitive>> results(jobs);
+	defaultThreadPool().parallelFor(jobs,[&](std::size_t job)
+	{
+		BoxSoA boxes;
+		std::vector<VisiblePrimitive> items;
+		std::vector<std::uint32_t> visible;
+		const auto first = static_cast<std::uint32_t>(job * nodesPerJob);
+		const auto last = static_cast<std::uint32_t>(std::min<std::size_t>(scene.size(),first + nodesPerJob));
+		for(auto n = first;n < last;n++)
+		{
+			const auto* node = scene.source(n);
+			if(!node) continue;
+			const auto& primitives = node->mesh.primitives;
+			for(std::uint32_t p{};p < primitives.size();p++)
+			{
+				glm::vec3 center,extent;
+				primitiveWorldBox(scene.world(n),primitives[p],center,extent);
+				boxes.push(center,extent);
+				items.push_back({n,p});
+			}
+		}
+		cullBoxes(boxes,frustum,visible);
+		auto& res = results[job];
+		res.reserve(visible.size());
+		for(auto v : visible) res.push_back(items[v]);
+	});
+	for(const auto& r : results) out.insert(out.end(),r.begin(),r.end());
+}
+}
@@ -0,0 +1,169 @@
+#include <BASIS/draw_culler.h>
+#include <BASIS/culling.h>
+#include <BASIS/manager.h>
+#include <BASIS/rendering.h>
+#include <BASIS/scene_graph.h>
+#include <BASIS/profiler.h>
+
+#include <bit>
+#include <string>
+#include <algorithm>
+
+namespace
+{
+constexpr std::uint32_t cullGroupSize = 64;
+// DRAW_RECORD_GLSL goes in front
+constexpr const char* cullShaderSource = R"(
+layout(local_size_x = 64) in;
+
+layout(std140, binding = 0) uniform Params
+{
+	vec4 planes[6];
+	uint drawCount;
+	uint capacity;
+};
+layout(std430, binding = 0) readonly buffer Records { DrawRecord records[]; };
+layout(std430, binding = 1) readonly buffer Transforms { mat4 transforms[]; };
+layout(std430, binding = 2) writeonly buffer Commands { DrawCommand commands[]; };
+layout(std430, binding = 3) buffer Counts { uint counts[2]; };
+
+void main()
+{
+	uint idx = gl_GlobalInvocationID.x;
+	if(idx >= drawCount) return;
+	DrawRecord r = records[idx];
+	mat4 m = transforms[r.transform];
+
+	vec3 center = (m * vec4(r.center, 1.0)).xyz;
+	float radius = r.radius * max(max(length(m[0].xyz), length(m[1].xyz)), length(m[2].xyz));
+	for(int i = 0; i < 6; i++)
+	{
+		if(dot(planes[i].xyz, center) + planes[i].w < -radius) return;
+	}
+	uint slot = atomicAdd(counts[r.shortIndices], 1u);
+	commands[r.shortIndices * capacity + slot] = DrawCommand(r.idxCount, 1u, r.firstIdx, r.vertexOffset, idx);
+}
+)";
+// std140 mirror of Params block
+struct CullParams
+{
+	glm::vec4 planes[6];
+	std::uint32_t drawCount;
+	std::uint32_t capacity;
+	std::uint32_t pad[2];
+};
+BASIS::ComputePipeline makeCullPipeline()
+{
+	const auto source = std::string("#version 450 core\n") + BASIS::DRAW_RECORD_GLSL + cullShaderSource;
+	BASIS::Shader shader(BASIS::ShaderType::COMPUTE,source,"draw cull");
+	return BASIS::ComputePipeline(shader,"draw cull");
+}
+}
+namespace BASIS
+{
+void appendDrawRecords(const SceneGraph& scene,std::vector<DrawRecord>& out)
+{
+	for(std::uint32_t n{};n < scene.size();n++)
+	{
+		const auto* node = scene.source(n);
+		if(!node) continue;
+		for(const auto& p : node->mesh.primitives)
+		{
+			out.push_back({
+				.center = p.center,
+				.radius = p.radius,
+				.firstIdx = p.firstIdx,
+				.idxCount = p.idxCount,
+				.vertexOffset = p.vertexOffset,
+				.transform = n,
+				.materialIdx = p.materialIdx,
+				.shortIndices = p.idxType == IndexType::USHORT
+			});
+		}
+	}
+}
+DrawRecordBuffers::DrawRecordBuffers(std::uint32_t capacity,std::string_view recordsName,std::string_view transformsName) :
+records(sizeof(DrawRecord) * std::max(capacity,1u),BufferFlags::DYNAMIC,recordsName),
+transforms(sizeof(glm::mat4) * std::max(capacity,1u),BufferFlags::DYNAMIC,transformsName),
+capacity(std::max(capacity,1u)),
+m_recordsName(recordsName),
+m_transformsName(transformsName)
+{
+}
+bool DrawRecordBuffers::setDraws(std::span<const DrawRecord> newRecords)
+{
+	drawCount = static_cast<std::uint32_t>(newRecords.size());
+	hasShortIndices = std::ranges::any_of(newRecords,[](const DrawRecord& r){ return r.shortIndices != 0; });
+	const bool grew = drawCount > capacity;
+	if(grew)
+	{
+		// contents are replaced anyway, no need to copy
+		capacity = std::bit_ceil(drawCount);
+		records = Buffer(sizeof(DrawRecord) * capacity,BufferFlags::DYNAMIC,m_recordsName);
+	}
+	if(!newRecords.empty()) records.update(newRecords);
+	return grew;
+}
+void DrawRecordBuffers::setTransforms(std::span<const glm::mat4> newTransforms)
+{
+	if(newTransforms.size_bytes() > transforms.size())
+	{
+		transforms = Buffer(std::bit_ceil(newTransforms.size()) * sizeof(glm::mat4),BufferFlags::DYNAMIC,m_transformsName);
+	}
+	if(!newTransforms.empty()) transforms.update(newTransforms);
+}
+void DrawRecordBuffers::draw(Renderer& renderer,const Buffer& idxBuffer,const Buffer& commands,const Buffer& counts,std::uint32_t bucket) const
+{
+	if(drawCount == 0) return;
+	constexpr auto stride = static_cast<std::uint32_t>(sizeof(DrawIndexedIndirectCommand));
+	Renderer::memoryBarrier(MemoryBarrierBit::COMMAND);
+	renderer.bindIndexBuffer(idxBuffer,IndexType::UINT);
+	renderer.drawIndexedIndirectCount(commands,counts,capacity,stride,
+		std::uint64_t{stride} * capacity * bucket,sizeof(std::uint32_t) * bucket);
+	if(!hasShortIndices) return;
+	renderer.bindIndexBuffer(idxBuffer,IndexType::USHORT);
+	renderer.drawIndexedIndirectCount(commands,counts,capacity,stride,
+		std::uint64_t{stride} * capacity * (bucket + 1),sizeof(std::uint32_t) * (bucket + 1));
+}
+DrawCuller::DrawCuller(std::uint32_t capacity) :
+m_pipeline(makeCullPipeline()),
+m_params(sizeof(CullParams),BufferFlags::DYNAMIC,"draw cull params"),
+m_draws(capacity,"draw records","draw transforms"),
+m_commands(2 * sizeof(DrawIndexedIndirectCommand) * std::max(capacity,1u),0,"culled draws"),
+m_counts(2 * sizeof(std::uint32_t),BufferFlags::DYNAMIC,"culled draw counts")
+{
+}
+void DrawCuller::setDraws(std::span<const DrawRecord> records)
+{
+	if(m_draws.setDraws(records))
+	{
+		m_commands = Buffer(2 * sizeof(DrawIndexedIndirectCommand) * m_draws.capacity,0,"culled draws");
+	}
+}
+void DrawCuller::setTransforms(std::span<const glm::mat4> transforms)
+{
+	m_draws.setTransforms(transforms);
+}
+void DrawCuller::cull(Renderer& renderer,const glm::mat4& viewProj)
+{
+	BASIS_PROFILE_GPU_ZONE("DrawCuller::cull");
+	m_counts.fill(0);
+	if(m_draws.drawCount == 0) return;
+	CullParams params{.drawCount = m_draws.drawCount,.capacity = m_draws.capacity};
+	const auto frustum = Frustum::fromMatrix(viewProj);
+	std::copy(std::begin(frustum.planes),std::end(frustum.planes),params.planes);
+	m_params.update(params);
+
+	renderer.bindComputePipeline(m_pipeline);
+	renderer.bindUniformBuffer(m_params,0);
+	renderer.bindStorageBuffer(m_draws.records,0);
+	renderer.bindStorageBuffer(m_draws.transforms,1);
+	renderer.bindStorageBuffer(m_commands,2);
+	renderer.bindStorageBuffer(m_counts,3);
+	renderer.dispatch(glm::vec3((m_draws.drawCount + cullGroupSize - 1) / cullGroupSize,1,1));
+}
+void DrawCuller::draw(Renderer& renderer,const Buffer& idxBuffer)
+{
+	m_draws.draw(renderer,idxBuffer,m_commands,m_counts,0);
+}
+}
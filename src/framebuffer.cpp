@@ -1,4 +1,6 @@
+#include <BASIS/context.h>
 #include <BASIS/framebuffer.h>
+#include <BASIS/gpu_memory.h>
 
 #include <cassert>
 #include <numeric>
@@ -37,10 +39,15 @@ Framebuffer::Framebuffer(FramebufferCreateInfo&& info,std::string_view name) : m
     glNamedFramebufferTexture(m_id, GL_STENCIL_ATTACHMENT, m_info.depthAttachment->id(), 0);
     
   }
+  glObjectLabel(GL_FRAMEBUFFER,m_id,name.size(),name.data());
+  trackGPUObject(GPUResource::FRAMEBUFFER,m_id,0,name);
 }
 Framebuffer::~Framebuffer()
 {
+	if(!m_id) return;
 	glDeleteFramebuffers(1, &m_id);
+	untrackGPUObject(GPUResource::FRAMEBUFFER,m_id);
+	notifyObjectDeleted(GLObjectType::FRAMEBUFFER,m_id);
 }
 
 Framebuffer& Framebuffer::operator=(Framebuffer&& other) noexcept
@@ -0,0 +1,112 @@
+#include <BASIS/types.h>
+#include <BASIS/geometry_arena.h>
+
+#include <cassert>
+#include <utility>
+#include <algorithm>
+
+#include <glad/gl.h>
+
+namespace BASIS
+{
+RangeAllocator::RangeAllocator(std::uint64_t capacity) : m_capacity(capacity)
+{
+	if(capacity) m_free.emplace(0,capacity);
+}
+std::optional<std::uint64_t> RangeAllocator::allocate(std::uint64_t size,std::uint64_t alignment)
+{
+	assert(size > 0 && alignment > 0);
+	for(auto it = m_free.begin();it != m_free.end();++it)
+	{
+		const auto [blockOffset,blockSize] = *it;
+		const auto aligned = (blockOffset + alignment - 1) / alignment * alignment;
+		if(aligned + size > blockOffset + blockSize) continue;
+
+		m_free.erase(it);
+		// padding in front and the tail stay free
+		if(aligned > blockOffset) m_free.emplace(blockOffset,aligned - blockOffset);
+		if(aligned + size < blockOffset + blockSize) m_free.emplace(aligned + size,blockOffset + blockSize - aligned - size);
+		return aligned;
+	}
+	return std::nullopt;
+}
+void RangeAllocator::free(std::uint64_t offset,std::uint64_t size)
+{
+	if(size == 0) return;
+	assert(offset + size <= m_capacity);
+	auto it = m_free.emplace(offset,size).first;
+	if(auto next = std::next(it);next != m_free.end() && it->first + it->second == next->first)
+	{
+		it->second += next->second;
+		m_free.erase(next);
+	}
+	if(it != m_free.begin())
+	{
+		if(auto prev = std::prev(it);prev->first + prev->second == it->first)
+		{
+			prev->second += it->second;
+			m_free.erase(it);
+		}
+	}
+}
+void RangeAllocator::grow(std::uint64_t newCapacity)
+{
+	if(newCapacity <= m_capacity) return;
+	const auto old = std::exchange(m_capacity,newCapacity);
+	free(old,newCapacity - old);
+}
+
+GeometryArena::GeometryArena(std::uint64_t vertexCapacity,std::uint64_t idxCapacity) :
+m_vertices{Buffer(std::max<std::uint64_t>(vertexCapacity,4),BufferFlags::DYNAMIC,"geometry arena vertices"),RangeAllocator(std::max<std::uint64_t>(vertexCapacity,4))},
+m_indices{Buffer(std::max<std::uint64_t>(idxCapacity,4),BufferFlags::DYNAMIC,"geometry arena indices"),RangeAllocator(std::max<std::uint64_t>(idxCapacity,4))}
+{
+}
+GeometryAllocation GeometryArena::allocate(Pool& pool,std::uint64_t size,std::uint64_t alignment)
+{
+	if(size == 0) return {};
+	auto offset = pool.allocator.allocate(size,alignment);
+	while(!offset)
+	{
+		// live ranges keep their offsets, only the storage is replaced
+		const auto newCapacity = std::max(pool.allocator.capacity() * 2,pool.allocator.capacity() + size + alignment);
+		Buffer grown(newCapacity,BufferFlags::DYNAMIC,"geometry arena");
+		glCopyNamedBufferSubData(pool.buffer.id(),grown.id(),0,0,pool.buffer.size());
+		pool.buffer = std::move(grown);
+		pool.allocator.grow(newCapacity);
+		offset = pool.allocator.allocate(size,alignment);
+	}
+	return {.offset = *offset,.size = size};
+}
+GeometryAllocation GeometryArena::allocateVertices(std::span<const std::byte> data,std::uint64_t stride)
+{
+	auto out = allocate(m_vertices,data.size(),stride);
+	if(out.size) m_vertices.buffer.update(data,out.offset);
+	return out;
+}
+GeometryAllocation GeometryArena::allocateVertices(const Buffer& src,std::uint64_t stride)
+{
+	auto out = allocate(m_vertices,src.size(),stride);
+	if(out.size) glCopyNamedBufferSubData(src.id(),m_vertices.buffer.id(),0,out.offset,out.size);
+	return out;
+}
+GeometryAllocation GeometryArena::allocateIndices(std::span<const std::byte> data)
+{
+	auto out = allocate(m_indices,data.size(),4);
+	if(out.size) m_indices.buffer.update(data,out.offset);
+	return out;
+}
+GeometryAllocation GeometryArena::allocateIndices(const Buffer& src)
+{
+	auto out = allocate(m_indices,src.size(),4);
+	if(out.size) glCopyNamedBufferSubData(src.id(),m_indices.buffer.id(),0,out.offset,out.size);
+	return out;
+}
+void GeometryArena::freeVertices(const GeometryAllocation& allocation)
+{
+	m_vertices.allocator.free(allocation.offset,allocation.size);
+}
+void GeometryArena::freeIndices(const GeometryAllocation& allocation)
+{
+	m_indices.allocator.free(allocation.offset,allocation.size);
+}
+}
@@ -0,0 +1,116 @@
+#include <BASIS/gpu_memory.h>
+
+#include <cstdio>
+#include <cassert>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+
+namespace
+{
+struct TrackedObject
+{
+	std::uint64_t bytes{};
+	std::string name;
+};
+// gl ids are unique per object kind only
+constexpr std::uint64_t objectKey(BASIS::GPUResource resource,std::uint32_t id) noexcept
+{
+	return static_cast<std::uint64_t>(resource) << 32 | id;
+}
+std::unordered_map<std::uint64_t,TrackedObject> trackedObjects;
+BASIS::GPUMemoryStats memoryStats{};
+
+void add(BASIS::GPUMemoryCounter& counter,std::uint64_t bytes) noexcept
+{
+	counter.bytes += bytes;
+	counter.objects++;
+	counter.peakBytes = std::max(counter.peakBytes,counter.bytes);
+	counter.peakObjects = std::max(counter.peakObjects,counter.objects);
+}
+void remove(BASIS::GPUMemoryCounter& counter,std::uint64_t bytes) noexcept
+{
+	assert(counter.bytes >= bytes && counter.objects > 0);
+	counter.bytes -= bytes;
+	counter.objects--;
+}
+}
+namespace BASIS
+{
+const char* resourceName(GPUResource resource) noexcept
+{
+	switch(resource)
+	{
+		case GPUResource::BUFFER:		return "buffer";
+		case GPUResource::TEXTURE:		return "texture";
+		case GPUResource::FRAMEBUFFER:	return "framebuffer";
+		case GPUResource::SAMPLER:		return "sampler";
+		default:						return "unknown";
+	}
+}
+void trackGPUObject(GPUResource resource,std::uint32_t id,std::uint64_t bytes,std::string_view name)
+{
+	if(!id) return;
+	const auto [it,inserted] = trackedObjects.try_emplace(objectKey(resource,id),TrackedObject{bytes,std::string(name)});
+	assert(inserted && "gl object is tracked twice");
+	if(!inserted) return;
+	add(memoryStats.resources[static_cast<std::size_t>(resource)],bytes);
+	add(memoryStats.total,bytes);
+}
+void untrackGPUObject(GPUResource resource,std::uint32_t id) noexcept
+{
+	const auto it = trackedObjects.find(objectKey(resource,id));
+	if(it == trackedObjects.end()) return;
+	remove(memoryStats.resources[static_cast<std::size_t>(resource)],it->second.bytes);
+	remove(memoryStats.total,it->second.bytes);
+	trackedObjects.erase(it);
+}
+GPUMemoryStats gpuMemoryStats() noexcept
+{
+	return memoryStats;
+}
+std::vector<GPUObjectInfo> liveGPUObjects()
+{
+	std::vector<GPUObjectInfo> objects;
+	objects.reserve(trackedObjects.size());
+	for(const auto& [key,object] : trackedObjects)
+	{
+		objects.push_back({
+			.resource = static_cast<GPUResource>(key >> 32),
+			.id = static_cast<std::uint32_t>(key),
+			.bytes = object.bytes,
+			.name = object.name});
+	}
+	std::sort(objects.begin(),objects.end(),[](const auto& a,const auto& b)
+	{
+		return a.bytes != b.bytes ? a.bytes > b.bytes : std::pair(a.resource,a.id) < std::pair(b.resource,b.id);
+	});
+	return objects;
+}
+std::vector<GPULabelUsage> gpuMemoryByLabel()
+{
+	std::unordered_map<std::string_view,std::size_t> indices[static_cast<std::size_t>(GPUResource::COUNT)];
+	std::vector<GPULabelUsage> usage;
+	for(const auto& [key,object] : trackedObjects)
+	{
+		const auto resource = static_cast<GPUResource>(key >> 32);
+		const auto [it,inserted] = indices[static_cast<std::size_t>(resource)].try_emplace(object.name,usage.size());
+		if(inserted) usage.push_back({.resource = resource,.name = object.name});
+		usage[it->second].bytes += object.bytes;
+		usage[it->second].objects++;
+	}
+	std::sort(usage.begin(),usage.end(),[](const auto& a,const auto& b){ return a.bytes > b.bytes; });
+	return usage;
+}
+std::size_t reportLiveGPUObjects()
+{
+	if(trackedObjects.empty()) return 0;
+	const auto objects = liveGPUObjects();
+	std::printf("%zu gl objects still alive(%llu bytes):\n",objects.size(),static_cast<unsigned long long>(memoryStats.total.bytes));
+	for(const auto& o : objects)
+	{
+		std::printf("\t%s %u \"%s\" %llu bytes\n",resourceName(o.resource),o.id,o.name.c_str(),static_cast<unsigned long long>(o.bytes));
+	}
+	return objects.size();
+}
+}
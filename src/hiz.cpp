@@ -0,0 +1,279 @@
+#include <BASIS/hiz.h>
+#include <BASIS/culling.h>
+#include <BASIS/rendering.h>
+#include <BASIS/framebuffer.h>
+#include <BASIS/profiler.h>
+
+#include <bit>
+#include <string>
+#include <cassert>
+#include <algorithm>
+
+namespace
+{
+constexpr std::uint32_t reduceGroupSize = 8;
+constexpr const char* reduceShaderSource = R"(
+#version 450 core
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(binding = 0) uniform sampler2D src;
+layout(r32f, binding = 0) writeonly uniform image2D dst;
+layout(std140, binding = 0) uniform Params
+{
+	ivec2 srcSize;
+	ivec2 dstSize;
+	int srcLevel;
+};
+
+void main()
+{
+	ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+	if(any(greaterThanEqual(p, dstSize))) return;
+	// footprint is rounded outwards, so non power of two sources stay conservative
+	ivec2 lo = (p * srcSize) / dstSize;
+	ivec2 hi = min(((p + 1) * srcSize + dstSize - 1) / dstSize, srcSize);
+	float depth = 0.0;
+	for(int y = lo.y; y < hi.y; y++)
+	{
+		for(int x = lo.x; x < hi.x; x++) depth = max(depth, texelFetch(src, ivec2(x, y), srcLevel).r);
+	}
+	imageStore(dst, p, vec4(depth));
+}
+)";
+constexpr std::uint32_t cullGroupSize = 64;
+// DRAW_RECORD_GLSL goes in front
+constexpr const char* cullShaderSource = R"(
+layout(local_size_x = 64) in;
+
+layout(std140, binding = 0) uniform Params
+{
+	mat4 viewProj;
+	vec4 planes[6];
+	vec2 pyramidSize;
+	uint pyramidLevels; // 0 - no pyramid yet, everything is left for second phase
+	uint phase;
+	uint drawCount;
+	uint capacity;
+};
+layout(binding = 0) uniform sampler2D pyramid;
+layout(std430, binding = 0) readonly buffer Records { DrawRecord records[]; };
+layout(std430, binding = 1) readonly buffer Transforms { mat4 transforms[]; };
+layout(std430, binding = 2) writeonly buffer Commands { DrawCommand commands[]; };
+layout(std430, binding = 3) buffer Counts { uint counts[4]; };
+layout(std430, binding = 4) buffer Retest { uint retest[]; };
+
+bool occluded(vec3 center, float radius)
+{
+	if(pyramidLevels == 0) return true;
+	vec2 minUV = vec2(1.0);
+	vec2 maxUV = vec2(0.0);
+	float minDepth = 1.0;
+	for(int i = 0; i < 8; i++)
+	{
+		vec3 corner = center + radius * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+		vec4 clip = viewProj * vec4(corner, 1.0);
+		// crosses camera plane, screen bounds are meaningless
+		if(clip.w <= 0.0) return false;
+		vec3 ndc = clip.xyz / clip.w;
+		minUV = min(minUV, ndc.xy * 0.5 + 0.5);
+		maxUV = max(maxUV, ndc.xy * 0.5 + 0.5);
+		minDepth = min(minDepth, ndc.z * 0.5 + 0.5);
+	}
+	minUV = clamp(minUV, 0.0, 1.0);
+	maxUV = clamp(maxUV, 0.0, 1.0);
+	// at this level rect is at most one texel wide, so it touches at most 2x2 texels
+	vec2 extent = (maxUV - minUV) * pyramidSize;
+	int level = min(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), int(pyramidLevels) - 1);
+	ivec2 size = textureSize(pyramid, level);
+	ivec2 lo = min(ivec2(minUV * vec2(size)), size - 1);
+	ivec2 hi = min(ivec2(maxUV * vec2(size)), size - 1);
+	float maxDepth = 0.0;
+	for(int y = lo.y; y <= hi.y; y++)
+	{
+		for(int x = lo.x; x <= hi.x; x++) maxDepth = max(maxDepth, texelFetch(pyramid, ivec2(x, y), level).r);
+	}
+	return minDepth > maxDepth;
+}
+void main()
+{
+	uint idx = gl_GlobalInvocationID.x;
+	if(idx >= drawCount) return;
+	if(phase == 1 && retest[idx] == 0) return;
+	DrawRecord r = records[idx];
+	mat4 m = transforms[r.transform];
+
+	vec3 center = (m * vec4(r.center, 1.0)).xyz;
+	float radius = r.radius * max(max(length(m[0].xyz), length(m[1].xyz)), length(m[2].xyz));
+	if(phase == 0)
+	{
+		for(int i = 0; i < 6; i++)
+		{
+			if(dot(planes[i].xyz, center) + planes[i].w < -radius)
+			{
+				retest[idx] = 0;
+				return;
+			}
+		}
+	}
+	bool visible = !occluded(center, radius);
+	if(phase == 0) retest[idx] = visible ? 0u : 1u;
+	if(!visible) return;
+	uint bucket = phase * 2 + r.shortIndices;
+	uint slot = atomicAdd(counts[bucket], 1u);
+	commands[bucket * capacity + slot] = DrawCommand(r.idxCount, 1u, r.firstIdx, r.vertexOffset, idx);
+}
+)";
+// std140 mirrors of Params blocks
+struct ReduceParams
+{
+	glm::ivec2 srcSize;
+	glm::ivec2 dstSize;
+	std::int32_t srcLevel;
+	std::int32_t pad[3];
+};
+struct CullParams
+{
+	glm::mat4 viewProj;
+	glm::vec4 planes[6];
+	glm::vec2 pyramidSize;
+	std::uint32_t pyramidLevels;
+	std::uint32_t phase;
+	std::uint32_t drawCount;
+	std::uint32_t capacity;
+	std::uint32_t pad[2];
+};
+BASIS::ComputePipeline makePipeline(std::string_view source,std::string_view name)
+{
+	BASIS::Shader shader(BASIS::ShaderType::COMPUTE,source,name);
+	return BASIS::ComputePipeline(shader,name);
+}
+BASIS::SamplerInfo pyramidSamplerInfo()
+{
+	// texelFetch of levels above base needs mipmapped min filter to be complete
+	BASIS::SamplerInfo info;
+	info.minFilter = BASIS::Filter::NEAREST_MIP_NEAREST;
+	info.magFilter = BASIS::Filter::NEAREST;
+	return info;
+}
+glm::uvec2 pyramidExtent(glm::uvec2 depthExtent)
+{
+	return {std::bit_floor(std::max(depthExtent.x,1u)),std::bit_floor(std::max(depthExtent.y,1u))};
+}
+BASIS::Texture makePyramid(glm::uvec2 depthExtent)
+{
+	const auto extent = pyramidExtent(depthExtent);
+	const auto levels = static_cast<std::uint32_t>(std::bit_width(std::max(extent.x,extent.y)));
+	return BASIS::createTexture2DMip(extent,BASIS::Format::R32F,levels,"hi-z pyramid");
+}
+}
+namespace BASIS
+{
+HiZCuller::HiZCuller(glm::uvec2 depthExtent,std::uint32_t capacity) :
+m_reducePipeline(makePipeline(reduceShaderSource,"hi-z reduce")),
+m_cullPipeline(makePipeline(std::string("#version 450 core\n") + DRAW_RECORD_GLSL + cullShaderSource,"hi-z cull")),
+m_sampler(pyramidSamplerInfo(),"hi-z pyramid sampler"),
+m_pyramid(makePyramid(depthExtent)),
+m_reduceParams(sizeof(ReduceParams),BufferFlags::DYNAMIC,"hi-z reduce params"),
+m_cullParams(sizeof(CullParams),BufferFlags::DYNAMIC,"hi-z cull params"),
+m_draws(capacity,"hi-z draw records","hi-z draw transforms"),
+m_commands(4 * sizeof(DrawIndexedIndirectCommand) * std::max(capacity,1u),0,"hi-z draws"),
+m_counts(4 * sizeof(std::uint32_t),BufferFlags::DYNAMIC,"hi-z draw counts"),
+m_retest(sizeof(std::uint32_t) * std::max(capacity,1u),0,"hi-z retest"),
+m_depthExtent(depthExtent)
+{
+}
+void HiZCuller::resize(glm::uvec2 depthExtent)
+{
+	if(depthExtent == m_depthExtent) return;
+	m_depthExtent = depthExtent;
+	m_pyramid = makePyramid(depthExtent);
+	m_pyramidValid = false;
+}
+void HiZCuller::setDraws(std::span<const DrawRecord> records)
+{
+	if(m_draws.setDraws(records))
+	{
+		// first phase rewrites retest flags of every record, so nothing has to be copied
+		m_commands = Buffer(4 * sizeof(DrawIndexedIndirectCommand) * m_draws.capacity,0,"hi-z draws");
+		m_retest = Buffer(sizeof(std::uint32_t) * m_draws.capacity,0,"hi-z retest");
+	}
+}
+void HiZCuller::setTransforms(std::span<const glm::mat4> transforms)
+{
+	m_draws.setTransforms(transforms);
+}
+void HiZCuller::buildPyramid(Renderer& renderer,const Framebuffer& framebuffer)
+{
+	BASIS_PROFILE_GPU_ZONE("HiZCuller::buildPyramid");
+	assert(framebuffer.info().depthAttachment && "Framebuffer has no depth attachment");
+	const auto& depth = *framebuffer.info().depthAttachment;
+	assert(depth.info().type == ImageType::TEX_2D);
+	assert(depth.info().extent.x == m_depthExtent.x && depth.info().extent.y == m_depthExtent.y);
+
+	renderer.bindComputePipeline(m_reducePipeline);
+	renderer.bindUniformBuffer(m_reduceParams,0);
+	const auto& extent = m_pyramid.info().extent;
+	glm::ivec2 srcSize(m_depthExtent);
+	for(std::uint32_t level{};level < m_pyramid.info().mipLevels;level++)
+	{
+		const glm::ivec2 dstSize(std::max(extent.x >> level,1u),std::max(extent.y >> level,1u));
+		m_reduceParams.update(ReduceParams{
+			.srcSize = srcSize,
+			.dstSize = dstSize,
+			.srcLevel = level == 0 ? 0 : static_cast<std::int32_t>(level - 1)
+		});
+		renderer.bindSampledImage(0,level == 0 ? depth : m_pyramid,m_sampler);
+		renderer.bindImage(0,m_pyramid,level,AccessFlags::WRITE_ONLY);
+		renderer.dispatch(glm::vec3(
+			(dstSize.x + reduceGroupSize - 1) / reduceGroupSize,
+			(dstSize.y + reduceGroupSize - 1) / reduceGroupSize,1));
+		Renderer::memoryBarrier(MemoryBarrierBit::SHADER_IMAGE_ACCESS | MemoryBarrierBit::TEXTURE_FETCH);
+		srcSize = dstSize;
+	}
+	m_pyramidValid = true;
+}
+void HiZCuller::cullFirstPhase(Renderer& renderer,const glm::mat4& viewProj)
+{
+	BASIS_PROFILE_GPU_ZONE("HiZCuller::cullFirstPhase");
+	m_viewProj = viewProj;
+	m_counts.fill(0);
+	cull(renderer,HiZPhase::FIRST);
+}
+void HiZCuller::cullSecondPhase(Renderer& renderer)
+{
+	BASIS_PROFILE_GPU_ZONE("HiZCuller::cullSecondPhase");
+	assert(m_pyramidValid && "buildPyramid() must be called before second phase");
+	cull(renderer,HiZPhase::SECOND);
+}
+void HiZCuller::cull(Renderer& renderer,HiZPhase phase)
+{
+	if(m_draws.drawCount == 0) return;
+	CullParams params{
+		.viewProj = m_viewProj,
+		.pyramidSize = glm::vec2(m_pyramid.info().extent.x,m_pyramid.info().extent.y),
+		.pyramidLevels = m_pyramidValid ? m_pyramid.info().mipLevels : 0,
+		.phase = static_cast<std::uint32_t>(phase),
+		.drawCount = m_draws.drawCount,
+		.capacity = m_draws.capacity
+	};
+	const auto frustum = Frustum::fromMatrix(m_viewProj);
+	std::copy(std::begin(frustum.planes),std::end(frustum.planes),params.planes);
+	m_cullParams.update(params);
+
+	renderer.bindComputePipeline(m_cullPipeline);
+	renderer.bindUniformBuffer(m_cullParams,0);
+	renderer.bindSampledImage(0,m_pyramid,m_sampler);
+	renderer.bindStorageBuffer(m_draws.records,0);
+	renderer.bindStorageBuffer(m_draws.transforms,1);
+	renderer.bindStorageBuffer(m_commands,2);
+	renderer.bindStorageBuffer(m_counts,3);
+	renderer.bindStorageBuffer(m_retest,4);
+	renderer.dispatch(glm::vec3((m_draws.drawCount + cullGroupSize - 1) / cullGroupSize,1,1));
+	// second phase reads retest flags written by first one
+	Renderer::memoryBarrier(MemoryBarrierBit::SHADER_STORAGE);
+}
+void HiZCuller::draw(Renderer& renderer,const Buffer& idxBuffer,HiZPhase phase)
+{
+	m_draws.draw(renderer,idxBuffer,m_commands,m_counts,2 * static_cast<std::uint32_t>(phase));
+}
+}
@@ -0,0 +1,41 @@
+#include <BASIS/lod.h>
+
+#include <cmath>
+#include <algorithm>
+
+#include <glm/geometric.hpp>
+
+namespace BASIS
+{
+float projectedError(float error,float distance,const Camera& camera,float viewportHeight)
+{
+	const float d = std::max(distance,camera.zNear);
+	return error / (2.f * d * std::tan(camera.fov * 0.5f)) * viewportHeight;
+}
+LodSelection selectLod(
+	const Primitive& primitive,
+	const glm::mat4& model,
+	const Camera& camera,
+	float viewportHeight,
+	float pixelThreshold)
+{
+	LodSelection out{.firstIdx = primitive.firstIdx,.idxCount = primitive.idxCount};
+	if(primitive.lods.empty()) return out;
+
+	const float scale = std::max({
+		glm::length(glm::vec3(model[0])),
+		glm::length(glm::vec3(model[1])),
+		glm::length(glm::vec3(model[2]))});
+	const glm::vec3 center = glm::vec3(model * glm::vec4(primitive.center,1.f));
+	const float distance = glm::length(center - camera.pos) - primitive.radius * scale;
+
+	// errors grow with level, so first one over threshold ends the search
+	for(std::uint32_t i{};i < primitive.lods.size();i++)
+	{
+		const auto& lod = primitive.lods[i];
+		if(projectedError(lod.error * scale,distance,camera,viewportHeight) > pixelThreshold) break;
+		out = {.firstIdx = lod.firstIdx,.idxCount = lod.idxCount,.level = i + 1};
+	}
+	return out;
+}
+}
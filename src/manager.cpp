@@ -1,13 +1,26 @@
 #include <BASIS/buffer.h>
+#include <BASIS/context.h>
 #include <BASIS/manager.h>
 #include <BASIS/texture.h>
 #include <BASIS/exception.h>
+#include <BASIS/thread_pool.h>
+#include <BASIS/scene_graph.h>
+#include <BASIS/model_cache.h>
+#include <BASIS/mesh_optimizer.h>
+#include <BASIS/profiler.h>
 
+#include <span>
+#include <mutex>
 #include <utility>
+#include <cstdio>
 #include <cassert>
 #include <cstddef>
+#include <cstring>
+#include <limits>
 #include <algorithm>
+#include <exception>
 #include <filesystem>
+#include <condition_variable>
 
 #include <glad/gl.h>
 
@@ -16,6 +29,7 @@
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
+#include <glm/gtc/packing.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/ext/matrix_transform.hpp>
 
@@ -71,6 +85,8 @@ Manager::Manager(Manager&& other)
 	m_samplers = std::move(other.m_samplers);
 	m_textures = std::move(other.m_textures);
 	if(other.materialUploadCallback) materialUploadCallback = other.materialUploadCallback;
+	modelCacheDirectory = std::move(other.modelCacheDirectory);
+	m_geometryArena = std::move(other.m_geometryArena);
 }
 Manager& Manager::operator=(Manager&& other)
 {
@@ -79,6 +95,8 @@ Manager& Manager::operator=(Manager&& other)
 	m_samplers = std::move(other.m_samplers);
 	m_textures = std::move(other.m_textures);
 	if(other.materialUploadCallback) materialUploadCallback = other.materialUploadCallback;
+	modelCacheDirectory = std::move(other.modelCacheDirectory);
+	m_geometryArena = std::move(other.m_geometryArena);
 	return *this;
 }
 const Sampler* Manager::getSampler(const SamplerInfo& inf) noexcept
@@ -87,41 +105,22 @@ const Sampler* Manager::getSampler(const SamplerInfo& inf) noexcept
 	size_t iHash = hashSamplerInfo(inf);
 	if(auto it = m_samplers.find(iHash);it != m_samplers.end()) return it->second.get();
 
-	std::uint32_t m_id;
-	glCreateSamplers(1, &m_id);
-
-    glSamplerParameteri(m_id,GL_TEXTURE_COMPARE_MODE,inf.compareEnable ? GL_COMPARE_REF_TO_TEXTURE : GL_NONE);
-    glSamplerParameteri(m_id, GL_TEXTURE_COMPARE_FUNC,enumToGL(inf.compareMode));
-
-    glSamplerParameteri(m_id, GL_TEXTURE_MAG_FILTER, inf.magFilter == Filter::LINEAR ? GL_LINEAR : GL_NEAREST);
-    glSamplerParameteri(m_id, GL_TEXTURE_MIN_FILTER, enumToGL(inf.minFilter));
-
-    glSamplerParameteri(m_id, GL_TEXTURE_WRAP_S, enumToGL(inf.addressModeU));
-    glSamplerParameteri(m_id, GL_TEXTURE_WRAP_T, enumToGL(inf.addressModeV));
-    glSamplerParameteri(m_id, GL_TEXTURE_WRAP_R, enumToGL(inf.addressModeW));
-
-    glSamplerParameterf(m_id,GL_TEXTURE_MAX_ANISOTROPY,static_cast<float>(enumToGL(inf.anisotropy)));
-    glSamplerParameterf(m_id, GL_TEXTURE_LOD_BIAS, inf.lodBias);
-    glSamplerParameterf(m_id, GL_TEXTURE_MIN_LOD, inf.minLod);
-    glSamplerParameterf(m_id, GL_TEXTURE_MAX_LOD, inf.maxLod);
-    return m_samplers.insert({iHash,std::make_unique<Sampler>(Sampler(m_id,inf))}).first->second.get();
+	return m_samplers.insert({iHash,std::make_unique<Sampler>(inf,"manager sampler")}).first->second.get();
 }
 
 static void primitiveToVertices(
 const fg::Asset& asset,
 const fg::Primitive& primitive,
-std::vector<Vertex>& vertices)
+std::span<Vertex> vertices)
 {
-    std::size_t offset = vertices.size();
-    assert(primitive.indicesAccessor);
 	auto* posAttribute = primitive.findAttribute("POSITION");
 	assert(posAttribute != primitive.attributes.end() && "Primitive must contain POSITION attribute");
 	auto& positionAccessor = asset.accessors[posAttribute->accessorIndex];
-	vertices.resize(offset + positionAccessor.count);
+	assert(positionAccessor.count == vertices.size());
 	fg::iterateAccessorWithIndex<glm::vec3>(asset,positionAccessor,
 	[&](glm::vec3 position, std::size_t idx) 
 	{ 
-		vertices[offset+idx].pos = position; 
+		vertices[idx].pos = position; 
 	});
 
 	if (auto* attr = primitive.findAttribute("TEXCOORD_0");attr != primitive.attributes.end())
@@ -130,7 +129,7 @@ std::vector<Vertex>& vertices)
 		fg::iterateAccessorWithIndex<glm::vec2>(asset,accessor,
 		[&](glm::vec2 uv, std::size_t idx)
 		{ 
-			vertices[offset+idx].uv = uv; 
+			vertices[idx].uv = uv; 
 		});
 	}
 	if (auto* attr = primitive.findAttribute("NORMAL");attr != primitive.attributes.end())
@@ -139,7 +138,7 @@ std::vector<Vertex>& vertices)
 		fg::iterateAccessorWithIndex<glm::vec3>(asset,accessor,
 		[&](glm::vec3 norm, std::size_t idx)
 		{ 
-			vertices[offset+idx].normal = norm; 
+			vertices[idx].normal = norm; 
 		});
 	}
 	if (auto* attr = primitive.findAttribute("COLOR_0");attr != primitive.attributes.end())
@@ -150,7 +149,7 @@ std::vector<Vertex>& vertices)
 			fg::iterateAccessorWithIndex<glm::vec3>(asset,accessor,
 			[&](glm::vec3 color, std::size_t idx)
 			{ 
-				vertices[offset+idx].color = glm::vec4(color,1.f); 
+				vertices[idx].color = glm::vec4(color,1.f); 
 			});
 		}
 		else if(accessor.type == fastgltf::AccessorType::Vec4)
@@ -158,37 +157,160 @@ std::vector<Vertex>& vertices)
 			fg::iterateAccessorWithIndex<glm::vec4>(asset,accessor,
 			[&](glm::vec4 color, std::size_t idx)
 			{ 
-				vertices[offset+idx].color = color;
+				vertices[idx].color = color;
 			});
 		}
 	}
 	
 }
+// maps accessor values into [0,65535] so integer sources survive unchanged:
+// value = offset + scale * (u / 65535)
+static void positionQuantization(const fg::Accessor& accessor,glm::vec3 min,glm::vec3 max,Primitive& out)
+{
+	using CT = fg::ComponentType;
+	const bool norm = accessor.normalized;
+	switch(accessor.componentType)
+	{
+		case CT::UnsignedShort:
+			out.quantOffset = glm::vec3(0.f);
+			out.quantScale = glm::vec3(norm ? 1.f : 65535.f);
+			break;
+		case CT::Short:
+			out.quantOffset = glm::vec3(norm ? -32768.f / 32767.f : -32768.f);
+			out.quantScale = glm::vec3(norm ? 65535.f / 32767.f : 65535.f);
+			break;
+		case CT::UnsignedByte:
+			out.quantOffset = glm::vec3(0.f);
+			out.quantScale = glm::vec3(norm ? 1.f : 255.f);
+			break;
+		case CT::Byte:
+			out.quantOffset = glm::vec3(norm ? -128.f / 127.f : -128.f);
+			out.quantScale = glm::vec3(norm ? 255.f / 127.f : 255.f);
+			break;
+		default:
+			out.quantOffset = min;
+			out.quantScale = glm::max(max - min,glm::vec3(1e-20f));
+			break;
+	}
+}
+static std::uint32_t packOctahedral(glm::vec3 n)
+{
+	n /= std::max(std::abs(n.x) + std::abs(n.y) + std::abs(n.z),1e-20f);
+	glm::vec2 e(n.x,n.y);
+	if(n.z < 0.f)
+	{
+		e.x = (1.f - std::abs(n.y)) * (n.x >= 0.f ? 1.f : -1.f);
+		e.y = (1.f - std::abs(n.x)) * (n.y >= 0.f ? 1.f : -1.f);
+	}
+	return glm::packSnorm2x16(e);
+}
+static void primitiveToCompactVertices(
+const fg::Asset& asset,
+const fg::Primitive& primitive,
+std::span<CompactVertex> vertices,
+Primitive& outPrimitive)
+{
+	auto* posAttribute = primitive.findAttribute("POSITION");
+	assert(posAttribute != primitive.attributes.end() && "Primitive must contain POSITION attribute");
+	auto& positionAccessor = asset.accessors[posAttribute->accessorIndex];
+	assert(positionAccessor.count == vertices.size());
+
+	// fastgltf already undoes normalization, so values are read as floats and mapped back
+	std::vector<glm::vec3> positions(vertices.size());
+	glm::vec3 min(std::numeric_limits<float>::max()),max(std::numeric_limits<float>::lowest());
+	fg::iterateAccessorWithIndex<glm::vec3>(asset,positionAccessor,
+	[&](glm::vec3 position, std::size_t idx) 
+	{ 
+		positions[idx] = position;
+		min = glm::min(min,position);
+		max = glm::max(max,position);
+	});
+	positionQuantization(positionAccessor,min,max,outPrimitive);
+	const glm::vec3 invScale = 65535.f / outPrimitive.quantScale;
+	for(std::size_t i{};i < positions.size();i++)
+	{
+		const glm::vec3 q = (positions[i] - outPrimitive.quantOffset) * invScale;
+		for(int c{};c < 3;c++)
+		{
+			vertices[i].pos[c] = static_cast<std::uint16_t>(std::clamp(std::round(q[c]),0.f,65535.f));
+		}
+	}
+
+	if (auto* attr = primitive.findAttribute("TEXCOORD_0");attr != primitive.attributes.end())
+	{
+		auto& accessor = asset.accessors[attr->accessorIndex];
+		fg::iterateAccessorWithIndex<glm::vec2>(asset,accessor,
+		[&](glm::vec2 uv, std::size_t idx)
+		{ 
+			vertices[idx].uv = glm::packHalf2x16(uv); 
+		});
+	}
+	if (auto* attr = primitive.findAttribute("NORMAL");attr != primitive.attributes.end())
+	{
+		auto& accessor = asset.accessors[attr->accessorIndex];
+		fg::iterateAccessorWithIndex<glm::vec3>(asset,accessor,
+		[&](glm::vec3 norm, std::size_t idx)
+		{ 
+			vertices[idx].normal = packOctahedral(norm); 
+		});
+	}
+	if (auto* attr = primitive.findAttribute("COLOR_0");attr != primitive.attributes.end())
+	{
+		auto& accessor = asset.accessors[attr->accessorIndex];
+		if(accessor.type == fastgltf::AccessorType::Vec3)
+		{
+			fg::iterateAccessorWithIndex<glm::vec3>(asset,accessor,
+			[&](glm::vec3 color, std::size_t idx)
+			{ 
+				vertices[idx].color = glm::packUnorm4x8(glm::vec4(color,1.f)); 
+			});
+		}
+		else if(accessor.type == fastgltf::AccessorType::Vec4)
+		{
+			fg::iterateAccessorWithIndex<glm::vec4>(asset,accessor,
+			[&](glm::vec4 color, std::size_t idx)
+			{ 
+				vertices[idx].color = glm::packUnorm4x8(color);
+			});
+		}
+	}
+}
 static void primitiveToIndices(
 const fg::Asset& asset, 
 const fg::Primitive& primitive,
-std::vector<std::uint32_t>& indices,
+std::span<std::uint32_t> indices,
 std::size_t vStart)
 {
-	size_t offset = indices.size();
 	auto& accessor = asset.accessors[primitive.indicesAccessor.value()];
-	indices.resize(offset + accessor.count);
-	/*fastgltf::copyFromAccessor<std::uint32_t>(asset,accessor,indices.data() + offset);
-	std::for_each(std::execution::par,indices.begin() + offset,indices.end(),
-	[&](std::uint32_t& idx) { idx += vStart; });*/
+	assert(accessor.count == indices.size());
 	
 	fastgltf::iterateAccessorWithIndex<std::uint32_t>(asset, accessor, 
 	[&](std::uint32_t index, std::size_t idx) 
 	{ 
-		indices[offset+idx] = index + vStart; 
+		indices[idx] = index + vStart; 
 	});
 }
+// where decoded primitive lands inside model vertex/index buffers
+// filled by loadNode() before anything is decoded, so primitives can be processed in any order
+struct PrimitiveRange
+{
+	const fg::Primitive* src{};
+	Primitive* dst{};
+	std::size_t firstVertex{};
+	std::size_t vertexCount{};
+	std::size_t firstIdx{};
+	std::size_t idxCount{};
+	// ModelFlagBit::LODS, same indexing as model indices
+	std::vector<std::vector<std::uint32_t>> lodIndices;
+	std::vector<float> lodErrors;
+};
 static void loadNode(
 std::size_t nodeIdx, 
 const fg::Asset& asset,
 std::vector<Node>& nodes,
-std::vector<Vertex>& vBuf,
-std::vector<std::uint32_t>& iBuf)
+std::vector<PrimitiveRange>& ranges,
+std::size_t& vertexCount,
+std::size_t& idxCount)
 {
 	const auto& inNode = asset.nodes[nodeIdx];
 	auto& outNode = nodes[nodeIdx];
@@ -196,20 +318,21 @@ std::vector<std::uint32_t>& iBuf)
 	// replace with std::visit(?)
 	if (auto* trs = std::get_if<fg::TRS>(&inNode.transform))
 	{
-		outNode.matrix = glm::translate(glm::mat4(1.f),glm::make_vec3(trs->translation.data()));
-		outNode.matrix = glm::scale(outNode.matrix,glm::make_vec3(trs->scale.data()));
-		// ugly thingy, look for possible replacement
-		outNode.matrix *= glm::mat4_cast(glm::make_quat(trs->rotation.value_ptr()));
+		outNode.translation = glm::make_vec3(trs->translation.data());
+		outNode.rotation = glm::make_quat(trs->rotation.value_ptr());
+		outNode.scale = glm::make_vec3(trs->scale.data());
+		outNode.matrix = composeTransform(outNode.translation,outNode.rotation,outNode.scale);
 	}
 	else if (auto* mat = std::get_if<fg::math::fmat4x4>(&inNode.transform))
 	{
 		outNode.matrix = glm::make_mat4(mat->data());
+		decomposeTransform(outNode.matrix,outNode.translation,outNode.rotation,outNode.scale);
 	}
 
 	if (inNode.meshIndex)
 	{
 		const auto& inMesh = asset.meshes[inNode.meshIndex.value()];
-		outNode.mesh.primitives.resize(inMesh.primitives.size());
+		outNode.mesh.primitives.reserve(inMesh.primitives.size());
 	
 		for (auto it = inMesh.primitives.begin(); it != inMesh.primitives.end(); ++it) 
 		{
@@ -221,14 +344,21 @@ std::vector<std::uint32_t>& iBuf)
 			{
 				primitive.materialIdx = it->materialIndex.value() + 1;// default material
 			}
-			
-			std::size_t vStart = vBuf.size();
-			primitiveToVertices(asset,*it,vBuf);						 
-			primitive.firstIdx = iBuf.size();
-			
-			primitiveToIndices(asset,*it,iBuf,vStart);
-			primitive.idxCount = iBuf.size() - primitive.firstIdx;
-			outNode.mesh.primitives.emplace_back(std::move(primitive));
+			auto* posAttribute = it->findAttribute("POSITION");
+			assert(posAttribute != it->attributes.end() && "Primitive must contain POSITION attribute");
+			assert(it->indicesAccessor);
+
+			PrimitiveRange range{.src = &*it,.firstVertex = vertexCount,.firstIdx = idxCount};
+			range.vertexCount = asset.accessors[posAttribute->accessorIndex].count;
+			range.idxCount = asset.accessors[it->indicesAccessor.value()].count;
+			vertexCount += range.vertexCount;
+			idxCount += range.idxCount;
+
+			primitive.firstIdx = range.firstIdx;
+			primitive.idxCount = range.idxCount;
+			// primitives were reserved, so pointer stays valid
+			range.dst = &outNode.mesh.primitives.emplace_back(std::move(primitive));
+			ranges.push_back(range);
 		}
 	}
 	outNode.children.resize(inNode.children.size());
@@ -238,15 +368,285 @@ std::vector<std::uint32_t>& iBuf)
 		nodes[childIdx].parent = nodeIdx;
 	});
 }
+static glm::vec3 vertexPosition(const Vertex& v,const Primitive&)
+{
+	return v.pos;
+}
+static glm::vec3 vertexPosition(const CompactVertex& v,const Primitive& p)
+{
+	return p.quantOffset + p.quantScale * glm::vec3(v.pos[0],v.pos[1],v.pos[2]) / 65535.f;
+}
+// only one of vertex spans is filled, depending on ModelFlagBit::COMPACT_VERTICES
+static std::vector<glm::vec3> primitivePositions(
+const PrimitiveRange& r,
+std::span<const Vertex> vertices,
+std::span<const CompactVertex> compactVertices)
+{
+	std::vector<glm::vec3> positions(r.vertexCount);
+	for(std::size_t v{};v < r.vertexCount;v++)
+	{
+		positions[v] = compactVertices.empty() ?
+		vertexPosition(vertices[r.firstVertex + v],*r.dst) :
+		vertexPosition(compactVertices[r.firstVertex + v],*r.dst);
+	}
+	return positions;
+}
+static void computeBounds(
+const std::vector<PrimitiveRange>& ranges,
+std::span<const Vertex> vertices,
+std::span<const CompactVertex> compactVertices)
+{
+	defaultThreadPool().parallelFor(ranges.size(),[&](std::size_t i)
+	{
+		const auto positions = primitivePositions(ranges[i],vertices,compactVertices);
+		if(positions.empty()) return;
+		glm::vec3 min(std::numeric_limits<float>::max()),max(std::numeric_limits<float>::lowest());
+		for(const auto& p : positions)
+		{
+			min = glm::min(min,p);
+			max = glm::max(max,p);
+		}
+		auto& dst = *ranges[i].dst;
+		dst.aabbMin = min;
+		dst.aabbMax = max;
+		dst.center = (min + max) * 0.5f;
+		for(const auto& p : positions) dst.radius = std::max(dst.radius,glm::distance(dst.center,p));
+	});
+}
+// every level halves triangle count of the previous one, simplified from it,
+// so error of level is bounded by sum of errors on the way there
+static void generateLods(
+std::vector<PrimitiveRange>& ranges,
+std::span<const Vertex> vertices,
+std::span<const CompactVertex> compactVertices,
+std::span<const std::uint32_t> indices)
+{
+	constexpr std::size_t maxLevels = 4;
+	constexpr std::size_t minIdxCount = 3 * 32;
+	// relative to primitive radius, coarser levels aren't worth storing
+	constexpr float maxRelativeError = 0.1f;
+	defaultThreadPool().parallelFor(ranges.size(),[&](std::size_t i)
+	{
+		auto& r = ranges[i];
+		const auto positions = primitivePositions(r,vertices,compactVertices);
+		const auto firstVertex = static_cast<std::uint32_t>(r.firstVertex);
+		std::vector<std::uint32_t> prev(indices.begin() + r.firstIdx,indices.begin() + r.firstIdx + r.idxCount);
+		for(auto& idx : prev) idx -= firstVertex;
+		float error{};
+		for(std::size_t level{};level < maxLevels && prev.size() > minIdxCount;level++)
+		{
+			const float budget = r.dst->radius * maxRelativeError - error;
+			if(budget <= 0.f) break;
+			const std::size_t target = prev.size() / 6 * 3;
+			float levelError{};
+			auto lod = simplify(prev,positions,target,budget,&levelError);
+			// not enough progress, next levels won't do better
+			if(lod.size() > prev.size() * 9 / 10) break;
+			error += levelError;
+			prev = lod;
+			optimizeVertexCache(lod,positions.size());
+			for(auto& idx : lod) idx += firstVertex;
+			r.lodIndices.push_back(std::move(lod));
+			r.lodErrors.push_back(error);
+		}
+	});
+}
+// lods of unpacked models go after all primitives
+static void appendLods(const std::vector<PrimitiveRange>& ranges,std::vector<std::uint32_t>& indices)
+{
+	for(const auto& r : ranges)
+	{
+		for(std::size_t l{};l < r.lodIndices.size();l++)
+		{
+			r.dst->lods.push_back({
+				.firstIdx = static_cast<std::uint32_t>(indices.size()),
+				.idxCount = static_cast<std::uint32_t>(r.lodIndices[l].size()),
+				.error = r.lodErrors[l]});
+			indices.insert(indices.end(),r.lodIndices[l].begin(),r.lodIndices[l].end());
+		}
+	}
+}
+// every primitive is optimized on its own and shrinks in place,
+// then vertices and indices are packed again and ranges are updated to match
+template<typename V>
+static void optimizePrimitives(
+std::vector<PrimitiveRange>& ranges,
+std::vector<V>& vertices,
+std::vector<std::uint32_t>& indices)
+{
+	struct Result
+	{
+		std::vector<V> vertices;
+		std::vector<std::uint32_t> indices;
+	};
+	std::vector<Result> results(ranges.size());
+	defaultThreadPool().parallelFor(ranges.size(),[&](std::size_t i)
+	{
+		const auto& r = ranges[i];
+		auto& out = results[i];
+		out.vertices.assign(vertices.begin() + r.firstVertex,vertices.begin() + r.firstVertex + r.vertexCount);
+		out.indices.resize(r.idxCount);
+		for(std::size_t k{};k < r.idxCount;k++) out.indices[k] = indices[r.firstIdx + k] - static_cast<std::uint32_t>(r.firstVertex);
+
+		auto bytes = std::as_writable_bytes(std::span(out.vertices));
+		weldVertices(out.indices,bytes,sizeof(V));
+		optimizeVertexCache(out.indices,out.vertices.size());
+		std::vector<glm::vec3> positions(out.vertices.size());
+		for(std::size_t v{};v < positions.size();v++) positions[v] = vertexPosition(out.vertices[v],*r.dst);
+		optimizeOverdraw(out.indices,positions);
+		out.vertices.resize(optimizeVertexFetch(out.indices,bytes,sizeof(V)));
+	});
+	vertices.clear();
+	indices.clear();
+	for(std::size_t i{};i < ranges.size();i++)
+	{
+		auto& r = ranges[i];
+		const auto& res = results[i];
+		r.firstVertex = vertices.size();
+		r.vertexCount = res.vertices.size();
+		r.firstIdx = indices.size();
+		r.idxCount = res.indices.size();
+		vertices.insert(vertices.end(),res.vertices.begin(),res.vertices.end());
+		for(auto idx : res.indices) indices.push_back(idx + static_cast<std::uint32_t>(r.firstVertex));
+	}
+}
+// indices become relative to primitive vertex range(drawn with base vertex)
+// which lets most primitives fit into 16 bits, ranges of different types are aligned to their own size
+static std::vector<std::byte> packIndices(const std::vector<PrimitiveRange>& ranges,std::span<const std::uint32_t> indices)
+{
+	std::vector<std::byte> out;
+	for(const auto& r : ranges)
+	{
+		auto& dst = *r.dst;
+		dst.idxType = r.vertexCount <= 0x10000 ? IndexType::USHORT : IndexType::UINT;
+		dst.vertexOffset = static_cast<std::int32_t>(r.firstVertex);
+		const auto size = indexSize(dst.idxType);
+		out.resize((out.size() + size - 1) / size * size);
+		// returns first element of written range
+		auto write = [&](std::span<const std::uint32_t> src)
+		{
+			const auto first = static_cast<std::uint32_t>(out.size() / size);
+			out.resize(out.size() + src.size() * size);
+			auto* dstBytes = out.data() + static_cast<std::size_t>(first) * size;
+			for(std::size_t k{};k < src.size();k++)
+			{
+				const std::uint32_t idx = src[k] - static_cast<std::uint32_t>(r.firstVertex);
+				if(size == 2)
+				{
+					const auto narrow = static_cast<std::uint16_t>(idx);
+					std::memcpy(dstBytes + k * 2,&narrow,2);
+				}
+				else
+				{
+					std::memcpy(dstBytes + k * 4,&idx,4);
+				}
+			}
+			return first;
+		};
+		dst.firstIdx = write(indices.subspan(r.firstIdx,r.idxCount));
+		dst.idxCount = static_cast<std::uint32_t>(r.idxCount);
+		for(std::size_t l{};l < r.lodIndices.size();l++)
+		{
+			dst.lods.push_back({
+				.firstIdx = write(r.lodIndices[l]),
+				.idxCount = static_cast<std::uint32_t>(r.lodIndices[l].size()),
+				.error = r.lodErrors[l]});
+		}
+	}
+	return out;
+}
+// every primitive is split on its own, then meshlets are concatenated in primitive order
+static std::vector<Meshlet> buildModelMeshlets(
+const std::vector<PrimitiveRange>& ranges,
+std::span<const Vertex> vertices,
+std::span<const CompactVertex> compactVertices,
+std::span<const std::uint32_t> indices)
+{
+	std::vector<std::vector<Meshlet>> perPrimitive(ranges.size());
+	defaultThreadPool().parallelFor(ranges.size(),[&](std::size_t i)
+	{
+		const auto& r = ranges[i];
+		const auto positions = primitivePositions(r,vertices,compactVertices);
+		buildMeshlets(indices.subspan(r.firstIdx,r.idxCount),positions,
+		static_cast<std::uint32_t>(r.firstVertex),r.dst->firstIdx,perPrimitive[i]);
+		for(auto& m : perPrimitive[i]) m.vertexOffset = r.dst->vertexOffset;
+	});
+	std::vector<Meshlet> out;
+	for(std::size_t i{};i < ranges.size();i++)
+	{
+		ranges[i].dst->firstMeshlet = static_cast<std::uint32_t>(out.size());
+		ranges[i].dst->meshletCount = static_cast<std::uint32_t>(perPrimitive[i].size());
+		out.insert(out.end(),perPrimitive[i].begin(),perPrimitive[i].end());
+	}
+	return out;
+}
+// occluders only have to cover roughly the same pixels, so they're simplified hard
+// and keep only positions of vertices they use
+static void buildOccluders(
+const std::vector<PrimitiveRange>& ranges,
+std::span<const Vertex> vertices,
+std::span<const CompactVertex> compactVertices,
+std::span<const std::uint32_t> indices,
+GLTFModel& model)
+{
+	constexpr std::size_t minIdxCount = 3 * 16;
+	// relative to primitive radius, occluder shouldn't stick out of the original much
+	constexpr float maxRelativeError = 0.02f;
+	struct Occluder
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<std::uint32_t> indices;
+	};
+	std::vector<Occluder> perPrimitive(ranges.size());
+	defaultThreadPool().parallelFor(ranges.size(),[&](std::size_t i)
+	{
+		const auto& r = ranges[i];
+		auto& out = perPrimitive[i];
+		out.positions = primitivePositions(r,vertices,compactVertices);
+		std::vector<std::uint32_t> local(indices.begin() + r.firstIdx,indices.begin() + r.firstIdx + r.idxCount);
+		for(auto& idx : local) idx -= static_cast<std::uint32_t>(r.firstVertex);
+		const std::size_t target = std::max(minIdxCount,local.size() / 24 * 3);
+		out.indices = local.size() > target ? simplify(local,out.positions,target,r.dst->radius * maxRelativeError) : std::move(local);
+		const auto used = optimizeVertexFetch(out.indices,std::as_writable_bytes(std::span(out.positions)),sizeof(glm::vec3));
+		out.positions.resize(used);
+	});
+	for(std::size_t i{};i < ranges.size();i++)
+	{
+		auto& o = perPrimitive[i];
+		const auto base = static_cast<std::uint32_t>(model.occluderPositions.size());
+		ranges[i].dst->firstOccluderIdx = static_cast<std::uint32_t>(model.occluderIndices.size());
+		ranges[i].dst->occluderIdxCount = static_cast<std::uint32_t>(o.indices.size());
+		model.occluderPositions.insert(model.occluderPositions.end(),o.positions.begin(),o.positions.end());
+		for(auto idx : o.indices) model.occluderIndices.push_back(idx + base);
+	}
+}
+VertexInputState defaultVertexInputState()
+{
+	return {
+		{.location = 0,.binding = 0,.offset = offsetof(Vertex,pos),.fmt = Format::RGB32F},
+		{.location = 1,.binding = 0,.offset = offsetof(Vertex,normal),.fmt = Format::RGB32F},
+		{.location = 2,.binding = 0,.offset = offsetof(Vertex,uv),.fmt = Format::RG32F},
+		{.location = 3,.binding = 0,.offset = offsetof(Vertex,color),.fmt = Format::RGBA32F},
+	};
+}
+VertexInputState compactVertexInputState()
+{
+	return {
+		{.location = 0,.binding = 0,.offset = offsetof(CompactVertex,pos),.fmt = Format::RGBA16},
+		{.location = 1,.binding = 0,.offset = offsetof(CompactVertex,normal),.fmt = Format::RG16_SNORM},
+		{.location = 2,.binding = 0,.offset = offsetof(CompactVertex,uv),.fmt = Format::RG16F},
+		{.location = 3,.binding = 0,.offset = offsetof(CompactVertex,color),.fmt = Format::RGBA8},
+	};
+}
+static constexpr auto supportedExtensions =
+	fg::Extensions::KHR_materials_variants	|
+	fg::Extensions::KHR_mesh_quantization	|
+	fg::Extensions::KHR_texture_basisu;
+
 fg::Error loadGltf(std::filesystem::path path,fg::Asset* asset) 
 {
     if (!std::filesystem::exists(path)) return fg::Error::InvalidPath;
 
-    static constexpr auto supportedExtensions =
-    	fg::Extensions::KHR_materials_variants	|
-        fg::Extensions::KHR_mesh_quantization	|
-        fg::Extensions::KHR_texture_basisu;
-
     fg::Parser parser(supportedExtensions);
 
     constexpr auto gltfOptions =
@@ -261,40 +661,136 @@ fg::Error loadGltf(std::filesystem::path path,fg::Asset* asset)
     *asset = std::move(res.get());
     return fg::Error::None;
 }
-static std::vector<const Texture*> loadImages(const fg::Asset& asset,Manager& m,std::uint64_t hash) 
+// uris of .bin and image files, loadGltf() loads them into memory and forgets where they came from
+static std::vector<std::filesystem::path> externalFilePaths(const std::filesystem::path& path)
 {
-	std::vector<const Texture*> images;
+	fg::Parser parser(supportedExtensions);
+	auto gltfFile = fg::MappedGltfFile::FromPath(path);
+	auto res = parser.loadGltf(gltfFile.get(),path.parent_path(),fg::Options::DontRequireValidAssetMember,fg::Category::Buffers | fg::Category::Images);
+	if(res.error() != fg::Error::None)
+	{
+		throw AssetException("Failed to load model ",path.string(),"\nReason:",fg::getErrorMessage(res.error()));
+	}
+	std::vector<std::filesystem::path> paths;
+	auto addLocal = [&](const auto& source)
+	{
+		if(auto* uri = std::get_if<fg::sources::URI>(&source); uri && uri->uri.isLocalPath())
+		{
+			paths.emplace_back(std::string(uri->uri.path()));
+		}
+	};
+	for(const auto& buffer : res.get().buffers) addLocal(buffer.data);
+	for(const auto& image : res.get().images) addLocal(image.data);
+	return paths;
+}
+static std::vector<CookedImage> gatherImages(const fg::Asset& asset)
+{
+	std::vector<CookedImage> images;
 	images.reserve(asset.images.size());
-	// std::transform does not change size and can't resize() cause no default ctor
-	for(std::uint32_t i{};i<asset.images.size();i++)
+	for(const auto& image : asset.images)
 	{
-		if (auto* path = std::get_if<fg::sources::URI>(&asset.images[i].data)) 
+		if (auto* path = std::get_if<fg::sources::URI>(&image.data)) 
 		{
 			assert(path->fileByteOffset == 0);
 			assert(path->uri.isLocalPath());
-			images.push_back(m.getTexture(hash + i,path->uri.path()));
+			images.push_back({.path = path->uri.path()});
 		} 
-		else if (auto* vector = std::get_if<fg::sources::Array>(&asset.images[i].data)) 
+		else if (auto* vector = std::get_if<fg::sources::Array>(&image.data)) 
 		{
-			images.push_back(m.getTexture(hash + i,vector->bytes.data(), vector->bytes.size()));
+			images.push_back({.bytes = vector->bytes});
 		} 
-		else if (auto* view = std::get_if<fg::sources::BufferView>(&asset.images[i].data)) 
+		else if (auto* view = std::get_if<fg::sources::BufferView>(&image.data)) 
 		{
 			auto& bufferView = asset.bufferViews[view->bufferViewIndex];
 			auto& buffer = asset.buffers[bufferView.bufferIndex];
 			if (auto* vector = std::get_if<fg::sources::Array>(&buffer.data)) 
 			{
-				auto tex = m.getTexture(hash + i,vector->bytes.data() + bufferView.byteOffset, bufferView.byteLength);
-				images.push_back(tex);
+				images.push_back({.bytes = std::span(vector->bytes).subspan(bufferView.byteOffset,bufferView.byteLength)});
 			}
 		}
 		else
 		{
-			throw bs::AssetException(asset.images[i].name," unknown texture source(this should not happen at all)");
+			throw bs::AssetException(image.name," unknown texture source(this should not happen at all)");
 		}
 	}
 	return images;
 }
+// decoding/transcoding runs on worker threads, only texture creation and upload stay on the calling thread
+// images are uploaded in the order they finish decoding, not in the order they're declared in
+static std::vector<const Texture*> loadImages(std::span<const CookedImage> sources,Manager& m,std::uint64_t hash) 
+{
+	std::vector<const Texture*> images(sources.size());
+
+	struct Decoded
+	{
+		std::uint32_t idx{};
+		std::optional<DecodedImage> image;
+		std::exception_ptr error;
+	};
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::vector<Decoded> finished;
+	std::size_t pending{};
+
+	for(std::uint32_t i{};i<sources.size();i++)
+	{
+		if(m.containsTexture(hash + i))
+		{
+			images[i] = m.getTexture(hash + i);
+			continue;
+		}
+		pending++;
+		// path is copied, stbi wants null terminated string
+		defaultThreadPool().submit([&,i,path = std::string(sources[i].path),bytes = sources[i].bytes]
+		{
+			Decoded out{.idx = i};
+			try
+			{
+				out.image = path.empty() ? decodeImage(bytes.data(),bytes.size()) : decodeImage(path);
+			}
+			catch(...)
+			{
+				out.error = std::current_exception();
+			}
+			std::scoped_lock lock(mutex);
+			finished.push_back(std::move(out));
+			cv.notify_one();
+		});
+	}
+	std::exception_ptr error;
+	std::vector<Decoded> batch;
+	while(pending)
+	{
+		{
+			std::unique_lock lock(mutex);
+			cv.wait(lock,[&]{ return !finished.empty(); });
+			std::swap(batch,finished);
+		}
+		for(auto& d : batch)
+		{
+			pending--;
+			if(d.error)
+			{
+				if(!error) error = d.error;
+				continue;
+			}
+			if(error) continue;
+			// jobs still reference this frame, so upload errors wait for them like decode errors
+			try
+			{
+				m.insertTexture(hash + d.idx,uploadImage(*d.image));
+				images[d.idx] = m.getTexture(hash + d.idx);
+			}
+			catch(...)
+			{
+				error = std::current_exception();
+			}
+		}
+		batch.clear();
+	}
+	if(error) std::rethrow_exception(error);
+	return images;
+}
 static std::vector<GltfTexture> loadTextures(const fg::Asset& asset)
 {
 	std::vector<GltfTexture> textures;
@@ -339,14 +835,18 @@ static std::vector<const Sampler*> loadSamplers(const fg::Asset& asset,Manager&
 	});
 	return samplers;
 }
-static std::vector<Material> loadMaterials(const fg::Asset& asset,GLTFModel& model)
+// bindless handles are made separately by bindMaterialTextures(), cooked models go through it too
+static std::vector<Material> loadMaterials(const fg::Asset& asset,std::vector<CookedMaterialTextures>& textures)
 {
 	std::vector<Material> materials;
 	materials.reserve(asset.materials.size() + 1);
+	textures.reserve(asset.materials.size() + 1);
 	materials.emplace_back(Material{.baseColorFactor = glm::vec4(1.f)}); // default material
-	bs::Material temp{};
+	textures.emplace_back();
 	for(const auto& mat : asset.materials)
 	{
+		bs::Material temp{};
+		CookedMaterialTextures tex{};
 		temp.baseColorFactor = glm::make_vec4(mat.pbrData.baseColorFactor.data());
 		switch(mat.alphaMode)
 		{
@@ -360,33 +860,214 @@ static std::vector<Material> loadMaterials(const fg::Asset& asset,GLTFModel& mod
 		if (mat.pbrData.baseColorTexture) 
 		{
 			temp.flags |= MaterialFlags::HasBaseColorTexture;
-			auto gltfTexture = model.textures[mat.pbrData.baseColorTexture.value().textureIndex];
-			auto& image = model.images[gltfTexture.imageIdx];
-			temp.baseColorTexture = image->makeBindless(*model.samplers[gltfTexture.samplerIdx]);
+			tex.baseColor = mat.pbrData.baseColorTexture.value().textureIndex;
 		}
 		if (mat.pbrData.metallicRoughnessTexture) 
 		{
 			temp.flags |= MaterialFlags::HasMetallicRoughnessTexture;
-			auto gltfTexture = model.textures[mat.pbrData.metallicRoughnessTexture.value().textureIndex];
-			auto& image = model.images[gltfTexture.imageIdx];
-			temp.metallicRoughnessTexture = image->makeBindless(*model.samplers[gltfTexture.samplerIdx]);
+			tex.metallicRoughness = mat.pbrData.metallicRoughnessTexture.value().textureIndex;
 		}
 		materials.push_back(std::move(temp));
+		textures.push_back(tex);
 	}
 	return materials;
 }
+static void bindMaterialTextures(GLTFModel& model,std::span<const CookedMaterialTextures> textures)
+{
+	assert(model.materials.size() == textures.size());
+	auto makeHandle = [&](std::int32_t textureIdx) -> std::uint64_t
+	{
+		if(textureIdx < 0 || !GLAD_GL_ARB_bindless_texture) return 0;
+		auto gltfTexture = model.textures[textureIdx];
+		auto& image = model.images[gltfTexture.imageIdx];
+		return image->makeBindless(*model.samplers[gltfTexture.samplerIdx]);
+	};
+	for(std::size_t i{};i < textures.size();i++)
+	{
+		model.materials[i].baseColorTexture = makeHandle(textures[i].baseColor);
+		model.materials[i].metallicRoughnessTexture = makeHandle(textures[i].metallicRoughness);
+	}
+}
+// node tree is stored as flat tables, every node references its own range in each of them
+static void cookNodes(
+const std::vector<Node>& nodes,
+std::vector<CookedNode>& outNodes,
+std::vector<CookedPrimitive>& outPrimitives,
+std::vector<std::int64_t>& outMappings,
+std::vector<std::uint64_t>& outChildren,
+std::vector<PrimitiveLod>& outLods)
+{
+	outNodes.reserve(nodes.size());
+	for(const auto& node : nodes)
+	{
+		outNodes.push_back({
+			.matrix = node.matrix,
+			.translation = node.translation,
+			.scale = node.scale,
+			.rotation = node.rotation,
+			.parent = node.parent,
+			.firstPrimitive = static_cast<std::uint32_t>(outPrimitives.size()),
+			.primitiveCount = static_cast<std::uint32_t>(node.mesh.primitives.size()),
+			.firstChild = static_cast<std::uint32_t>(outChildren.size()),
+			.childCount = static_cast<std::uint32_t>(node.children.size())
+		});
+		for(const auto& p : node.mesh.primitives)
+		{
+			outPrimitives.push_back({
+				.quantOffset = p.quantOffset,
+				.quantScale = p.quantScale,
+				.firstIdx = p.firstIdx,
+				.idxCount = p.idxCount,
+				.materialIdx = p.materialIdx,
+				.firstMapping = static_cast<std::uint32_t>(outMappings.size()),
+				.mappingCount = static_cast<std::uint32_t>(p.mappings.size()),
+				.firstMeshlet = p.firstMeshlet,
+				.meshletCount = p.meshletCount,
+				.idxType = p.idxType,
+				.vertexOffset = p.vertexOffset,
+				.center = p.center,
+				.radius = p.radius,
+				.aabbMin = p.aabbMin,
+				.aabbMax = p.aabbMax,
+				.firstLod = static_cast<std::uint32_t>(outLods.size()),
+				.lodCount = static_cast<std::uint32_t>(p.lods.size()),
+				.firstOccluderIdx = p.firstOccluderIdx,
+				.occluderIdxCount = p.occluderIdxCount
+			});
+			outLods.insert(outLods.end(),p.lods.begin(),p.lods.end());
+			for(const auto& m : p.mappings) outMappings.push_back(m ? static_cast<std::int64_t>(*m) : -1);
+		}
+		outChildren.insert(outChildren.end(),node.children.begin(),node.children.end());
+	}
+}
+static std::vector<Node> uncookNodes(const CookedModel& cooked)
+{
+	std::vector<Node> nodes(cooked.nodes.size());
+	for(std::size_t i{};i < nodes.size();i++)
+	{
+		const auto& in = cooked.nodes[i];
+		auto& out = nodes[i];
+		out.matrix = in.matrix;
+		out.translation = in.translation;
+		out.scale = in.scale;
+		out.rotation = in.rotation;
+		out.parent = in.parent;
+		out.mesh.primitives.reserve(in.primitiveCount);
+		for(const auto& p : cooked.primitives.subspan(in.firstPrimitive,in.primitiveCount))
+		{
+			Primitive primitive{.firstIdx = p.firstIdx,.idxCount = p.idxCount,.materialIdx = p.materialIdx};
+			primitive.quantOffset = p.quantOffset;
+			primitive.quantScale = p.quantScale;
+			primitive.firstMeshlet = p.firstMeshlet;
+			primitive.meshletCount = p.meshletCount;
+			primitive.idxType = p.idxType;
+			primitive.vertexOffset = p.vertexOffset;
+			primitive.center = p.center;
+			primitive.radius = p.radius;
+			primitive.aabbMin = p.aabbMin;
+			primitive.aabbMax = p.aabbMax;
+			primitive.firstOccluderIdx = p.firstOccluderIdx;
+			primitive.occluderIdxCount = p.occluderIdxCount;
+			auto lods = cooked.lods.subspan(p.firstLod,p.lodCount);
+			primitive.lods.assign(lods.begin(),lods.end());
+			primitive.mappings.reserve(p.mappingCount);
+			for(auto m : cooked.mappings.subspan(p.firstMapping,p.mappingCount))
+			{
+				primitive.mappings.push_back(m < 0 ? std::nullopt : std::optional<std::size_t>(m));
+			}
+			out.mesh.primitives.push_back(std::move(primitive));
+		}
+		auto children = cooked.children.subspan(in.firstChild,in.childCount);
+		out.children.assign(children.begin(),children.end());
+	}
+	return nodes;
+}
+// shifts every index range of model by where its geometry landed inside arena
+static void rebaseOnArena(GLTFModel& model)
+{
+	const auto baseVertex = static_cast<std::int32_t>(model.vertexAllocation.offset / model.vertexStride);
+	for(auto& node : model.nodes)
+	{
+		for(auto& p : node.mesh.primitives)
+		{
+			const auto baseIdx = static_cast<std::uint32_t>(model.idxAllocation.offset / indexSize(p.idxType));
+			p.firstIdx += baseIdx;
+			p.vertexOffset += baseVertex;
+			for(auto& lod : p.lods) lod.firstIdx += baseIdx;
+			for(std::uint32_t i = p.firstMeshlet;i < p.firstMeshlet + p.meshletCount;i++)
+			{
+				model.meshlets[i].firstIdx += baseIdx;
+				model.meshlets[i].vertexOffset += baseVertex;
+			}
+		}
+	}
+}
+// model owns its buffers unless arena is provided
+static void uploadGeometry(
+GLTFModel& model,
+GeometryArena* arena,
+std::span<const std::byte> vertices,
+std::span<const std::byte> indices)
+{
+	if(arena)
+	{
+		model.arena = arena;
+		model.vertexAllocation = arena->allocateVertices(vertices,model.vertexStride);
+		model.idxAllocation = arena->allocateIndices(indices);
+		rebaseOnArena(model);
+	}
+	else
+	{
+		model.vertexBuffer = BASIS::Buffer(vertices,0);
+		model.idxBuffer = BASIS::Buffer(indices,0);
+	}
+	if(!model.meshlets.empty()) model.meshletBuffer = BASIS::Buffer(std::span<const Meshlet>(model.meshlets),0);
+}
+static GLTFModel loadCookedModel(const CookedModel& cooked,Manager& m,std::uint64_t hash,GeometryArena* arena)
+{
+	GLTFModel outModel;
+	outModel.materialVariants.assign(cooked.materialVariants.begin(),cooked.materialVariants.end());
+	outModel.images = loadImages(cooked.images,m,hash);
+	outModel.textures.assign(cooked.textures.begin(),cooked.textures.end());
+	outModel.samplers.reserve(cooked.samplers.size());
+	for(const auto& info : cooked.samplers) outModel.samplers.push_back(m.getSampler(info));
+	outModel.materials.assign(cooked.materials.begin(),cooked.materials.end());
+	bindMaterialTextures(outModel,cooked.materialTextures);
+	outModel.materialBuffer = m.materialUploadCallback(outModel.materials);
+	outModel.nodes = uncookNodes(cooked);
+	outModel.flags = ModelFlags(cooked.flags);
+	outModel.vertexStride = outModel.flags & ModelFlagBit::COMPACT_VERTICES ? sizeof(CompactVertex) : sizeof(Vertex);
+	outModel.meshlets.assign(cooked.meshlets.begin(),cooked.meshlets.end());
+	outModel.occluderPositions.assign(cooked.occluderPositions.begin(),cooked.occluderPositions.end());
+	outModel.occluderIndices.assign(cooked.occluderIndices.begin(),cooked.occluderIndices.end());
+	// straight from the mapping, no intermediate copies
+	uploadGeometry(outModel,arena,cooked.vertices,cooked.indices);
+	return outModel;
+}
 const GLTFModel* Manager::getModel(std::uint64_t uniqueHash)
 {
 	if(auto it = m_models.find(uniqueHash);it != m_models.end()) return it->second.get();
 	throw AssetException("getModel() can't return model with such hash as it doesn't exist");
 }
-const GLTFModel* Manager::getModel(std::uint64_t uniqueHash,std::string_view path)
+const GLTFModel* Manager::getModel(std::uint64_t uniqueHash,std::string_view path,ModelFlags flags)
 {
 	if(auto it = m_models.find(uniqueHash);it != m_models.end()) return it->second.get();
+	BASIS_PROFILE_ZONE("Manager::getModel");
 	
 	assert(materialUploadCallback && "Material upload callback not set");
 	if(!std::filesystem::exists(path)) throw FileException(path," does not exist");
 	
+	std::filesystem::path cookedPath;
+	if(!modelCacheDirectory.empty())
+	{
+		cookedPath = cookedModelPath(modelCacheDirectory,path);
+		if(auto cooked = CookedModelFile::open(cookedPath,path,static_cast<std::uint32_t>(flags)))
+		{
+			BASIS_PROFILE_ZONE("Manager::loadCookedModel");
+			auto model = std::make_unique<GLTFModel>(loadCookedModel(cooked->model,*this,uniqueHash,m_geometryArena.get()));
+			return m_models.insert({uniqueHash,std::move(model)}).first->second.get();
+		}
+	}
 	fastgltf::Asset asset;
 	if (auto err = loadGltf(path,&asset);err != fg::Error::None)
 	{
@@ -394,25 +1075,118 @@ const GLTFModel* Manager::getModel(std::uint64_t uniqueHash,std::string_view pat
 	}
 
 	GLTFModel outModel;
+	const auto imageSources = gatherImages(asset);
+	std::vector<CookedMaterialTextures> materialTextures;
 	outModel.materialVariants = std::move(asset.materialVariants);
-	outModel.images = loadImages(asset,*this,uniqueHash);
+	outModel.images = loadImages(imageSources,*this,uniqueHash);
 	outModel.textures = loadTextures(asset);
 	outModel.samplers = loadSamplers(asset,*this);
-	outModel.materials = loadMaterials(asset,outModel);
+	outModel.materials = loadMaterials(asset,materialTextures);
+	bindMaterialTextures(outModel,materialTextures);
 	outModel.materialBuffer = materialUploadCallback(outModel.materials);
 	outModel.nodes.resize(asset.nodes.size());
-    std::vector<uint32_t> iBuf;
-	std::vector<Vertex> vBuf;
-	// do not try to reduce amount of arguments
-	// nodeIdx is needed because s doesn't tell us the index of processed node
+	// first pass only walks the node tree and assigns every primitive its own vertex/index range
+	// nodeIdx is needed because asset.nodes doesn't tell us the index of processed node
 	// and it can't be removed, because we set child indexes inside loadNode()
 	// so parent node needs to be initialized
+	std::vector<PrimitiveRange> ranges;
+	std::size_t vertexCount{},idxCount{};
 	for (std::size_t nodeIdx{};nodeIdx < asset.nodes.size();nodeIdx++) 
 	{
-		loadNode(nodeIdx, asset,outModel.nodes, vBuf,iBuf);
+		loadNode(nodeIdx, asset,outModel.nodes,ranges,vertexCount,idxCount);
+	}
+	// second pass decodes primitives concurrently, each one writes only into its own range
+	// so the result is exactly the same as decoding them one after another
+	std::vector<Vertex> vBuf;
+	std::vector<CompactVertex> compactBuf;
+	std::vector<std::uint32_t> iBuf(idxCount);
+	const bool compact = static_cast<bool>(flags & ModelFlagBit::COMPACT_VERTICES);
+	compact ? compactBuf.resize(vertexCount) : vBuf.resize(vertexCount);
+	defaultThreadPool().parallelFor(ranges.size(),[&](std::size_t i)
+	{
+		BASIS_PROFILE_ZONE("Manager::decodePrimitive");
+		const auto& r = ranges[i];
+		if(compact)
+		{
+			auto dst = std::span(compactBuf).subspan(r.firstVertex,r.vertexCount);
+			primitiveToCompactVertices(asset,*r.src,dst,*r.dst);
+		}
+		else
+		{
+			primitiveToVertices(asset,*r.src,std::span(vBuf).subspan(r.firstVertex,r.vertexCount));
+		}
+		primitiveToIndices(asset,*r.src,std::span(iBuf).subspan(r.firstIdx,r.idxCount),r.firstVertex);
+	});
+	computeBounds(ranges,vBuf,compactBuf);
+	const bool optimize = static_cast<bool>(flags & ModelFlagBit::OPTIMIZE);
+	if(optimize)
+	{
+		compact ? optimizePrimitives(ranges,compactBuf,iBuf) : optimizePrimitives(ranges,vBuf,iBuf);
+	}
+	if(flags & ModelFlagBit::LODS) generateLods(ranges,vBuf,compactBuf,iBuf);
+	std::vector<std::byte> packedIndices;
+	if(optimize)
+	{
+		packedIndices = packIndices(ranges,iBuf);
+	}
+	else
+	{
+		appendLods(ranges,iBuf);
 	}
-	outModel.vertexBuffer = BASIS::Buffer(std::span<Vertex>(vBuf),0);
-	outModel.idxBuffer = BASIS::Buffer(std::span<uint32_t>(iBuf),0);
+	const auto vertexBytes = compact ? std::as_bytes(std::span(compactBuf)) : std::as_bytes(std::span(vBuf));
+	const auto idxBytes = packedIndices.empty() ? std::as_bytes(std::span(iBuf)) : std::span<const std::byte>(packedIndices);
+	outModel.flags = flags;
+	outModel.vertexStride = compact ? sizeof(CompactVertex) : sizeof(Vertex);
+	if(flags & ModelFlagBit::MESHLETS) outModel.meshlets = buildModelMeshlets(ranges,vBuf,compactBuf,iBuf);
+	if(flags & ModelFlagBit::OCCLUDERS) buildOccluders(ranges,vBuf,compactBuf,iBuf,outModel);
+	if(!cookedPath.empty())
+	{
+		BASIS_PROFILE_ZONE("Manager::writeCookedModel");
+		std::vector<CookedNode> nodes;
+		std::vector<CookedPrimitive> primitives;
+		std::vector<std::int64_t> mappings;
+		std::vector<std::uint64_t> children;
+		std::vector<PrimitiveLod> lods;
+		cookNodes(outModel.nodes,nodes,primitives,mappings,children,lods);
+
+		// handles are rebuilt on load
+		std::vector<Material> materials = outModel.materials;
+		for(auto& mat : materials) mat.baseColorTexture = mat.metallicRoughnessTexture = 0;
+		std::vector<SamplerInfo> samplers;
+		for(const auto* sampler : outModel.samplers) samplers.push_back(sampler->info());
+
+		CookedModel cooked{
+			.flags = static_cast<std::uint32_t>(flags),
+			.vertices = vertexBytes,
+			.indices = idxBytes,
+			.nodes = nodes,
+			.primitives = primitives,
+			.mappings = mappings,
+			.children = children,
+			.materials = materials,
+			.materialTextures = materialTextures,
+			.textures = outModel.textures,
+			.samplers = samplers,
+			.meshlets = outModel.meshlets,
+			.lods = lods,
+			.occluderPositions = outModel.occluderPositions,
+			.occluderIndices = outModel.occluderIndices,
+			.images = imageSources,
+			.materialVariants = {outModel.materialVariants.begin(),outModel.materialVariants.end()}
+		};
+		// cache is only an optimization, read only or full directory mustn't fail the load
+		// writeCookedModel() removes half written file, failure is only reported
+		try
+		{
+			writeCookedModel(cookedPath,path,cooked,externalFilePaths(path));
+		}
+		catch(const std::exception& e)
+		{
+			std::fprintf(stderr,"Failed to write cooked model %s\nReason:%s\n",cookedPath.string().c_str(),e.what());
+		}
+	}
+	// after cooking, cache stores offsets relative to the model itself
+	uploadGeometry(outModel,m_geometryArena.get(),vertexBytes,idxBytes);
 	return m_models.insert({uniqueHash,std::make_unique<GLTFModel>(std::move(outModel))}).first->second.get();	
 }
 void Manager::insertModel(std::uint64_t uniqueHash,GLTFModel&& model)
@@ -425,19 +1199,90 @@ void Manager::insertModel(std::uint64_t uniqueHash,GLTFModel&& model)
 		assert(model.materials.size() > 0 && "Nothing to autofill material buffer with");
 		model.materialBuffer = materialUploadCallback(model.materials);
 	}
+	if(m_geometryArena)
+	{
+		model.arena = m_geometryArena.get();
+		model.vertexAllocation = m_geometryArena->allocateVertices(*model.vertexBuffer,model.vertexStride);
+		model.idxAllocation = m_geometryArena->allocateIndices(*model.idxBuffer);
+		model.vertexBuffer.reset();
+		model.idxBuffer.reset();
+		rebaseOnArena(model);
+		if(!model.meshlets.empty()) model.meshletBuffer = BASIS::Buffer(std::span<const Meshlet>(model.meshlets),0);
+	}
 	m_models.insert({uniqueHash,std::make_unique<GLTFModel>(std::forward<GLTFModel>(model))});
 }
+void Manager::releaseModel(std::uint64_t uniqueHash)
+{
+	auto it = m_models.find(uniqueHash);
+	if(it == m_models.end()) return;
+	if(const auto& model = *it->second;model.arena)
+	{
+		assert(model.arena == m_geometryArena.get());
+		m_geometryArena->freeVertices(model.vertexAllocation);
+		m_geometryArena->freeIndices(model.idxAllocation);
+	}
+	m_models.erase(it);
+}
+void Manager::enableGeometryArena(std::uint64_t vertexBytes,std::uint64_t idxBytes)
+{
+	assert(!m_geometryArena && "Geometry arena is already enabled");
+	m_geometryArena = std::make_unique<GeometryArena>(vertexBytes,idxBytes);
+}
+bool Manager::containsTexture(std::uint64_t uniqueHash) const noexcept
+{
+	return m_textures.contains(uniqueHash);
+}
+bool Manager::containsModel(std::uint64_t uniqueHash) const noexcept
+{
+	return m_models.contains(uniqueHash);
+}
 void Manager::insertTexture(std::uint64_t uniqueHash,Texture&& tex)
 {
 	if(m_textures.contains(uniqueHash)) throw AssetException("insertTexture failed, such hash already exists");
 	m_textures.insert({uniqueHash,std::make_unique<Texture>(std::forward<Texture>(tex))});
 }
-Manager::~Manager()
+std::vector<ModelMemoryUsage> Manager::modelMemoryUsage() const
 {
-	for(const auto& [_,s] : m_samplers)
+	std::vector<ModelMemoryUsage> usage;
+	usage.reserve(m_models.size());
+	for(const auto& [hash,model] : m_models)
 	{
-		glDeleteSamplers(1,&s->m_id);
-	};
+		auto& u = usage.emplace_back(ModelMemoryUsage{.uniqueHash = hash});
+		if(model->arena)
+		{
+			u.geometry = model->vertexAllocation.size + model->idxAllocation.size;
+		}
+		else
+		{
+			if(model->vertexBuffer) u.geometry += model->vertexBuffer->size();
+			if(model->idxBuffer) u.geometry += model->idxBuffer->size();
+		}
+		if(model->materialBuffer) u.materials = model->materialBuffer->size();
+		if(model->meshletBuffer) u.meshlets = model->meshletBuffer->size();
+		
+		auto images = model->images;
+		std::sort(images.begin(),images.end());
+		images.erase(std::unique(images.begin(),images.end()),images.end());
+		for(const auto* image : images)
+		{
+			if(image) u.textures += image->memorySize();
+		}
+	}
+	std::sort(usage.begin(),usage.end(),[](const auto& a,const auto& b){ return a.total() > b.total(); });
+	return usage;
+}
+std::vector<TextureMemoryUsage> Manager::textureMemoryUsage() const
+{
+	std::vector<TextureMemoryUsage> usage;
+	usage.reserve(m_textures.size());
+	for(const auto& [hash,texture] : m_textures)
+	{
+		usage.push_back({.uniqueHash = hash,.bytes = texture->memorySize()});
+	}
+	std::sort(usage.begin(),usage.end(),[](const auto& a,const auto& b){ return a.bytes > b.bytes; });
+	return usage;
 }
+// samplers, textures and models delete their gl objects themselves
+Manager::~Manager() = default;
 };
 
@@ -0,0 +1,379 @@
+#include <BASIS/mesh_optimizer.h>
+
+#include <cmath>
+#include <vector>
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <string_view>
+#include <unordered_map>
+
+#include <glm/geometric.hpp>
+
+namespace
+{
+// triangles using each vertex, flattened
+struct Adjacency
+{
+	std::vector<std::uint32_t> offsets;
+	std::vector<std::uint32_t> triangles;
+	std::vector<std::uint32_t> live;
+};
+// symmetric 4x4 plane quadric, error(p) = p^T A p + 2 b.p + c
+struct Quadric
+{
+	float a00{},a01{},a02{},a11{},a12{},a22{};
+	float b0{},b1{},b2{};
+	float c{};
+
+	static Quadric plane(const glm::vec3& n,float d)
+	{
+		return {n.x * n.x,n.x * n.y,n.x * n.z,n.y * n.y,n.y * n.z,n.z * n.z,n.x * d,n.y * d,n.z * d,d * d};
+	}
+	Quadric& operator+=(const Quadric& o)
+	{
+		a00 += o.a00; a01 += o.a01; a02 += o.a02; a11 += o.a11; a12 += o.a12; a22 += o.a22;
+		b0 += o.b0; b1 += o.b1; b2 += o.b2;
+		c += o.c;
+		return *this;
+	}
+	float error(const glm::vec3& p) const
+	{
+		const float e =
+		a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z +
+		2.f * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z) +
+		2.f * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+		return std::max(e,0.f);
+	}
+};
+Adjacency buildAdjacency(std::span<const std::uint32_t> indices,std::size_t vertexCount)
+{
+	Adjacency adj;
+	adj.offsets.assign(vertexCount + 1,0);
+	adj.live.assign(vertexCount,0);
+	for(auto i : indices) adj.live[i]++;
+	for(std::size_t v{};v < vertexCount;v++) adj.offsets[v + 1] = adj.offsets[v] + adj.live[v];
+
+	adj.triangles.resize(indices.size());
+	std::vector<std::uint32_t> fill(adj.offsets.begin(),adj.offsets.end() - 1);
+	for(std::size_t i{};i < indices.size();i++) adj.triangles[fill[indices[i]]++] = static_cast<std::uint32_t>(i / 3);
+	return adj;
+}
+}
+namespace BASIS
+{
+void weldVertices(std::span<std::uint32_t> indices,std::span<const std::byte> vertices,std::size_t stride)
+{
+	const std::size_t vertexCount = vertices.size() / stride;
+	auto bytes = [&](std::uint32_t v)
+	{
+		return std::string_view(reinterpret_cast<const char*>(vertices.data() + v * stride),stride);
+	};
+	std::unordered_map<std::string_view,std::uint32_t> unique;
+	unique.reserve(vertexCount);
+	std::vector<std::uint32_t> remap(vertexCount);
+	for(std::uint32_t v{};v < vertexCount;v++)
+	{
+		remap[v] = unique.try_emplace(bytes(v),v).first->second;
+	}
+	for(auto& i : indices) i = remap[i];
+}
+void optimizeVertexCache(std::span<std::uint32_t> indices,std::size_t vertexCount,std::uint32_t cacheSize)
+{
+	assert(indices.size() % 3 == 0);
+	const std::size_t triangleCount = indices.size() / 3;
+	if(triangleCount == 0) return;
+	auto adj = buildAdjacency(indices,vertexCount);
+
+	std::vector<std::uint32_t> out;
+	out.reserve(indices.size());
+	std::vector<std::uint32_t> timestamp(vertexCount,0);
+	std::vector<bool> emitted(triangleCount,false);
+	std::vector<std::uint32_t> deadEnd;
+	std::vector<std::uint32_t> candidates;
+	std::uint32_t time = cacheSize + 1;
+	std::size_t cursor{};
+
+	auto skipDeadEnd = [&]() -> std::int64_t
+	{
+		while(!deadEnd.empty())
+		{
+			const auto v = deadEnd.back();
+			deadEnd.pop_back();
+			if(adj.live[v] > 0) return v;
+		}
+		for(;cursor < vertexCount;cursor++)
+		{
+			if(adj.live[cursor] > 0) return static_cast<std::int64_t>(cursor);
+		}
+		return -1;
+	};
+	std::int64_t fan = skipDeadEnd();
+	while(fan >= 0)
+	{
+		candidates.clear();
+		for(auto t = adj.offsets[fan];t < adj.offsets[fan + 1];t++)
+		{
+			const auto tri = adj.triangles[t];
+			if(emitted[tri]) continue;
+			emitted[tri] = true;
+			for(std::uint32_t k{};k < 3;k++)
+			{
+				const auto v = indices[tri * 3 + k];
+				out.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				adj.live[v]--;
+				if(time - timestamp[v] > cacheSize) timestamp[v] = time++;
+			}
+		}
+		// prefer vertex which is still in cache and will stay there while its fan is emitted
+		std::int64_t best = -1;
+		std::uint32_t bestPriority{};
+		for(auto v : candidates)
+		{
+			if(adj.live[v] == 0) continue;
+			std::uint32_t priority{};
+			if(time - timestamp[v] + 2 * adj.live[v] <= cacheSize) priority = time - timestamp[v];
+			if(priority > bestPriority)
+			{
+				bestPriority = priority;
+				best = v;
+			}
+		}
+		fan = best >= 0 ? best : skipDeadEnd();
+	}
+	assert(out.size() == indices.size());
+	std::copy(out.begin(),out.end(),indices.begin());
+}
+void optimizeOverdraw(std::span<std::uint32_t> indices,std::span<const glm::vec3> positions,std::uint32_t cacheSize)
+{
+	constexpr std::size_t minClusterSize = 64;
+	const std::size_t triangleCount = indices.size() / 3;
+	if(triangleCount <= minClusterSize) return;
+
+	// fifo cache simulation, triangle missing on all 3 vertices starts new cluster
+	std::vector<std::uint32_t> clusters{0};
+	std::vector<std::uint32_t> cachedAt(positions.size(),0);
+	std::uint32_t time = cacheSize + 1;
+	for(std::uint32_t t{};t < triangleCount;t++)
+	{
+		std::uint32_t misses{};
+		for(std::uint32_t k{};k < 3;k++)
+		{
+			auto& c = cachedAt[indices[t * 3 + k]];
+			if(time - c > cacheSize)
+			{
+				c = time++;
+				misses++;
+			}
+		}
+		if(misses == 3 && t - clusters.back() >= minClusterSize) clusters.push_back(t);
+	}
+	clusters.push_back(static_cast<std::uint32_t>(triangleCount));
+	if(clusters.size() <= 2) return;
+
+	auto vertex = [&](std::uint32_t t,std::uint32_t k){ return positions[indices[t * 3 + k]]; };
+	glm::vec3 meshCentroid{};
+	float meshArea{};
+	struct Cluster
+	{
+		glm::vec3 centroid{};
+		glm::vec3 normal{};
+		float area{};
+	};
+	std::vector<Cluster> info(clusters.size() - 1);
+	for(std::size_t c{};c < info.size();c++)
+	{
+		for(auto t = clusters[c];t < clusters[c + 1];t++)
+		{
+			const glm::vec3 n = glm::cross(vertex(t,1) - vertex(t,0),vertex(t,2) - vertex(t,0));
+			const float area = glm::length(n);
+			const glm::vec3 centroid = (vertex(t,0) + vertex(t,1) + vertex(t,2)) / 3.f;
+			info[c].centroid += centroid * area;
+			info[c].normal += n;
+			info[c].area += area;
+		}
+		meshCentroid += info[c].centroid;
+		meshArea += info[c].area;
+		if(info[c].area > 0.f) info[c].centroid /= info[c].area;
+	}
+	if(meshArea > 0.f) meshCentroid /= meshArea;
+
+	std::vector<float> sortKey(info.size());
+	std::vector<std::uint32_t> order(info.size());
+	for(std::uint32_t c{};c < info.size();c++)
+	{
+		order[c] = c;
+		const float len = glm::length(info[c].normal);
+		sortKey[c] = len > 0.f ? glm::dot(info[c].centroid - meshCentroid,info[c].normal / len) : 0.f;
+	}
+	std::stable_sort(order.begin(),order.end(),[&](auto a,auto b){ return sortKey[a] > sortKey[b]; });
+
+	std::vector<std::uint32_t> out;
+	out.reserve(indices.size());
+	for(auto c : order)
+	{
+		out.insert(out.end(),indices.begin() + clusters[c] * 3,indices.begin() + clusters[c + 1] * 3);
+	}
+	std::copy(out.begin(),out.end(),indices.begin());
+}
+std::size_t optimizeVertexFetch(std::span<std::uint32_t> indices,std::span<std::byte> vertices,std::size_t stride)
+{
+	const std::size_t vertexCount = vertices.size() / stride;
+	std::vector<std::uint32_t> remap(vertexCount,~0u);
+	std::vector<std::byte> out;
+	out.reserve(vertices.size());
+	std::uint32_t next{};
+	for(auto& i : indices)
+	{
+		if(remap[i] == ~0u)
+		{
+			remap[i] = next++;
+			const auto* src = vertices.data() + i * stride;
+			out.insert(out.end(),src,src + stride);
+		}
+		i = remap[i];
+	}
+	std::memcpy(vertices.data(),out.data(),out.size());
+	return next;
+}
+std::vector<std::uint32_t> simplify(
+	std::span<const std::uint32_t> indices,
+	std::span<const glm::vec3> positions,
+	std::size_t targetIdxCount,
+	float maxError,
+	float* resultError)
+{
+	const std::size_t vertexCount = positions.size();
+	std::vector<std::uint32_t> current(indices.begin(),indices.end());
+	float error{};
+	if(resultError) *resultError = 0.f;
+	if(current.size() <= targetIdxCount) return current;
+
+	// vertices with equal position share quadric, seam copies are locked
+	std::unordered_map<std::string_view,std::uint32_t> unique;
+	std::vector<std::uint32_t> rep(vertexCount);
+	std::vector<std::uint32_t> repUsers(vertexCount,0);
+	for(std::uint32_t v{};v < vertexCount;v++)
+	{
+		std::string_view key(reinterpret_cast<const char*>(&positions[v]),sizeof(glm::vec3));
+		rep[v] = unique.try_emplace(key,v).first->second;
+		repUsers[rep[v]]++;
+	}
+	std::vector<bool> locked(vertexCount,false);
+	for(std::uint32_t v{};v < vertexCount;v++) locked[v] = repUsers[rep[v]] > 1;
+
+	// edge used by single triangle is border(or seam, since seams split vertices)
+	{
+		std::unordered_map<std::uint64_t,std::uint32_t> edges;
+		auto key = [](std::uint32_t a,std::uint32_t b){ return (std::uint64_t(std::min(a,b)) << 32) | std::max(a,b); };
+		for(std::size_t i{};i < current.size();i += 3)
+		{
+			for(std::uint32_t k{};k < 3;k++) edges[key(current[i + k],current[i + (k + 1) % 3])]++;
+		}
+		for(const auto& [e,count] : edges)
+		{
+			if(count != 1) continue;
+			locked[e >> 32] = true;
+			locked[e & 0xFFFFFFFF] = true;
+		}
+	}
+	std::vector<Quadric> quadrics(vertexCount);
+	for(std::size_t i{};i < current.size();i += 3)
+	{
+		const auto& p0 = positions[current[i]];
+		const glm::vec3 n = glm::cross(positions[current[i + 1]] - p0,positions[current[i + 2]] - p0);
+		const float len = glm::length(n);
+		if(len <= 0.f) continue;
+		const auto q = Quadric::plane(n / len,-glm::dot(n / len,p0));
+		for(std::uint32_t k{};k < 3;k++) quadrics[rep[current[i + k]]] += q;
+	}
+
+	struct Collapse
+	{
+		std::uint32_t from{};
+		std::uint32_t to{};
+		float cost{};
+	};
+	std::vector<Collapse> collapses;
+	std::vector<std::uint32_t> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+	const float maxCost = maxError * maxError;
+	while(current.size() > targetIdxCount)
+	{
+		collapses.clear();
+		for(std::size_t i{};i < current.size();i += 3)
+		{
+			for(std::uint32_t k{};k < 3;k++)
+			{
+				const auto a = current[i + k],b = current[i + (k + 1) % 3];
+				Quadric q = quadrics[rep[a]];
+				q += quadrics[rep[b]];
+				if(!locked[a]) collapses.push_back({a,b,q.error(positions[b])});
+				if(!locked[b]) collapses.push_back({b,a,q.error(positions[a])});
+			}
+		}
+		std::sort(collapses.begin(),collapses.end(),[](const auto& l,const auto& r){ return l.cost < r.cost; });
+		auto adj = buildAdjacency(current,vertexCount);
+
+		for(std::uint32_t v{};v < vertexCount;v++) remap[v] = v;
+		std::fill(touched.begin(),touched.end(),false);
+		std::size_t removed{};
+		std::size_t applied{};
+		for(const auto& c : collapses)
+		{
+			if(c.cost > maxCost || current.size() - removed <= targetIdxCount) break;
+			if(touched[c.from] || touched[c.to]) continue;
+
+			// moving vertex must not flip any of remaining triangles
+			bool flips = false;
+			std::size_t degenerate{};
+			for(auto t = adj.offsets[c.from];t < adj.offsets[c.from + 1] && !flips;t++)
+			{
+				const auto* tri = &current[adj.triangles[t] * 3];
+				if(tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+				{
+					degenerate++;
+					continue;
+				}
+				glm::vec3 p[3],moved[3];
+				for(std::uint32_t k{};k < 3;k++)
+				{
+					p[k] = positions[tri[k]];
+					moved[k] = tri[k] == c.from ? positions[c.to] : p[k];
+				}
+				const glm::vec3 n0 = glm::cross(p[1] - p[0],p[2] - p[0]);
+				const glm::vec3 n1 = glm::cross(moved[1] - moved[0],moved[2] - moved[0]);
+				flips = glm::dot(n0,n1) <= 0.f;
+			}
+			if(flips) continue;
+
+			remap[c.from] = c.to;
+			quadrics[rep[c.to]] += quadrics[rep[c.from]];
+			// neighbourhood is frozen until next pass, so flip tests above stay valid
+			for(auto t = adj.offsets[c.from];t < adj.offsets[c.from + 1];t++)
+			{
+				for(std::uint32_t k{};k < 3;k++) touched[current[adj.triangles[t] * 3 + k]] = true;
+			}
+			removed += degenerate * 3;
+			error = std::max(error,std::sqrt(c.cost));
+			applied++;
+		}
+		if(applied == 0) break;
+
+		std::size_t out{};
+		for(std::size_t i{};i < current.size();i += 3)
+		{
+			const auto a = remap[current[i]],b = remap[current[i + 1]],c = remap[current[i + 2]];
+			if(a == b || b == c || a == c) continue;
+			current[out++] = a;
+			current[out++] = b;
+			current[out++] = c;
+		}
+		current.resize(out);
+	}
+	if(resultError) *resultError = error;
+	return current;
+}
+}
@@ -0,0 +1,234 @@
+#include <BASIS/types.h>
+#include <BASIS/meshlet.h>
+#include <BASIS/culling.h>
+#include <BASIS/rendering.h>
+#include <BASIS/profiler.h>
+
+#include <cmath>
+#include <limits>
+#include <cassert>
+#include <algorithm>
+
+#include <glm/geometric.hpp>
+#include <glm/vec4.hpp>
+
+namespace
+{
+constexpr std::uint32_t cullGroupSize = 64;
+constexpr const char* cullShaderSource = R"(
+#version 450 core
+layout(local_size_x = 64) in;
+
+struct Meshlet
+{
+	vec3 center;
+	float radius;
+	vec3 coneAxis;
+	float coneCutoff;
+	uint firstIdx;
+	uint idxCount;
+	int vertexOffset;
+	uint pad;
+};
+struct DrawCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+layout(std140, binding = 0) uniform Params
+{
+	mat4 model;
+	vec4 planes[6];
+	vec4 cameraPos; // w - max scale of model matrix
+	uint firstMeshlet;
+	uint meshletCount;
+	uint baseInstance;
+	uint maxDraws;
+};
+layout(std430, binding = 0) readonly buffer Meshlets { Meshlet meshlets[]; };
+layout(std430, binding = 1) writeonly buffer Commands { DrawCommand commands[]; };
+layout(std430, binding = 2) buffer Count { uint drawCount; };
+
+void main()
+{
+	uint idx = gl_GlobalInvocationID.x;
+	if(idx >= meshletCount) return;
+	Meshlet m = meshlets[firstMeshlet + idx];
+
+	vec3 center = (model * vec4(m.center, 1.0)).xyz;
+	float radius = m.radius * cameraPos.w;
+	for(int i = 0; i < 6; i++)
+	{
+		if(dot(planes[i].xyz, center) + planes[i].w < -radius) return;
+	}
+	if(m.coneCutoff < 1.0)
+	{
+		vec3 axis = normalize(mat3(model) * m.coneAxis);
+		vec3 v = center - cameraPos.xyz;
+		if(dot(v, axis) >= m.coneCutoff * length(v) + radius) return;
+	}
+	uint slot = atomicAdd(drawCount, 1u);
+	if(slot < maxDraws) commands[slot] = DrawCommand(m.idxCount, 1u, m.firstIdx, m.vertexOffset, baseInstance);
+}
+)";
+// std140 mirror of Params block
+struct CullParams
+{
+	glm::mat4 model;
+	glm::vec4 planes[6];
+	glm::vec4 cameraPos;
+	std::uint32_t firstMeshlet;
+	std::uint32_t meshletCount;
+	std::uint32_t baseInstance;
+	std::uint32_t maxDraws;
+};
+BASIS::ComputePipeline makeCullPipeline()
+{
+	BASIS::Shader shader(BASIS::ShaderType::COMPUTE,cullShaderSource,"meshlet cull");
+	return BASIS::ComputePipeline(shader,"meshlet cull");
+}
+void finishMeshlet(
+	std::span<const std::uint32_t> indices,
+	std::span<const glm::vec3> positions,
+	std::uint32_t vertexOffset,
+	BASIS::Meshlet& m)
+{
+	auto pos = [&](std::uint32_t i){ return positions[indices[i] - vertexOffset]; };
+	glm::vec3 min(std::numeric_limits<float>::max()),max(std::numeric_limits<float>::lowest());
+	for(std::uint32_t i{};i < indices.size();i++)
+	{
+		min = glm::min(min,pos(i));
+		max = glm::max(max,pos(i));
+	}
+	m.center = (min + max) * 0.5f;
+	for(std::uint32_t i{};i < indices.size();i++)
+	{
+		m.radius = std::max(m.radius,glm::distance(m.center,pos(i)));
+	}
+
+	std::vector<glm::vec3> normals;
+	normals.reserve(indices.size() / 3);
+	glm::vec3 axis{};
+	for(std::uint32_t i{};i + 2 < indices.size();i += 3)
+	{
+		const glm::vec3 n = glm::cross(pos(i + 1) - pos(i),pos(i + 2) - pos(i));
+		const float len = glm::length(n);
+		// degenerate triangles can't be seen anyway
+		if(len <= 0.f) continue;
+		normals.push_back(n / len);
+		axis += normals.back();
+	}
+	const float axisLen = glm::length(axis);
+	if(normals.empty() || axisLen <= 0.f) return;
+	axis /= axisLen;
+	float minDot = 1.f;
+	for(const auto& n : normals) minDot = std::min(minDot,glm::dot(axis,n));
+	// cone wider than ~84 degrees rejects almost nothing
+	if(minDot <= 0.1f) return;
+	m.coneAxis = axis;
+	m.coneCutoff = std::sqrt(1.f - minDot * minDot);
+}
+}
+namespace BASIS
+{
+void buildMeshlets(
+	std::span<const std::uint32_t> indices,
+	std::span<const glm::vec3> positions,
+	std::uint32_t vertexOffset,
+	std::uint32_t firstIdx,
+	std::vector<Meshlet>& out)
+{
+	assert(indices.size() % 3 == 0);
+	// stamp of last meshlet which used vertex, avoids clearing per meshlet
+	std::vector<std::uint32_t> stamp(positions.size(),~0u);
+	std::uint32_t current{};
+	std::uint32_t vertexCount{};
+	std::uint32_t start{};
+
+	auto flush = [&](std::uint32_t end)
+	{
+		if(end == start) return;
+		Meshlet m{.firstIdx = firstIdx + start,.idxCount = end - start};
+		finishMeshlet(indices.subspan(start,end - start),positions,vertexOffset,m);
+		out.push_back(m);
+		start = end;
+		vertexCount = 0;
+		current++;
+	};
+	for(std::uint32_t i{};i < indices.size();i += 3)
+	{
+		std::uint32_t newVertices{};
+		for(std::uint32_t v{};v < 3;v++) newVertices += stamp[indices[i + v] - vertexOffset] != current;
+		if(vertexCount + newVertices > MESHLET_MAX_VERTICES || (i - start) / 3 + 1 > MESHLET_MAX_TRIANGLES)
+		{
+			flush(i);
+		}
+		for(std::uint32_t v{};v < 3;v++)
+		{
+			auto& s = stamp[indices[i + v] - vertexOffset];
+			if(s != current)
+			{
+				s = current;
+				vertexCount++;
+			}
+		}
+	}
+	flush(static_cast<std::uint32_t>(indices.size()));
+}
+MeshletCuller::MeshletCuller(std::uint32_t maxDraws) :
+m_pipeline(makeCullPipeline()),
+m_params(sizeof(CullParams),BufferFlags::DYNAMIC,"meshlet cull params"),
+m_commands(sizeof(DrawIndexedIndirectCommand) * std::max(maxDraws,1u),0,"meshlet draws"),
+m_count(sizeof(std::uint32_t),BufferFlags::DYNAMIC,"meshlet draw count"),
+m_maxDraws(maxDraws)
+{
+}
+void MeshletCuller::reset() noexcept
+{
+	m_count.fill(0);
+}
+void MeshletCuller::cull(
+	Renderer& renderer,
+	const Buffer& meshlets,
+	std::uint32_t firstMeshlet,
+	std::uint32_t meshletCount,
+	const glm::mat4& model,
+	const glm::mat4& viewProj,
+	const glm::vec3& cameraPos,
+	std::uint32_t baseInstance)
+{
+	BASIS_PROFILE_GPU_ZONE("MeshletCuller::cull");
+	if(meshletCount == 0) return;
+	CullParams params{
+		.model = model,
+		.cameraPos = glm::vec4(cameraPos,std::max({
+			glm::length(glm::vec3(model[0])),
+			glm::length(glm::vec3(model[1])),
+			glm::length(glm::vec3(model[2]))})),
+		.firstMeshlet = firstMeshlet,
+		.meshletCount = meshletCount,
+		.baseInstance = baseInstance,
+		.maxDraws = m_maxDraws
+	};
+	const auto frustum = Frustum::fromMatrix(viewProj);
+	std::copy(std::begin(frustum.planes),std::end(frustum.planes),params.planes);
+	m_params.update(params);
+
+	renderer.bindComputePipeline(m_pipeline);
+	renderer.bindUniformBuffer(m_params,0);
+	renderer.bindStorageBuffer(meshlets,0);
+	renderer.bindStorageBuffer(m_commands,1);
+	renderer.bindStorageBuffer(m_count,2);
+	renderer.dispatch(glm::vec3((meshletCount + cullGroupSize - 1) / cullGroupSize,1,1));
+	// next cull() appends through the same counter
+	Renderer::memoryBarrier(MemoryBarrierBit::SHADER_STORAGE);
+}
+void MeshletCuller::draw(Renderer& renderer)
+{
+	Renderer::memoryBarrier(MemoryBarrierBit::COMMAND);
+	renderer.drawIndexedIndirectCount(m_commands,m_count,m_maxDraws,sizeof(DrawIndexedIndirectCommand));
+}
+}
@@ -0,0 +1,390 @@
+#include <BASIS/exception.h>
+#include <BASIS/model_cache.h>
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <cstddef>
+#include <utility>
+
+#ifdef _WIN32
+	#define NOMINMAX
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+namespace
+{
+namespace fs = std::filesystem;
+
+constexpr std::array<char,4> cookedMagic = {'B','S','M','C'};
+// bump whenever layout of any cooked record changes
+constexpr std::uint32_t cookedVersion = 10;
+// sections are aligned so records can be read in place from mapping
+constexpr std::uint64_t sectionAlignment = 16;
+
+enum Section : std::uint32_t
+{
+	VERTICES,
+	INDICES,
+	NODES,
+	PRIMITIVES,
+	MAPPINGS,
+	CHILDREN,
+	MATERIALS,
+	MATERIAL_TEXTURES,
+	TEXTURES,
+	SAMPLERS,
+	MESHLETS,
+	LODS,
+	OCCLUDER_POSITIONS,
+	OCCLUDER_INDICES,
+	IMAGES,
+	VARIANTS,
+	EXTERNAL_FILES,
+	BLOB, // strings and embedded images
+	SECTION_COUNT
+};
+struct SectionInfo
+{
+	std::uint64_t offset{};
+	std::uint64_t size{};
+};
+// points into BLOB section
+struct BlobRef
+{
+	std::uint64_t offset{};
+	std::uint64_t size{};
+	std::uint32_t isPath{};
+	std::uint32_t pad{};
+};
+// external buffer or image of source, relative path lives in BLOB section
+struct ExternalFile
+{
+	BlobRef path;
+	std::uint64_t size{};
+	std::int64_t  time{};
+	std::uint64_t contentHash{};
+};
+struct Header
+{
+	std::array<char,4> magic = cookedMagic;
+	std::uint32_t version{cookedVersion};
+	std::uint32_t flags{};
+	std::uint32_t sectionCount{SECTION_COUNT};
+	std::uint64_t sourceSize{};
+	std::int64_t  sourceTime{};
+	std::uint64_t contentHash{};
+	std::array<SectionInfo,SECTION_COUNT> sections{};
+};
+
+// 4 independent lanes to keep multiplier busy, only has to tell edited files apart
+std::uint64_t hashContent(std::span<const std::byte> bytes)
+{
+	std::array<std::uint64_t,4> lanes = {
+		0xcbf29ce484222325 ^ bytes.size(),
+		0x9e3779b97f4a7c15,
+		0xc2b2ae3d27d4eb4f,
+		0x165667b19e3779f9};
+	auto mix = [](std::uint64_t h,std::uint64_t w)
+	{
+		h = (h ^ w) * 0x100000001b3;
+		return h ^ (h >> 29);
+	};
+	const auto* data = bytes.data();
+	std::size_t i{};
+	for(;i + 32 <= bytes.size();i += 32)
+	{
+		for(std::size_t l{};l < 4;l++)
+		{
+			std::uint64_t w;
+			std::memcpy(&w,data + i + l * 8,8);
+			lanes[l] = mix(lanes[l],w);
+		}
+	}
+	for(;i < bytes.size();i++) lanes[0] = mix(lanes[0],static_cast<std::uint64_t>(data[i]));
+
+	std::uint64_t h{};
+	for(auto l : lanes) h = mix(h,l);
+	return h;
+}
+std::int64_t sourceTime(const fs::path& p)
+{
+	return fs::last_write_time(p).time_since_epoch().count();
+}
+// size has to match, if only time differs content hash is compared and
+// stored time at timeOffset inside cooked file is refreshed on match
+bool isFresh(
+	const fs::path& cooked,
+	const fs::path& file,
+	std::uint64_t size,
+	std::int64_t time,
+	std::uint64_t contentHash,
+	std::uint64_t timeOffset)
+{
+	std::error_code ec;
+	const auto fileSize = fs::file_size(file,ec);
+	if(ec || fileSize != size) return false;
+	const auto fileTime = sourceTime(file);
+	if(fileTime == time) return true;
+	// touched but maybe not changed, don't recook if contents are the same
+	if(hashContent(BASIS::MappedFile(file).bytes()) != contentHash) return false;
+	std::fstream f(cooked,std::ios::in | std::ios::out | std::ios::binary);
+	f.seekp(timeOffset);
+	f.write(reinterpret_cast<const char*>(&fileTime),sizeof(fileTime));
+	return true;
+}
+template<typename T>
+std::span<const T> readSection(std::span<const std::byte> file,const Header& header,Section s)
+{
+	const auto& info = header.sections[s];
+	return {reinterpret_cast<const T*>(file.data() + info.offset),info.size / sizeof(T)};
+}
+}
+namespace BASIS
+{
+#ifdef _WIN32
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+	m_file = CreateFileW(path.c_str(),GENERIC_READ,FILE_SHARE_READ | FILE_SHARE_WRITE,nullptr,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,nullptr);
+	if(m_file == INVALID_HANDLE_VALUE) throw FileException(path.string()," can't be opened");
+	LARGE_INTEGER size{};
+	GetFileSizeEx(m_file,&size);
+	m_size = static_cast<std::size_t>(size.QuadPart);
+	if(m_size == 0) return;
+	m_mapping = CreateFileMappingW(m_file,nullptr,PAGE_READONLY,0,0,nullptr);
+	if(m_mapping) m_data = MapViewOfFile(m_mapping,FILE_MAP_READ,0,0,0);
+	if(!m_data)
+	{
+		if(m_mapping) CloseHandle(m_mapping);
+		CloseHandle(m_file);
+		throw FileException(path.string()," can't be mapped");
+	}
+}
+MappedFile::~MappedFile()
+{
+	if(m_data) UnmapViewOfFile(m_data);
+	if(m_mapping) CloseHandle(m_mapping);
+	if(m_file && m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+}
+#else
+MappedFile::MappedFile(const std::filesystem::path& path)
+{
+	int fd = ::open(path.c_str(),O_RDONLY);
+	if(fd < 0) throw FileException(path.string()," can't be opened");
+	struct stat st{};
+	fstat(fd,&st);
+	m_size = static_cast<std::size_t>(st.st_size);
+	if(m_size != 0)
+	{
+		m_data = mmap(nullptr,m_size,PROT_READ,MAP_PRIVATE,fd,0);
+		if(m_data == MAP_FAILED)
+		{
+			m_data = nullptr;
+			::close(fd);
+			throw FileException(path.string()," can't be mapped");
+		}
+	}
+	// mapping stays valid after descriptor is closed
+	::close(fd);
+}
+MappedFile::~MappedFile()
+{
+	if(m_data) munmap(m_data,m_size);
+}
+#endif
+
+std::filesystem::path cookedModelPath(const std::filesystem::path& directory,const std::filesystem::path& source)
+{
+	std::error_code ec;
+	auto canonical = fs::weakly_canonical(source,ec);
+	const auto key = hash_64((ec ? source : canonical).generic_string());
+	std::array<char,17> name{};
+	std::snprintf(name.data(),name.size(),"%016llx",static_cast<unsigned long long>(key));
+	return directory / (std::string(name.data()) + ".bsmodel");
+}
+std::optional<CookedModelFile> CookedModelFile::open(
+	const std::filesystem::path& cooked,
+	const std::filesystem::path& source,
+	std::uint32_t flags)
+{
+	std::error_code ec;
+	if(!fs::exists(cooked,ec) || !fs::exists(source,ec)) return std::nullopt;
+
+	CookedModelFile out;
+	out.m_file = std::make_unique<MappedFile>(cooked);
+	const auto file = out.m_file->bytes();
+	if(file.size() < sizeof(Header)) return std::nullopt;
+
+	Header header;
+	std::memcpy(&header,file.data(),sizeof(Header));
+	if(header.magic != cookedMagic ||
+	header.version != cookedVersion ||
+	header.sectionCount != SECTION_COUNT ||
+	header.flags != flags) return std::nullopt;
+
+	for(const auto& s : header.sections)
+	{
+		if(s.offset % sectionAlignment != 0 || s.offset > file.size() || s.size > file.size() - s.offset) return std::nullopt;
+	}
+	if(!isFresh(cooked,source,header.sourceSize,header.sourceTime,header.contentHash,offsetof(Header,sourceTime))) return std::nullopt;
+
+	const auto blob = readSection<std::byte>(file,header,BLOB);
+	auto resolve = [&](const BlobRef& ref) -> std::span<const std::byte>
+	{
+		if(ref.offset > blob.size() || ref.size > blob.size() - ref.offset) return {};
+		return blob.subspan(ref.offset,ref.size);
+	};
+	// geometry and embedded images come from external files, so they are checked like source itself
+	const auto externals = readSection<ExternalFile>(file,header,EXTERNAL_FILES);
+	for(std::size_t i{};i < externals.size();i++)
+	{
+		const auto& ext = externals[i];
+		const auto bytes = resolve(ext.path);
+		const auto path = source.parent_path() / fs::path(std::string(reinterpret_cast<const char*>(bytes.data()),bytes.size()));
+		const auto timeOffset = header.sections[EXTERNAL_FILES].offset + i * sizeof(ExternalFile) + offsetof(ExternalFile,time);
+		if(!isFresh(cooked,path,ext.size,ext.time,ext.contentHash,timeOffset)) return std::nullopt;
+	}
+
+	auto& m = out.model;
+	m.flags = header.flags;
+	m.vertices = readSection<std::byte>(file,header,VERTICES);
+	m.indices = readSection<std::byte>(file,header,INDICES);
+	m.nodes = readSection<CookedNode>(file,header,NODES);
+	m.primitives = readSection<CookedPrimitive>(file,header,PRIMITIVES);
+	m.mappings = readSection<std::int64_t>(file,header,MAPPINGS);
+	m.children = readSection<std::uint64_t>(file,header,CHILDREN);
+	m.materials = readSection<Material>(file,header,MATERIALS);
+	m.materialTextures = readSection<CookedMaterialTextures>(file,header,MATERIAL_TEXTURES);
+	m.textures = readSection<GltfTexture>(file,header,TEXTURES);
+	m.samplers = readSection<SamplerInfo>(file,header,SAMPLERS);
+	m.meshlets = readSection<Meshlet>(file,header,MESHLETS);
+	m.lods = readSection<PrimitiveLod>(file,header,LODS);
+	m.occluderPositions = readSection<glm::vec3>(file,header,OCCLUDER_POSITIONS);
+	m.occluderIndices = readSection<std::uint32_t>(file,header,OCCLUDER_INDICES);
+
+	for(const auto& ref : readSection<BlobRef>(file,header,IMAGES))
+	{
+		auto bytes = resolve(ref);
+		if(ref.isPath)
+		{
+			m.images.push_back({.path = {reinterpret_cast<const char*>(bytes.data()),bytes.size()}});
+		}
+		else
+		{
+			m.images.push_back({.bytes = bytes});
+		}
+	}
+	for(const auto& ref : readSection<BlobRef>(file,header,VARIANTS))
+	{
+		auto bytes = resolve(ref);
+		m.materialVariants.emplace_back(reinterpret_cast<const char*>(bytes.data()),bytes.size());
+	}
+	return out;
+}
+void writeCookedModel(
+	const std::filesystem::path& cooked,
+	const std::filesystem::path& source,
+	const CookedModel& model,
+	std::span<const std::filesystem::path> externalFiles)
+{
+	std::error_code ec;
+	fs::create_directories(cooked.parent_path(),ec);
+
+	Header header;
+	header.flags = model.flags;
+	header.sourceSize = fs::file_size(source);
+	header.sourceTime = sourceTime(source);
+	header.contentHash = hashContent(MappedFile(source).bytes());
+
+	std::vector<std::byte> blob;
+	auto addBlob = [&](std::span<const std::byte> bytes,bool isPath)
+	{
+		BlobRef ref{.offset = blob.size(),.size = bytes.size(),.isPath = isPath};
+		blob.insert(blob.end(),bytes.begin(),bytes.end());
+		return ref;
+	};
+	auto strBytes = [](std::string_view str){ return std::as_bytes(std::span(str.data(),str.size())); };
+	std::vector<BlobRef> images,variants;
+	for(const auto& img : model.images)
+	{
+		images.push_back(img.path.empty() ? addBlob(img.bytes,false) : addBlob(strBytes(img.path),true));
+	}
+	for(const auto& v : model.materialVariants) variants.push_back(addBlob(strBytes(v),true));
+	std::vector<ExternalFile> externals;
+	for(const auto& p : externalFiles)
+	{
+		const auto path = source.parent_path() / p;
+		const auto relative = p.generic_string();
+		externals.push_back({
+			.path = addBlob(strBytes(relative),true),
+			.size = fs::file_size(path),
+			.time = sourceTime(path),
+			.contentHash = hashContent(MappedFile(path).bytes())});
+	}
+
+	std::array<std::span<const std::byte>,SECTION_COUNT> data;
+	data[VERTICES] = model.vertices;
+	data[INDICES] = model.indices;
+	data[NODES] = std::as_bytes(model.nodes);
+	data[PRIMITIVES] = std::as_bytes(model.primitives);
+	data[MAPPINGS] = std::as_bytes(model.mappings);
+	data[CHILDREN] = std::as_bytes(model.children);
+	data[MATERIALS] = std::as_bytes(model.materials);
+	data[MATERIAL_TEXTURES] = std::as_bytes(model.materialTextures);
+	data[TEXTURES] = std::as_bytes(model.textures);
+	data[SAMPLERS] = std::as_bytes(model.samplers);
+	data[MESHLETS] = std::as_bytes(model.meshlets);
+	data[LODS] = std::as_bytes(model.lods);
+	data[OCCLUDER_POSITIONS] = std::as_bytes(model.occluderPositions);
+	data[OCCLUDER_INDICES] = std::as_bytes(model.occluderIndices);
+	data[IMAGES] = std::as_bytes(std::span(images));
+	data[VARIANTS] = std::as_bytes(std::span(variants));
+	data[EXTERNAL_FILES] = std::as_bytes(std::span(externals));
+	data[BLOB] = std::span<const std::byte>(blob);
+
+	auto align = [](std::uint64_t v){ return (v + sectionAlignment - 1) & ~(sectionAlignment - 1); };
+	std::uint64_t offset = align(sizeof(Header));
+	for(std::uint32_t s{};s < SECTION_COUNT;s++)
+	{
+		header.sections[s] = {.offset = offset,.size = data[s].size()};
+		offset = align(offset + data[s].size());
+	}
+
+	// written next to destination and renamed, so readers never see half written file
+	auto tmp = cooked;
+	tmp += ".tmp";
+	try
+	{
+		std::ofstream out(tmp,std::ios::binary | std::ios::trunc);
+		if(!out) throw FileException(tmp.string()," can't be created");
+		const char zeros[sectionAlignment]{};
+		std::uint64_t written{};
+		auto write = [&](const void* p,std::uint64_t size)
+		{
+			out.write(static_cast<const char*>(p),size);
+			written += size;
+		};
+		write(&header,sizeof(Header));
+		for(std::uint32_t s{};s < SECTION_COUNT;s++)
+		{
+			write(zeros,header.sections[s].offset - written);
+			write(data[s].data(),data[s].size());
+		}
+		if(!out) throw FileException(tmp.string()," write failure");
+		out.close();
+		fs::rename(tmp,cooked);
+	}
+	catch(...)
+	{
+		fs::remove(tmp,ec);
+		throw;
+	}
+}
+}
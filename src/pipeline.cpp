@@ -1,9 +1,11 @@
 #include <BASIS/types.h>
+#include <BASIS/context.h>
 #include <BASIS/pipeline.h>
 #include <BASIS/exception.h>
 
-#include <tuple>
+#include <memory>
 #include <string>
+#include <vector>
 #include <utility>
 #include <cassert>
 //#include <algorithm>
@@ -28,26 +30,118 @@ static bool link(unsigned int program,std::string& log)
 	}
 	return true;
 }
-std::unordered_map<std::uint32_t,std::shared_ptr<const BASIS::PipelineInfo>> pipelineCache;
-std::uint32_t compilePipeline(const BASIS::PipelineCreateInfo& info,std::string_view name)
+template<typename... T>
+void combine(std::size_t& seed,const T&... values)
 {
-	assert(info.vertex && "Pipeline must have at least vertex shader");
-	assert(((info.tesselationControl != nullptr) == (info.tesselationEvaluation != nullptr)) && "Tesselation control and evalution go in pair" );
-	
-	auto m_id = glCreateProgram();
-	glObjectLabel(GL_PROGRAM,m_id,name.size(),name.data());
-	glAttachShader(m_id,info.vertex->id());
-	
-	if(info.fragment)				glAttachShader(m_id,info.fragment->id());
-	if(info.tesselationControl)		glAttachShader(m_id,info.tesselationControl->id());
-	if(info.tesselationEvaluation)	glAttachShader(m_id,info.tesselationEvaluation->id());
-	std::string log;
-	if(!link(m_id,log))
+	(BASIS::hash_combine(seed,values),...);
+}
+std::size_t hashVertexInput(const BASIS::VertexInputState& state)
+{
+	std::size_t seed{};
+	for(const auto& cur : state) combine(seed,cur.location,cur.binding,cur.fmt,cur.offset);
+	return seed;
+}
+// everything except vertex input
+std::size_t hashFixedState(const BASIS::PipelineInfo& info)
+{
+	const auto& ds = info.depthState;
+	const auto& bs = info.blendState;
+	const auto& ss = info.stencilState;
+	const auto& ts = info.tessellationState;
+	const auto& rs = info.rasterizationState;
+	std::size_t seed{};
+	combine(seed,info.mode,ds.depthTestEnable,ds.depthWriteEnable,ds.depthCompareOp);
+	combine(seed,bs.blendEnable,bs.srcColorBlendFactor,bs.dstColorBlendFactor,bs.colorBlendOp,
+		bs.srcAlphaBlendFactor,bs.dstAlphaBlendFactor,bs.alphaBlendOp);
+	for(const bool mask : bs.colorWriteMask) combine(seed,mask);
+	combine(seed,ss.stencilTestEnable);
+	for(const auto* face : {&ss.front,&ss.back})
 	{
-		glDeleteProgram(m_id);
-		throw BASIS::PipelineException("[LINKING FAILURE]\n",name,"\n",log);
+		combine(seed,face->failOp,face->passOp,face->depthFailOp,face->compareOp,
+			face->compareMask,face->writeMask,face->reference);
 	}
-	return pipelineCache.insert({m_id,std::make_shared<BASIS::PipelineInfo>(info)}).first->first;
+	for(const float level : ts.innerPatchLevel) combine(seed,level);
+	for(const float level : ts.outerPatchLevel) combine(seed,level);
+	combine(seed,ts.patchVertices);
+	combine(seed,rs.depthClampEnable,rs.polygonMode,rs.cullMode,rs.frontFace,rs.depthBiasEnable,
+		rs.depthBiasConstantFactor,rs.depthBiasSlopeFactor,rs.lineWidth,rs.pointSize);
+	return seed;
+}
+bool sameFixedState(const BASIS::PipelineInfo& a,const BASIS::PipelineInfo& b)
+{
+	return a.mode == b.mode &&
+	a.depthState == b.depthState &&
+	a.blendState == b.blendState &&
+	a.stencilState == b.stencilState &&
+	a.tessellationState == b.tessellationState &&
+	a.rasterizationState == b.rasterizationState;
+}
+// vaos are never deleted, they're shared by every pipeline with the same vertex input
+std::unordered_multimap<std::size_t,std::pair<BASIS::VertexInputState,std::uint32_t>> vaoCache;
+std::uint32_t getVAO(const BASIS::VertexInputState& state)
+{
+	const auto hash = hashVertexInput(state);
+	auto [first,last] = vaoCache.equal_range(hash);
+	for(auto it = first;it != last;it++)
+	{
+		if(it->second.first == state) return it->second.second;
+	}
+	std::uint32_t id{};
+	glCreateVertexArrays(1,&id);
+	for(const auto& cur : state)
+	{
+		glEnableVertexArrayAttrib(id,cur.location);
+		glVertexArrayAttribBinding(id,cur.location,cur.binding);
+		glVertexArrayAttribFormat(id,cur.location,
+		formatTo(cur.fmt,BASIS::BITMASK::SIZE_GL),
+		formatTo(cur.fmt,BASIS::BITMASK::TYPE_GL),
+		formatTo(cur.fmt,BASIS::BITMASK::IS_NORMALIZED),
+		cur.offset);
+	}
+	vaoCache.emplace(hash,std::make_pair(state,id));
+	return id;
+}
+// index into fixedStates is the fingerprint, so equal fingerprints always mean equal state
+std::vector<BASIS::PipelineInfo> fixedStates;
+std::unordered_multimap<std::size_t,std::uint32_t> fingerprintCache;
+std::uint32_t getFingerprint(const BASIS::PipelineInfo& info,std::size_t fixedHash)
+{
+	auto [first,last] = fingerprintCache.equal_range(fixedHash);
+	for(auto it = first;it != last;it++)
+	{
+		if(sameFixedState(fixedStates[it->second],info)) return it->second;
+	}
+	auto& fixed = fixedStates.emplace_back(info);
+	fixed.vertexInputState.clear();
+	const auto fingerprint = static_cast<std::uint32_t>(fixedStates.size() - 1);
+	fingerprintCache.emplace(fixedHash,fingerprint);
+	return fingerprint;
+}
+// blocks die with their last pipeline, dead entries are dropped on lookup
+std::unordered_multimap<std::size_t,std::weak_ptr<const BASIS::PipelineState>> stateCache;
+std::shared_ptr<const BASIS::PipelineState> bakeState(const BASIS::PipelineInfo& info)
+{
+	const auto fixedHash = hashFixedState(info);
+	auto hash = fixedHash;
+	BASIS::hash_combine(hash,hashVertexInput(info.vertexInputState));
+
+	auto [first,last] = stateCache.equal_range(hash);
+	for(auto it = first;it != last;)
+	{
+		if(auto state = it->second.lock())
+		{
+			if(state->info == info) return state;
+			it++;
+		}
+		else it = stateCache.erase(it);
+	}
+	auto state = std::make_shared<const BASIS::PipelineState>(BASIS::PipelineState{
+		.info = info,
+		.vao = getVAO(info.vertexInputState),
+		.fingerprint = getFingerprint(info,fixedHash)
+	});
+	stateCache.emplace(hash,state);
+	return state;
 }
 }
 namespace BASIS
@@ -107,26 +201,29 @@ Pipeline::Pipeline(const PipelineCreateInfo& info,std::string_view name)
 		glDeleteProgram(m_id);
 		throw PipelineException("[LINKING FAILURE]\n",name,"\n",log);
 	}
-	m_id = compilePipeline(info,name);
-}
-const std::shared_ptr<const PipelineInfo> Pipeline::info() const noexcept
-{
-    auto it = pipelineCache.find(m_id);
-	return it != pipelineCache.end() ? it->second : nullptr;
+	m_state = bakeState(info);
 }
 Pipeline::~Pipeline()
 {
-	if(m_id) glDeleteProgram(m_id);
+	if(!m_id) return;
+	glDeleteProgram(m_id);
+	notifyObjectDeleted(GLObjectType::PROGRAM,m_id);
 }
 Pipeline::Pipeline(Pipeline&& other) noexcept
 {
 	m_id = std::exchange(other.m_id,0);
+	m_state = std::move(other.m_state);
 }
 Pipeline& Pipeline::operator=(Pipeline&& other) noexcept
 {
 	if(&other == this) return *this;
-	
+	if(m_id)
+	{
+		glDeleteProgram(m_id);
+		notifyObjectDeleted(GLObjectType::PROGRAM,m_id);
+	}
 	m_id = std::exchange(other.m_id,0);
+	m_state = std::move(other.m_state);
 	return *this;
 }
 
@@ -150,12 +247,18 @@ ComputePipeline::ComputePipeline(ComputePipeline&& other) noexcept
 ComputePipeline& ComputePipeline::operator=(ComputePipeline&& other) noexcept
 {
 	if(&other == this) return *this;
-	
+	if(m_id)
+	{
+		glDeleteProgram(m_id);
+		notifyObjectDeleted(GLObjectType::PROGRAM,m_id);
+	}
 	m_id = std::exchange(other.m_id,0);
 	return *this;
 }
 ComputePipeline::~ComputePipeline()
 {
-	if(m_id) glDeleteProgram(m_id);
+	if(!m_id) return;
+	glDeleteProgram(m_id);
+	notifyObjectDeleted(GLObjectType::PROGRAM,m_id);
 }
 };
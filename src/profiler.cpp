@@ -0,0 +1,309 @@
+#include <BASIS/profiler.h>
+
+#include <cstdio>
+#include <cassert>
+#include <fstream>
+#include <utility>
+#include <algorithm>
+
+#include <glad/gl.h>
+
+#include <imgui.h>
+
+namespace
+{
+std::atomic<std::uint32_t> threadCounter{};
+std::atomic<std::uint32_t> profilerCounter{};
+thread_local std::uint32_t threadIdx = threadCounter.fetch_add(1,std::memory_order_relaxed);
+thread_local std::uint32_t zoneDepth{};
+
+void pushSample(std::uint64_t time,std::uint32_t& head,std::uint32_t& count,auto& samples)
+{
+	samples[head] = time;
+	head = (head + 1) % samples.size();
+	count = std::min<std::uint32_t>(count + 1,samples.size());
+}
+void writeEscaped(std::ofstream& out,const char* str)
+{
+	for(;*str;str++)
+	{
+		if(*str == '"' || *str == '\\') out << '\\';
+		out << *str;
+	}
+}
+}
+namespace BASIS
+{
+Profiler::Profiler(std::uint32_t maxGpuZones,std::uint32_t latency) :
+m_id(profilerCounter.fetch_add(1,std::memory_order_relaxed)),
+m_maxGpuZones(maxGpuZones),
+m_latency(std::max(latency,1u))
+{
+}
+Profiler::~Profiler()
+{
+	// context is usually gone by the time statics die, queries leak rather than touch it
+	static_cast<void>(m_gpuQueries.release());
+}
+Profiler& defaultProfiler()
+{
+	static Profiler profiler;
+	return profiler;
+}
+void Profiler::releaseQueries()
+{
+	m_gpuQueries.reset();
+}
+void Profiler::calibrate()
+{
+	std::int64_t gpuNow{};
+	glGetInteger64v(GL_TIMESTAMP,&gpuNow);
+	m_gpuOffset = gpuNow - static_cast<std::int64_t>(now());
+	m_calibrated = true;
+}
+Profiler::GpuZoneId Profiler::beginZone(const char* name,bool gpu)
+{
+	if(!gpu) return {};
+	if(!m_gpuQueries)
+	{
+		m_gpuQueries = std::make_unique<GPUQueryPool>(m_maxGpuZones,m_latency);
+		m_gpuQueries->beginFrame();
+	}
+	if(!m_calibrated) calibrate();
+	glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION,0,-1,name);
+	m_gpuNames.try_emplace(name,name);
+	return m_gpuQueries->begin(name);
+}
+void Profiler::endZone(const char* name,std::uint64_t start,std::uint32_t depth,GpuZoneId gpuZone)
+{
+	const auto end = now();
+	if(gpuZone.idx != GPUQueryPool::NO_SCOPE)
+	{
+		// queries could be released while zone was open
+		if(m_gpuQueries) m_gpuQueries->end(gpuZone);
+		glPopDebugGroup();
+	}
+	record({.name = name,.start = start,.end = end,.thread = threadIdx,.depth = depth});
+}
+Profiler::ThreadBuffer& Profiler::threadBuffer()
+{
+	// profiler id -> buffer, usually there's only defaultProfiler()
+	thread_local std::vector<std::pair<std::uint32_t,ThreadBuffer*>> buffers;
+	for(const auto& [id,buffer] : buffers)
+	{
+		if(id == m_id) return *buffer;
+	}
+	std::lock_guard lock(m_mutex);
+	auto* buffer = m_threads.emplace_back(std::make_unique<ThreadBuffer>()).get();
+	buffers.emplace_back(m_id,buffer);
+	return *buffer;
+}
+void Profiler::record(const ProfileEvent& event)
+{
+	auto& buffer = threadBuffer();
+	std::lock_guard lock(buffer.mutex);
+	if(buffer.events.size() >= MAX_THREAD_EVENTS)
+	{
+		buffer.dropped++;
+		return;
+	}
+	buffer.events.push_back(event);
+}
+void Profiler::newFrame()
+{
+	const auto time = now();
+	if(m_gpuQueries)
+	{
+		// zones still open on gl thread end in their old slot, it's resolved once it comes around again
+		m_gpuQueries->endFrame();
+		if(m_gpuQueries->beginFrame())
+		{
+			const auto toCpu = [&](std::uint64_t t){ return static_cast<std::uint64_t>(std::max<std::int64_t>(static_cast<std::int64_t>(t) - m_gpuOffset,0)); };
+			for(const auto& zone : m_gpuQueries->results())
+			{
+				record({.name = m_gpuNames.at(zone.name),.start = toCpu(zone.start),.end = toCpu(zone.end),.thread = GPU_THREAD,.depth = zone.depth});
+			}
+		}
+	}
+	{
+		std::lock_guard lock(m_mutex);
+		m_lastFrame.clear();
+		for(auto& thread : m_threads)
+		{
+			std::lock_guard threadLock(thread->mutex);
+			m_lastFrame.insert(m_lastFrame.end(),thread->events.begin(),thread->events.end());
+			m_dropped += std::exchange(thread->dropped,0);
+			thread->events.clear();
+		}
+		if(m_capturing) m_capture.insert(m_capture.end(),m_lastFrame.begin(),m_lastFrame.end());
+		for(const auto& event : m_lastFrame)
+		{
+			auto& history = (event.thread == GPU_THREAD ? m_gpuHistory : m_cpuHistory)[event.name];
+			history.gpu = event.thread == GPU_THREAD;
+			history.frameTime += event.end - event.start;
+			history.frameCalls++;
+		}
+		for(auto* histories : {&m_cpuHistory,&m_gpuHistory})
+		{
+			for(auto& [name,history] : *histories)
+			{
+				history.lastCalls = history.frameCalls;
+				// zones which didn't run this frame(asset loads etc.) don't drag min down
+				if(history.frameCalls > 0) pushSample(history.frameTime,history.head,history.count,history.samples);
+				history.frameTime = 0;
+				history.frameCalls = 0;
+			}
+		}
+		m_lastFrameStart = m_frameStart;
+		m_lastFrameEnd = time;
+		m_frameStart = time;
+	}
+}
+std::vector<ZoneStats> Profiler::stats() const
+{
+	std::vector<ZoneStats> out;
+	std::vector<std::uint64_t> sorted;
+	std::lock_guard lock(m_mutex);
+	for(const auto* histories : {&m_cpuHistory,&m_gpuHistory})
+	{
+		for(const auto& [name,history] : *histories)
+		{
+			if(history.count == 0) continue;
+			sorted.assign(history.samples.begin(),history.samples.begin() + history.count);
+			std::sort(sorted.begin(),sorted.end());
+			std::uint64_t sum{};
+			for(const auto sample : sorted) sum += sample;
+			out.push_back({
+				.name = name.data(),
+				.gpu = history.gpu,
+				.min = sorted.front(),
+				.avg = sum / sorted.size(),
+				.p99 = sorted[std::min<std::size_t>(sorted.size() * 99 / 100,sorted.size() - 1)],
+				.calls = history.lastCalls
+			});
+		}
+	}
+	std::sort(out.begin(),out.end(),[](const auto& a,const auto& b){ return a.avg > b.avg; });
+	return out;
+}
+void Profiler::startCapture()
+{
+	std::lock_guard lock(m_mutex);
+	m_capture.clear();
+	m_capturing = true;
+}
+bool Profiler::stopCapture(std::string_view path)
+{
+	std::vector<ProfileEvent> events;
+	{
+		std::lock_guard lock(m_mutex);
+		m_capturing = false;
+		events = std::move(m_capture);
+		m_capture.clear();
+	}
+	std::ofstream out{std::string(path),std::ios::trunc};
+	if(!out) return false;
+	// complete events("ph":"X"), timestamps in microseconds
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << GPU_THREAD << ",\"args\":{\"name\":\"GPU\"}}";
+	char buf[96];
+	for(const auto& e : events)
+	{
+		out << ",\n{\"name\":\"";
+		writeEscaped(out,e.name);
+		std::snprintf(buf,sizeof(buf),"\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,",e.start / 1000.0,(e.end - e.start) / 1000.0);
+		out << buf << "\"pid\":0,\"tid\":" << e.thread << ",\"cat\":\"" << (e.thread == GPU_THREAD ? "gpu" : "cpu") << "\"}";
+	}
+	out << "\n]}\n";
+	return static_cast<bool>(out);
+}
+void Profiler::gui()
+{
+	ImGui::Begin("Profiler");
+	if(ImGui::Button(m_capturing ? "Stop capture" : "Start capture"))
+	{
+		m_capturing ? static_cast<void>(stopCapture("basis_trace.json")) : startCapture();
+	}
+	ImGui::SameLine();
+	ImGui::Text("frame %.3f ms",(m_lastFrameEnd - m_lastFrameStart) / 1e6);
+	if(m_dropped > 0)
+	{
+		ImGui::SameLine();
+		ImGui::Text("(%llu events dropped)",static_cast<unsigned long long>(m_dropped));
+	}
+
+	// flame view, one block of rows per thread, gpu block is aligned to its own first zone
+	std::vector<std::uint32_t> threads;
+	std::uint32_t maxDepth{};
+	std::uint64_t gpuStart = ~0ull,gpuEnd{};
+	for(const auto& e : m_lastFrame)
+	{
+		if(std::find(threads.begin(),threads.end(),e.thread) == threads.end()) threads.push_back(e.thread);
+		maxDepth = std::max(maxDepth,e.depth);
+		if(e.thread != GPU_THREAD) continue;
+		gpuStart = std::min(gpuStart,e.start);
+		gpuEnd = std::max(gpuEnd,e.end);
+	}
+	std::sort(threads.begin(),threads.end());
+	const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+	const float width = std::max(ImGui::GetContentRegionAvail().x,1.f);
+	const float height = rowHeight * (maxDepth + 1) * threads.size();
+	const auto origin = ImGui::GetCursorScreenPos();
+	const double span = static_cast<double>(std::max({m_lastFrameEnd - m_lastFrameStart,gpuEnd > gpuStart ? gpuEnd - gpuStart : 0,std::uint64_t{1}}));
+	auto* drawList = ImGui::GetWindowDrawList();
+	ImGui::InvisibleButton("flame",ImVec2(width,std::max(height,rowHeight)));
+	const bool hovered = ImGui::IsItemHovered();
+	const auto mouse = ImGui::GetMousePos();
+	for(const auto& e : m_lastFrame)
+	{
+		const auto block = static_cast<std::uint32_t>(std::find(threads.begin(),threads.end(),e.thread) - threads.begin());
+		const auto base = e.thread == GPU_THREAD ? gpuStart : m_lastFrameStart;
+		const float x0 = origin.x + static_cast<float>((static_cast<double>(e.start) - static_cast<double>(base)) / span * width);
+		const float x1 = std::max(origin.x + static_cast<float>((static_cast<double>(e.end) - static_cast<double>(base)) / span * width),x0 + 1.f);
+		const float y0 = origin.y + rowHeight * (block * (maxDepth + 1) + e.depth);
+		const ImVec2 min(x0,y0),max(x1,y0 + rowHeight - 1.f);
+		const ImU32 color = e.thread == GPU_THREAD ? IM_COL32(200,90,60,255) : IM_COL32(70,130,200,255);
+		drawList->AddRectFilled(min,max,color);
+		drawList->PushClipRect(min,max,true);
+		drawList->AddText(ImVec2(x0 + 2.f,y0),IM_COL32_WHITE,e.name);
+		drawList->PopClipRect();
+		if(hovered && mouse.x >= x0 && mouse.x < x1 && mouse.y >= y0 && mouse.y < max.y)
+		{
+			ImGui::SetTooltip("%s(%s) %.3f ms",e.name,e.thread == GPU_THREAD ? "gpu" : "cpu",(e.end - e.start) / 1e6);
+		}
+	}
+
+	if(ImGui::BeginTable("zones",6,ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		for(const char* column : {"zone","side","min ms","avg ms","p99 ms","calls"}) ImGui::TableSetupColumn(column);
+		ImGui::TableHeadersRow();
+		for(const auto& zone : stats())
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::TextUnformatted(zone.name);
+			ImGui::TableNextColumn(); ImGui::TextUnformatted(zone.gpu ? "gpu" : "cpu");
+			ImGui::TableNextColumn(); ImGui::Text("%.3f",zone.min / 1e6);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f",zone.avg / 1e6);
+			ImGui::TableNextColumn(); ImGui::Text("%.3f",zone.p99 / 1e6);
+			ImGui::TableNextColumn(); ImGui::Text("%u",zone.calls);
+		}
+		ImGui::EndTable();
+	}
+	ImGui::End();
+}
+ProfileZone::ProfileZone(const char* name,bool gpu,Profiler& profiler)
+{
+	if(!profiler.enabled()) return;
+	m_profiler = &profiler;
+	m_name = name;
+	m_depth = zoneDepth++;
+	m_gpuZone = profiler.beginZone(name,gpu);
+	m_start = profiler.now();
+}
+ProfileZone::~ProfileZone()
+{
+	if(!m_profiler) return;
+	zoneDepth--;
+	m_profiler->endZone(m_name,m_start,m_depth,m_gpuZone);
+}
+}
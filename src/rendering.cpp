@@ -1,176 +1,284 @@
 #include <BASIS/types.h>
+#include <BASIS/timer.h>
 #include <BASIS/context.h>
 #include <BASIS/pipeline.h>
 #include <BASIS/rendering.h>
+#include <BASIS/profiler.h>
+#include <BASIS/gpu_memory.h>
 
+#include <bit>
+#include <cfloat>
+#include <chrono>
 #include <cassert>
+#include <utility>
 #include <algorithm>
 
 #include <glad/gl.h>
 
+#include <imgui.h>
+
 namespace
 {
-static std::size_t hashVAO(const BASIS::VertexInputState& state)
+// adds duration of enclosing scope to histogram of call if timing is on
+struct CallTimer
 {
-	std::size_t totalHash{};
-	std::for_each(state.begin(),state.end(),
-	[&](const auto& cur)
+	using clock = std::chrono::steady_clock;
+	CallTimer(BASIS::FrameStats& stats,BASIS::RendererCall call) :
+	m_histogram(stats.callTiming ? &stats.callTimes[static_cast<std::size_t>(call)] : nullptr)
 	{
-		auto tup = std::make_tuple(cur.location, cur.binding, cur.fmt, cur.offset);
-		auto tupHash = BASIS::hash<decltype(tup)>{}(tup);
-		BASIS::hash_combine(totalHash,tupHash);
-	});
-	return totalHash;
-}
-std::unordered_map<std::size_t,std::uint32_t> vaoCache;
-static std::uint32_t getVAO(const BASIS::VertexInputState& state)
-{
-	auto vao_hash = hashVAO(state);
-	if(auto it = vaoCache.find(vao_hash);it != vaoCache.end()) return it->second;
-	
-	std::uint32_t id{};
-	glCreateVertexArrays(1, &id);
-	std::for_each(state.begin(),state.end(),
-	[&](const auto& cur)
+		if(m_histogram) m_start = clock::now();
+	}
+	~CallTimer()
 	{
-		glEnableVertexArrayAttrib(id, cur.location);
-		glVertexArrayAttribBinding(id, cur.location, cur.binding);
-		glVertexArrayAttribFormat(id, cur.location,
-		formatTo(cur.fmt,BASIS::BITMASK::SIZE_GL),
-		formatTo(cur.fmt,BASIS::BITMASK::TYPE_GL),
-		formatTo(cur.fmt,BASIS::BITMASK::IS_NORMALIZED),
-		cur.offset);
-	});
-	return vaoCache.try_emplace(vao_hash,id).first->second;	
-}
-static void enableOrDisable(std::uint32_t state, bool value)
-{
-	value ? glEnable(state) : glDisable(state);
-}
-}
-namespace BASIS
-{
-	
-void Renderer::bindUniformBuffer(const Buffer& buf,std::uint32_t idx,std::uint64_t size,std::uint64_t offs)
-{
-	assert(context->isRendering);
-	glBindBufferRange(GL_UNIFORM_BUFFER, idx, 
-	buf.id(), offs, 
-	size == WHOLE_BUFFER ? buf.size() - offs : size);
+		if(!m_histogram) return;
+		const auto ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - m_start).count());
+		const auto bucket = std::min<std::uint32_t>(std::bit_width(ns),BASIS::CALL_TIME_BUCKETS) - (ns > 0);
+		m_histogram->buckets[bucket]++;
+		m_histogram->totalTime += ns;
+		m_histogram->calls++;
+	}
+	CallTimer(const CallTimer&) = delete;
+	CallTimer& operator=(const CallTimer&) = delete;
+	private:
+	BASIS::CallHistogram* m_histogram;
+	clock::time_point m_start{};
+};
+static void setCapability(BASIS::RenderingContext& ctx,std::uint32_t cap,bool value)
+{
+	auto [it,inserted] = ctx.capabilities.try_emplace(cap,value);
+	if(!inserted && it->second == value)
+	{
+		ctx.elided.capabilities++;
+		return;
+	}
+	it->second = value;
+	ctx.issued.capabilities++;
+	value ? glEnable(cap) : glDisable(cap);
 }
-void Renderer::bindStorageBuffer(const Buffer& buf,std::uint32_t idx,std::uint64_t size,std::uint64_t offs)
+static void setBlendFuncs(BASIS::RenderingContext& ctx,const BASIS::BlendFuncs& funcs)
 {
-	assert(context->isRendering);
-	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, idx, 
-	buf.id(), offs, 
-	size == WHOLE_BUFFER ? buf.size() - offs : size);
+	if(ctx.blendFuncs == funcs)
+	{
+		ctx.elided.blendFuncs++;
+		return;
+	}
+	ctx.blendFuncs = funcs;
+	ctx.issued.blendFuncs++;
+	glBlendFuncSeparate(enumToGL(funcs.srcRGB),enumToGL(funcs.dstRGB),enumToGL(funcs.srcAlpha),enumToGL(funcs.dstAlpha));
 }
-void Renderer::bindSampledImage(std::uint32_t index, const Texture& texture, const Sampler& sampler)
+static void setStencilFace(std::uint32_t face,const BASIS::StencilOpState& state)
 {
-	assert(context->isRendering);
-	glBindTextureUnit(index, texture.id());
-    glBindSampler(index, sampler.id());
+	glStencilFuncSeparate(face,enumToGL(state.compareOp),state.reference,state.compareMask);
+	glStencilOpSeparate(face,enumToGL(state.failOp),enumToGL(state.depthFailOp),enumToGL(state.passOp));
+	glStencilMaskSeparate(face,state.writeMask);
 }
-void Renderer::bindPipeline(const Pipeline& pipe)
+// prev - state known to be set, nullptr forces everything
+static void applyFixedState(BASIS::RenderingContext& ctx,const BASIS::PipelineInfo* prev,const BASIS::PipelineInfo& inf)
 {
-	assert(context->isRendering);
-	assert(pipe.id() && "Can't bind uninitialized pipeline");
-	
-	if(context->lastPipelineInfo == pipe.info()) return;
-	glUseProgram(pipe.id());
-
-	const auto& inf = pipe.info();
-	
-	context->primitiveMode = inf->mode;
-	if(auto newVao = getVAO(inf->vertexInputState);newVao != context->vao)
-	{
-		context->vao = newVao;
-		glBindVertexArray(newVao);
-	}
+	using namespace BASIS;
 	// TessellationState
-	const auto& tss = inf->tessellationState;
+	const auto& tss = inf.tessellationState;
 	if(tss.patchVertices > 0)
 	{
-		if(!context->lastPipelineInfo || tss.patchVertices != context->lastPipelineInfo->tessellationState.patchVertices)
+		if(!prev || tss.patchVertices != prev->tessellationState.patchVertices)
 		{
 			glPatchParameteri(GL_PATCH_VERTICES, tss.patchVertices);
 		}
 	}
-	if(!context->lastPipelineInfo || tss.innerPatchLevel != context->lastPipelineInfo->tessellationState.innerPatchLevel)
+	if(!prev || tss.innerPatchLevel != prev->tessellationState.innerPatchLevel)
 	{
 		glPatchParameterfv(GL_PATCH_DEFAULT_INNER_LEVEL,tss.innerPatchLevel.data());
 	}
-	if(!context->lastPipelineInfo || tss.outerPatchLevel != context->lastPipelineInfo->tessellationState.outerPatchLevel)
+	if(!prev || tss.outerPatchLevel != prev->tessellationState.outerPatchLevel)
 	{
 		glPatchParameterfv(GL_PATCH_DEFAULT_OUTER_LEVEL,tss.outerPatchLevel.data());
 	}
 
 	// DepthState
-	const auto& ds = inf->depthState;
-	if (!context->lastPipelineInfo || ds.depthTestEnable != context->lastPipelineInfo->depthState.depthTestEnable)
-	{
-		enableOrDisable(GL_DEPTH_TEST, ds.depthTestEnable);
-	}
+	const auto& ds = inf.depthState;
+	setCapability(ctx,GL_DEPTH_TEST,ds.depthTestEnable);
 
-	if (!context->lastPipelineInfo || ds.depthWriteEnable != context->lastPipelineInfo->depthState.depthWriteEnable)
+	if (!prev || ds.depthWriteEnable != prev->depthState.depthWriteEnable)
 	{
 		glDepthMask(ds.depthWriteEnable);
 	}
 
-	if (!context->lastPipelineInfo || ds.depthCompareOp != context->lastPipelineInfo->depthState.depthCompareOp)
+	if (!prev || ds.depthCompareOp != prev->depthState.depthCompareOp)
 	{
 		glDepthFunc(enumToGL(ds.depthCompareOp));
 	}
 
-	const auto& rs = inf->rasterizationState;
-	if (!context->lastPipelineInfo || rs.depthClampEnable != context->lastPipelineInfo->rasterizationState.depthClampEnable)
-	{
-		enableOrDisable(GL_DEPTH_CLAMP, rs.depthClampEnable);
-	}
+	const auto& rs = inf.rasterizationState;
+	setCapability(ctx,GL_DEPTH_CLAMP,rs.depthClampEnable);
 
-	if (!context->lastPipelineInfo || rs.polygonMode != context->lastPipelineInfo->rasterizationState.polygonMode)
+	if (!prev || rs.polygonMode != prev->rasterizationState.polygonMode)
 	{
 		glPolygonMode(GL_FRONT_AND_BACK, enumToGL(rs.polygonMode));
 	}
 
-	if (!context->lastPipelineInfo || rs.cullMode != context->lastPipelineInfo->rasterizationState.cullMode)
+	setCapability(ctx,GL_CULL_FACE,rs.cullMode != CullMode::NONE);
+	if (rs.cullMode != CullMode::NONE && (!prev || rs.cullMode != prev->rasterizationState.cullMode))
 	{
-		enableOrDisable(GL_CULL_FACE, rs.cullMode != CullMode::NONE);
-		if (rs.cullMode != CullMode::NONE)
-		{
-			glCullFace(enumToGL(rs.cullMode));
-		}
+		glCullFace(enumToGL(rs.cullMode));
 	}
 
-	if (!context->lastPipelineInfo || rs.frontFace != context->lastPipelineInfo->rasterizationState.frontFace)
+	if (!prev || rs.frontFace != prev->rasterizationState.frontFace)
 	{
 		glFrontFace(enumToGL(rs.frontFace));
 	}
 
-	if (!context->lastPipelineInfo || rs.depthBiasEnable != context->lastPipelineInfo->rasterizationState.depthBiasEnable)
-	{
-		enableOrDisable(GL_POLYGON_OFFSET_FILL, rs.depthBiasEnable);
-		enableOrDisable(GL_POLYGON_OFFSET_LINE, rs.depthBiasEnable);
-		enableOrDisable(GL_POLYGON_OFFSET_POINT, rs.depthBiasEnable);
-	}
+	setCapability(ctx,GL_POLYGON_OFFSET_FILL,rs.depthBiasEnable);
+	setCapability(ctx,GL_POLYGON_OFFSET_LINE,rs.depthBiasEnable);
+	setCapability(ctx,GL_POLYGON_OFFSET_POINT,rs.depthBiasEnable);
 
-	if (!context->lastPipelineInfo ||
-	rs.depthBiasSlopeFactor != context->lastPipelineInfo->rasterizationState.depthBiasSlopeFactor ||
-	rs.depthBiasConstantFactor != context->lastPipelineInfo->rasterizationState.depthBiasConstantFactor)
+	if (!prev ||
+	rs.depthBiasSlopeFactor != prev->rasterizationState.depthBiasSlopeFactor ||
+	rs.depthBiasConstantFactor != prev->rasterizationState.depthBiasConstantFactor)
 	{
 		glPolygonOffset(rs.depthBiasSlopeFactor, rs.depthBiasConstantFactor);
 	}
 
-	if (!context->lastPipelineInfo || rs.lineWidth != context->lastPipelineInfo->rasterizationState.lineWidth)
+	if (!prev || rs.lineWidth != prev->rasterizationState.lineWidth)
 	{
 		glLineWidth(rs.lineWidth);
 	}
 
-	if (!context->lastPipelineInfo || rs.pointSize != context->lastPipelineInfo->rasterizationState.pointSize)
+	if (!prev || rs.pointSize != prev->rasterizationState.pointSize)
 	{
 		glPointSize(rs.pointSize);
 	}
 
+	// BlendState, funcs and equations are set even with blending off so prev always matches gl
+	const auto& bs = inf.blendState;
+	setCapability(ctx,GL_BLEND,bs.blendEnable);
+	setBlendFuncs(ctx,BlendFuncs{bs.srcColorBlendFactor,bs.dstColorBlendFactor,bs.srcAlphaBlendFactor,bs.dstAlphaBlendFactor});
+	if (!prev || bs.colorBlendOp != prev->blendState.colorBlendOp || bs.alphaBlendOp != prev->blendState.alphaBlendOp)
+	{
+		glBlendEquationSeparate(enumToGL(bs.colorBlendOp),enumToGL(bs.alphaBlendOp));
+	}
+	if (!prev || bs.colorWriteMask != prev->blendState.colorWriteMask)
+	{
+		glColorMask(bs.colorWriteMask[0],bs.colorWriteMask[1],bs.colorWriteMask[2],bs.colorWriteMask[3]);
+	}
+
+	// StencilState
+	const auto& ss = inf.stencilState;
+	setCapability(ctx,GL_STENCIL_TEST,ss.stencilTestEnable);
+	if (!prev || ss.front != prev->stencilState.front) setStencilFace(GL_FRONT,ss.front);
+	if (!prev || ss.back != prev->stencilState.back) setStencilFace(GL_BACK,ss.back);
+}
+static void bindBufferRange(
+BASIS::Renderer& renderer,
+std::vector<BASIS::BufferRange>& shadow,
+std::uint32_t target,
+std::uint32_t idx,
+const BASIS::Buffer& buf,
+std::uint64_t size,
+std::uint64_t offs)
+{
+	assert(idx < shadow.size());
+	auto& ctx = *renderer.context;
+	ctx.syncDeletions();
+	const BASIS::BufferRange range{.buffer = buf.id(),.offset = offs,.size = size == BASIS::WHOLE_BUFFER ? buf.size() - offs : size};
+	if(shadow[idx] == range)
+	{
+		ctx.elided.bufferRanges++;
+		return;
+	}
+	renderer.flushDraws();
+	shadow[idx] = range;
+	ctx.issued.bufferRanges++;
+	glBindBufferRange(target,idx,range.buffer,range.offset,range.size);
+}
+}
+namespace BASIS
+{
+	
+void Renderer::bindUniformBuffer(const Buffer& buf,std::uint32_t idx,std::uint64_t size,std::uint64_t offs)
+{
+	CallTimer timer(m_frameStats,RendererCall::BIND_BUFFER_RANGE);
+	assert(context->isRendering || context->isComputeActive);
+	bindBufferRange(*this,context->uniformBuffers,GL_UNIFORM_BUFFER,idx,buf,size,offs);
+}
+void Renderer::bindStorageBuffer(const Buffer& buf,std::uint32_t idx,std::uint64_t size,std::uint64_t offs)
+{
+	CallTimer timer(m_frameStats,RendererCall::BIND_BUFFER_RANGE);
+	assert(context->isRendering || context->isComputeActive);
+	bindBufferRange(*this,context->storageBuffers,GL_SHADER_STORAGE_BUFFER,idx,buf,size,offs);
+}
+void Renderer::bindSampledImage(std::uint32_t index, const Texture& texture, const Sampler& sampler)
+{
+	CallTimer timer(m_frameStats,RendererCall::BIND_TEXTURE);
+	assert(context->isRendering || context->isComputeActive);
+	assert(index < context->textureUnits.size());
+	context->syncDeletions();
+	if(context->textureUnits[index] != texture.id() || context->samplerUnits[index] != sampler.id()) flushDraws();
+	if(context->textureUnits[index] != texture.id())
+	{
+		context->textureUnits[index] = texture.id();
+		context->issued.textures++;
+		glBindTextureUnit(index, texture.id());
+	}
+	else context->elided.textures++;
+	if(context->samplerUnits[index] != sampler.id())
+	{
+		context->samplerUnits[index] = sampler.id();
+		context->issued.samplers++;
+		glBindSampler(index, sampler.id());
+	}
+	else context->elided.samplers++;
+}
+void Renderer::bindImage(std::uint32_t index,const Texture& texture,std::uint32_t level,AccessFlags access)
+{
+	CallTimer timer(m_frameStats,RendererCall::BIND_TEXTURE);
+	assert(context->isRendering || context->isComputeActive);
+	assert(level < texture.info().mipLevels);
+	flushDraws();
+	context->issued.textures++;
+	glBindImageTexture(index,texture.id(),level,GL_FALSE,0,
+	static_cast<std::uint32_t>(access),
+	formatTo(texture.info().fmt,BITMASK::FORMAT_GL));
+}
+void Renderer::bindPipeline(const Pipeline& pipe)
+{
+	CallTimer timer(m_frameStats,RendererCall::BIND_PIPELINE);
+	assert(context->isRendering);
+	assert(pipe.id() && "Can't bind uninitialized pipeline");
+	
+	context->syncDeletions();
+	const auto* state = &pipe.state();
+	const auto* prev = context->lastPipelineState;
+	if(context->lastBoundPipeline != pipe.id() || state != prev) flushDraws();
+	if(context->lastBoundPipeline != pipe.id())
+	{
+		context->issued.programs++;
+		glUseProgram(pipe.id());
+		context->lastBoundPipeline = pipe.id();
+	}
+	else context->elided.programs++;
+
+	// state blocks are immutable and deduplicated, same pointer means nothing to change
+	if(state == prev)
+	{
+		context->elided.pipelineStates++;
+		return;
+	}
+	context->primitiveMode = state->info.mode;
+	if(state->vao != context->vao)
+	{
+		context->vao = state->vao;
+		context->issued.vertexArrays++;
+		glBindVertexArray(state->vao);
+	}
+	else context->elided.vertexArrays++;
+
+	if(prev && prev->fingerprint == state->fingerprint) context->elided.pipelineStates++;
+	else
+	{
+		context->issued.pipelineStates++;
+		applyFixedState(*context,prev ? &prev->info : nullptr,state->info);
+	}
+	context->lastPipelineState = state;
 }
 void Renderer::blitFramebuffer(
 	const Framebuffer& src,
@@ -181,6 +289,7 @@ void Renderer::blitFramebuffer(
 	Filter filter)
 {
 	assert(filter == Filter::NEAREST || filter == Filter::LINEAR);
+	flushBatchedDraws();
 	glBlitNamedFramebuffer(
 		src.id(),dst.id(),
 		srcRect.x,srcRect.y,srcRect.z,srcRect.w,
@@ -191,13 +300,32 @@ void Renderer::blitFramebuffer(
 
 void Renderer::bindFramebuffer(const Framebuffer& fbo)
 {
-	if(fbo.id() == context->fbo) return;
+	CallTimer timer(m_frameStats,RendererCall::BIND_FRAMEBUFFER);
+	context->syncDeletions();
+	if(fbo.id() == context->fbo)
+	{
+		context->elided.framebuffers++;
+		return;
+	}
+	flushDraws();
 	context->fbo = fbo.id();
+	context->issued.framebuffers++;
 	glBindFramebuffer(GL_FRAMEBUFFER,fbo.id());
 }
 void Renderer::bindDefaultFramebuffer()
 {
-	glBindFramebuffer(GL_FRAMEBUFFER,0);
+	CallTimer timer(m_frameStats,RendererCall::BIND_FRAMEBUFFER);
+	context->syncDeletions();
+	const auto fbo = defaultFramebuffer();
+	if(context->fbo == fbo)
+	{
+		context->elided.framebuffers++;
+		return;
+	}
+	flushDraws();
+	context->fbo = fbo;
+	context->issued.framebuffers++;
+	glBindFramebuffer(GL_FRAMEBUFFER,fbo);
 }
 bool Renderer::isValidDrawFramebuffer(const Framebuffer& fb)
 {
@@ -209,35 +337,164 @@ bool Renderer::isValidReadFramebuffer(const Framebuffer& fb)
 }
 void Renderer::bindComputePipeline(const ComputePipeline& pipe)
 {
+	CallTimer timer(m_frameStats,RendererCall::BIND_COMPUTE_PIPELINE);
 	assert(context->isComputeActive);
 	assert(pipe.id());
 
-	if(context->lastBoundPipeline == pipe.id()) return;
+	context->syncDeletions();
+	if(context->lastBoundPipeline == pipe.id())
+	{
+		context->elided.programs++;
+		return;
+	}
+	context->issued.programs++;
 	glUseProgram(pipe.id());
-
+	context->lastBoundPipeline = pipe.id();
 }
 void Renderer::bindIndexBuffer(const Buffer& buf,IndexType type)
 {
+	CallTimer timer(m_frameStats,RendererCall::BIND_INDEX_BUFFER);
 	assert(context->isRendering);
+	context->syncDeletions();
+	auto& bindings = context->vertexArrays[context->vao];
+	if(type != context->idxType || bindings.elementBuffer != buf.id()) flushDraws();
 	context->isIdxBufferBound = true;
 	context->idxType = type;
+	if(bindings.elementBuffer == buf.id())
+	{
+		context->elided.indexBuffers++;
+		return;
+	}
+	bindings.elementBuffer = buf.id();
+	context->issued.indexBuffers++;
 	glVertexArrayElementBuffer(context->vao, buf.id());
 }
 void Renderer::bindVertexBuffer(const Buffer& buf,std::uint32_t bindPoint,std::uint64_t stride,std::uint64_t offs)
 {
+	CallTimer timer(m_frameStats,RendererCall::BIND_VERTEX_BUFFER);
 	assert(context->isRendering);
+	context->syncDeletions();
+	auto& vertexBuffers = context->vertexArrays[context->vao].vertexBuffers;
+	if(bindPoint >= vertexBuffers.size()) vertexBuffers.resize(bindPoint + 1);
+	const VertexBufferBinding binding{.buffer = buf.id(),.offset = offs,.stride = stride};
+	if(vertexBuffers[bindPoint] == binding)
+	{
+		context->elided.vertexBuffers++;
+		return;
+	}
+	flushDraws();
+	vertexBuffers[bindPoint] = binding;
+	context->issued.vertexBuffers++;
 	glVertexArrayVertexBuffer(context->vao, bindPoint, buf.id(), offs, stride);
 }
 void Renderer::beginFrame()
 {
-	assert(!context->isRendering && "Cannot call BeginFrame() twice");
+	assert(!context->isRendering && !context->isRenderingSuspended && "Cannot call BeginFrame() twice");
+	BASIS_PROFILE_ZONE("Renderer::beginFrame");
+	// current slot holds the oldest frame
+	CPUTimer timer;
+	retireFrame(m_frames[m_frameIndex],true);
+	m_fenceWaitTime = timer.getTime();
+	// newer ones may be done already, their callbacks shouldn't wait for slot reuse
+	for(std::uint32_t i = 1;i < m_frames.size();i++)
+	{
+		if(!retireFrame(m_frames[(m_frameIndex + i) % m_frames.size()],false)) break;
+	}
 	context->isRendering = true;
 }
+bool Renderer::retireFrame(FrameSlot& frame,bool wait)
+{
+	if(frame.fence)
+	{
+		auto fence = static_cast<GLsync>(frame.fence);
+		if(!wait)
+		{
+			const auto result = glClientWaitSync(fence,0,0);
+			if(result == GL_TIMEOUT_EXPIRED) return false;
+		}
+		else
+		{
+			// flush so fence can signal at all, later waits don't need it
+			GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+			while(true)
+			{
+				const auto result = glClientWaitSync(fence,flags,1'000'000'000);
+				if(result != GL_TIMEOUT_EXPIRED) break;
+				flags = 0;
+			}
+		}
+		glDeleteSync(fence);
+		frame.fence = nullptr;
+	}
+	for(auto& callback : frame.callbacks) callback();
+	frame.callbacks.clear();
+	return true;
+}
+void Renderer::setFramesInFlight(std::uint32_t count)
+{
+	assert(!context->isRendering && "Frames in flight can't change inside frame");
+	assert(count >= 1 && count <= MAX_FRAMES_IN_FLIGHT);
+	waitIdle();
+	m_frames.resize(std::clamp(count,1u,MAX_FRAMES_IN_FLIGHT));
+	m_frameIndex = 0;
+}
+Renderer::~Renderer()
+{
+	// global hook points at renderer only while its batch isn't empty
+	if(!m_batch.empty()) setBatchingRenderer(nullptr);
+	waitIdle();
+}
+void Renderer::waitIdle()
+{
+	// oldest first, so callbacks run in frame order
+	for(std::uint32_t i{};i < m_frames.size();i++)
+	{
+		retireFrame(m_frames[(m_frameIndex + i) % m_frames.size()],true);
+	}
+}
+void Renderer::onFrameCompleted(std::function<void()> callback)
+{
+	// outside of frame last fenced frame is the one to wait for
+	const auto slot = context->isRendering ? m_frameIndex : (m_frameIndex + m_frames.size() - 1) % m_frames.size();
+	m_frames[slot].callbacks.push_back(std::move(callback));
+}
+void Renderer::submitAtEndFrame(FrameCommands& frame)
+{
+	assert(context->isRendering);
+	m_pendingFrames.push_back(&frame);
+}
 void Renderer::endFrame()
 {
-	assert(context->isRendering && "Cannot call EndFrame() without rendering");
+	assert(context->isRendering && "Cannot call EndFrame() without rendering or inside beginCompute()");
+	BASIS_PROFILE_GPU_ZONE("Renderer::endFrame");
+	flushDraws();
+	m_submitStats = {};
+	for(auto* frame : m_pendingFrames)
+	{
+		const auto stats = frame->merge().execute(*this);
+		m_submitStats.draws += stats.draws;
+		m_submitStats.pipelineBinds += stats.pipelineBinds;
+		m_submitStats.vertexBufferBinds += stats.vertexBufferBinds;
+		m_submitStats.indexBufferBinds += stats.indexBufferBinds;
+		frame->clear();
+	}
+	m_pendingFrames.clear();
+	flushDraws();
 	context->isRendering = false;
 	context->isIdxBufferBound = false;
+
+	auto& frame = m_frames[m_frameIndex];
+	assert(!frame.fence);
+	frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+	m_frameIndex = (m_frameIndex + 1) % m_frames.size();
+	m_frameNumber++;
+
+	m_frameStats.issued = std::exchange(context->issued,{});
+	m_frameStats.elided = std::exchange(context->elided,{});
+	m_frameStats.uploaded = takeUploadedBytes();
+	const bool callTiming = m_frameStats.callTiming;
+	m_lastFrameStats = std::exchange(m_frameStats,{});
+	m_frameStats.callTiming = callTiming;
 }
 void Renderer::draw(
 		std::uint32_t vertexCount,
@@ -245,7 +502,12 @@ void Renderer::draw(
 		std::uint32_t instanceCount,
 		std::uint32_t firstInstance)	
 {
+	CallTimer timer(m_frameStats,RendererCall::DRAW);
 	assert(context->isRendering);
+	flushDraws();
+	m_frameStats.draws++;
+	m_frameStats.instances += instanceCount;
+	m_frameStats.vertices += static_cast<std::uint64_t>(vertexCount) * instanceCount;
 	glDrawArraysInstancedBaseInstance(
 		enumToGL(context->primitiveMode),
 		vertexOffset,
@@ -260,7 +522,11 @@ void Renderer::drawIndirect(
 	std::uint32_t stride,
 	std::uint64_t bufOffset)
 {
+	CallTimer timer(m_frameStats,RendererCall::DRAW_INDIRECT);
 	assert(context->isRendering);
+	flushDraws();
+	m_frameStats.indirectDraws++;
+	m_frameStats.indirectCommands += drawCount;
 	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer.id());
 	glMultiDrawArraysIndirect(enumToGL(context->primitiveMode),
 	reinterpret_cast<void*>(static_cast<uintptr_t>(bufOffset)),
@@ -274,17 +540,78 @@ void Renderer::drawIndexed(
 	std::uint32_t instanceCount,
 	std::uint32_t firstInstance)
 {
+	CallTimer timer(m_frameStats,RendererCall::DRAW_INDEXED);
 	assert(context->isRendering);
 	assert(context->isIdxBufferBound);
+	m_frameStats.indexedDraws++;
+	m_frameStats.instances += instanceCount;
+	m_frameStats.indices += static_cast<std::uint64_t>(idxCount) * instanceCount;
+	if(m_drawBatching)
+	{
+		if(m_batch.empty()) setBatchingRenderer(this);
+		m_batch.push_back({idxCount,instanceCount,idxOffset,vertOffset,firstInstance});
+		return;
+	}
 	glDrawElementsInstancedBaseVertexBaseInstance(
 		enumToGL(context->primitiveMode),
 		idxCount,
 		enumToGL(context->idxType),
-		reinterpret_cast<void*>(idxOffset * sizeof(context->idxType)),
+		reinterpret_cast<void*>(static_cast<std::uintptr_t>(idxOffset) * indexSize(context->idxType)),
 		instanceCount,
 		vertOffset,
 		firstInstance);
 }
+void Renderer::setDrawBatching(bool enable)
+{
+	if(!enable) flushDraws();
+	m_drawBatching = enable;
+}
+void Renderer::flushDraws()
+{
+	if(m_batch.empty()) return;
+	// batch buffer updates below must not flush again
+	setBatchingRenderer(nullptr);
+	CallTimer timer(m_frameStats,RendererCall::FLUSH_DRAWS);
+	const auto mode = enumToGL(context->primitiveMode);
+	const auto type = enumToGL(context->idxType);
+	if(m_batch.size() == 1)
+	{
+		const auto& cmd = m_batch.front();
+		glDrawElementsInstancedBaseVertexBaseInstance(
+			mode,
+			cmd.count,
+			type,
+			reinterpret_cast<void*>(static_cast<std::uintptr_t>(cmd.firstIndex) * indexSize(context->idxType)),
+			cmd.instanceCount,
+			cmd.baseVertex,
+			cmd.baseInstance);
+		m_batch.clear();
+		return;
+	}
+	const auto bytes = m_batch.size() * sizeof(DrawIndexedIndirectCommand);
+	if(!m_batchBuffer || bytes > m_batchBuffer->size())
+	{
+		constexpr std::size_t minSize = 1024 * sizeof(DrawIndexedIndirectCommand);
+		const auto size = std::max({bytes,minSize,m_batchBuffer ? m_batchBuffer->size() * 2 : 0});
+		m_batchBuffer = std::make_unique<Buffer>(size,BufferFlags::DYNAMIC,"draw batch");
+		m_batchOffset = 0;
+	}
+	else if(m_batchOffset + bytes > m_batchBuffer->size())
+	{
+		m_batchBuffer->invalidate();
+		m_batchOffset = 0;
+	}
+	m_batchBuffer->update(std::span<const DrawIndexedIndirectCommand>(m_batch),m_batchOffset);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER,m_batchBuffer->id());
+	glMultiDrawElementsIndirect(mode,type,
+	reinterpret_cast<void*>(static_cast<std::uintptr_t>(m_batchOffset)),
+	static_cast<std::int32_t>(m_batch.size()),
+	0);
+	m_batchOffset += bytes;
+	m_frameStats.multiDrawBatches++;
+	m_frameStats.batchedDraws += static_cast<std::uint32_t>(m_batch.size());
+	m_batch.clear();
+}
 void Renderer::drawIndirectCount(
 	const Buffer& commandBuffer,
 	const Buffer& countBuffer,
@@ -293,8 +620,15 @@ void Renderer::drawIndirectCount(
 	std::uint64_t commandBufferOffset,
 	std::uint64_t countBufferOffset)
 {
+	CallTimer timer(m_frameStats,RendererCall::DRAW_INDIRECT_COUNT);
 	assert(context->isRendering);
+	assert(context->properties.indirectCountDraws && "Indirect count draws are unsupported");
+	// App reported it at startup, release builds skip the draw
+	if(!context->properties.indirectCountDraws) return;
+	flushDraws();
 	
+	m_frameStats.indirectCountDraws++;
+	m_frameStats.indirectCommands += maxDrawCount;
 	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer.id());
 	glBindBuffer(GL_PARAMETER_BUFFER, countBuffer.id());
 	glMultiDrawArraysIndirectCount(enumToGL(context->primitiveMode),
@@ -312,9 +646,13 @@ void Renderer::drawIndexedIndirect(
 	std::uint32_t stride,
 	std::uint64_t commandBufferOffset)
 {
+	CallTimer timer(m_frameStats,RendererCall::DRAW_INDEXED_INDIRECT);
 	assert(context->isRendering);
-	assert(context->isIndexBufferBound);
+	flushDraws();
+	assert(context->isIdxBufferBound);
 
+	m_frameStats.indexedIndirectDraws++;
+	m_frameStats.indirectCommands += drawCount;
 	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer.id());
 	glMultiDrawElementsIndirect(enumToGL(context->primitiveMode),
 	enumToGL(context->idxType),
@@ -330,12 +668,19 @@ void Renderer::drawIndexedIndirectCount(
 	std::uint64_t commandBufferOffset,
 	std::uint64_t countBufferOffset)
 {
+	CallTimer timer(m_frameStats,RendererCall::DRAW_INDEXED_INDIRECT_COUNT);
 	assert(context->isRendering);
-	assert(context->isIndexBufferBound);
+	assert(context->properties.indirectCountDraws && "Indirect count draws are unsupported");
+	// App reported it at startup, release builds skip the draw
+	if(!context->properties.indirectCountDraws) return;
+	flushDraws();
+	assert(context->isIdxBufferBound);
 
+	m_frameStats.indexedIndirectCountDraws++;
+	m_frameStats.indirectCommands += maxDrawCount;
 	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer.id());
 	glBindBuffer(GL_PARAMETER_BUFFER, countBuffer.id());
-	glMultiDrawElementsIndirectCount(enumToGL(context->idxType),
+	glMultiDrawElementsIndirectCount(enumToGL(context->primitiveMode),
 	enumToGL(context->idxType),
 	reinterpret_cast<void*>(static_cast<std::uintptr_t>(commandBufferOffset)),
 	static_cast<std::int32_t>(countBufferOffset),
@@ -350,25 +695,39 @@ void Renderer::clearColor(float r,float g,float b,float a)
 void Renderer::clear(MaskFlags mask)
 {
 	assert(context->isRendering);
+	flushDraws();
 	glClear(static_cast<std::uint32_t>(mask));
 }
+void Renderer::memoryBarrier(MemoryBarrierFlags flags)
+{
+	flushBatchedDraws();
+	glMemoryBarrier(static_cast<std::uint32_t>(flags));
+}
 void Renderer::enableCapability(Cap capability)
 {
-	glEnable(enumToGL(capability));
+	flushDraws();
+	// pipeline state has to be reapplied over it on next bind
+	context->lastPipelineState = nullptr;
+	setCapability(*context,enumToGL(capability),true);
 }
 void Renderer::disableCapability(Cap capability)
 {
-	glDisable(enumToGL(capability));
+	flushDraws();
+	context->lastPipelineState = nullptr;
+	setCapability(*context,enumToGL(capability),false);
 }
 void Renderer::dispatch(const glm::vec3& groupCount)
 {
-	assert(constext->isComputeActive);
+	CallTimer timer(m_frameStats,RendererCall::DISPATCH);
+	assert(context->isComputeActive);
+	m_frameStats.dispatches++;
 	glDispatchCompute(groupCount.x, groupCount.y,groupCount.z);
 }
 void Renderer::dispatchIndirect(const Buffer& cmdBuf,std::uint64_t offset)
 {
+	CallTimer timer(m_frameStats,RendererCall::DISPATCH);
 	assert(context->isComputeActive);
-
+	m_frameStats.indirectDispatches++;
 	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, cmdBuf.id());
 	glDispatchComputeIndirect(offset);
 }
@@ -376,19 +735,26 @@ void Renderer::dispatchIndirect(const Buffer& cmdBuf,std::uint64_t offset)
 void Renderer::beginCompute()
 {
 	assert(!context->isComputeActive);
-	assert(!context->isRendering);
-
+	// compute inside frame suspends rendering until endCompute(), the frame itself goes on
+	if(context->isRendering)
+	{
+		flushDraws();
+		context->isRendering = false;
+		context->isRenderingSuspended = true;
+	}
 	context->isComputeActive = true;
 }
 void Renderer::endCompute()
 {
 	assert(context->isComputeActive);
 	context->isComputeActive = false;
+	context->isRendering = std::exchange(context->isRenderingSuspended,false);
 }
 
 
 void Renderer::setUniform(std::uint8_t size,std::int32_t location,std::size_t count,const std::int32_t* value)
 {
+	flushBatchedDraws();
 	switch(size)
 	{
 		case 1:
@@ -410,6 +776,7 @@ void Renderer::setUniform(std::uint8_t size,std::int32_t location,std::size_t co
 }
 void Renderer::setUniform(std::uint8_t size,std::int32_t location,std::size_t count,const std::uint32_t* value)
 {
+	flushBatchedDraws();
 	switch(size)
 	{
 		case 1:
@@ -431,6 +798,7 @@ void Renderer::setUniform(std::uint8_t size,std::int32_t location,std::size_t co
 }
 void Renderer::setUniform(FloatUniform type,std::int32_t location,std::size_t count,const float* value,bool transpose)
 {
+	flushBatchedDraws();
 	using enum FloatUniform;
 	switch(type)
 	{
@@ -480,11 +848,103 @@ void Renderer::setUniform(FloatUniform type,std::int32_t location,std::size_t co
 }
 void Renderer::blendFunc(Factor src,Factor dst)
 {
-	glBlendFunc(enumToGL(src),enumToGL(dst));
+	blendFuncSeparate(src,dst,src,dst);
 }
 void Renderer::blendFuncSeparate(Factor srcRGB,Factor dstRGB,Factor srcAlpha,Factor dstAlpha)
 {
-	glBlendFuncSeparate(enumToGL(srcRGB),enumToGL(dstRGB),enumToGL(srcAlpha),enumToGL(dstAlpha));
+	flushDraws();
+	context->lastPipelineState = nullptr;
+	setBlendFuncs(*context,BlendFuncs{srcRGB,dstRGB,srcAlpha,dstAlpha});
 }
 
+void Renderer::statsGui() const
+{
+	const auto& st = m_lastFrameStats;
+	ImGui::Begin("Renderer stats");
+	ImGui::Text("frame %llu, fence wait %.3f ms",static_cast<unsigned long long>(m_frameNumber),m_fenceWaitTime / 1e6);
+	if(ImGui::CollapsingHeader("Draws",ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		ImGui::Text("draw %u, indexed %u",st.draws,st.indexedDraws);
+		ImGui::Text("indirect %u, indexed indirect %u",st.indirectDraws,st.indexedIndirectDraws);
+		ImGui::Text("indirect count %u, indexed indirect count %u",st.indirectCountDraws,st.indexedIndirectCountDraws);
+		ImGui::Text("multi draw batches %u(%u draws)",st.multiDrawBatches,st.batchedDraws);
+		ImGui::Text("indirect commands %llu",static_cast<unsigned long long>(st.indirectCommands));
+		ImGui::Text("instances %llu, vertices %llu, indices %llu",
+			static_cast<unsigned long long>(st.instances),
+			static_cast<unsigned long long>(st.vertices),
+			static_cast<unsigned long long>(st.indices));
+		ImGui::Text("dispatches %u, indirect %u",st.dispatches,st.indirectDispatches);
+		ImGui::Text("uploaded buffers %.1f KiB, textures %.1f KiB",st.uploaded.buffers / 1024.0,st.uploaded.textures / 1024.0);
+	}
+	if(ImGui::CollapsingHeader("State calls",ImGuiTreeNodeFlags_DefaultOpen) && ImGui::BeginTable("state calls",3,ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("kind");
+		ImGui::TableSetupColumn("issued");
+		ImGui::TableSetupColumn("elided");
+		ImGui::TableHeadersRow();
+		const auto row = [](const char* kind,std::uint32_t issued,std::uint32_t elided)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::TextUnformatted(kind);
+			ImGui::TableNextColumn(); ImGui::Text("%u",issued);
+			ImGui::TableNextColumn(); ImGui::Text("%u",elided);
+		};
+		const auto& i = st.issued;
+		const auto& e = st.elided;
+		row("programs",i.programs,e.programs);
+		row("pipeline states",i.pipelineStates,e.pipelineStates);
+		row("vertex arrays",i.vertexArrays,e.vertexArrays);
+		row("framebuffers",i.framebuffers,e.framebuffers);
+		row("textures",i.textures,e.textures);
+		row("samplers",i.samplers,e.samplers);
+		row("buffer ranges",i.bufferRanges,e.bufferRanges);
+		row("vertex buffers",i.vertexBuffers,e.vertexBuffers);
+		row("index buffers",i.indexBuffers,e.indexBuffers);
+		row("capabilities",i.capabilities,e.capabilities);
+		row("blend funcs",i.blendFuncs,e.blendFuncs);
+		row("total",i.total(),e.total());
+		ImGui::EndTable();
+	}
+	if(ImGui::CollapsingHeader("GPU memory") && ImGui::BeginTable("gpu memory",4,ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("kind");
+		ImGui::TableSetupColumn("MiB");
+		ImGui::TableSetupColumn("peak MiB");
+		ImGui::TableSetupColumn("objects");
+		ImGui::TableHeadersRow();
+		const auto memory = gpuMemoryStats();
+		const auto row = [](const char* kind,const GPUMemoryCounter& c)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn(); ImGui::TextUnformatted(kind);
+			ImGui::TableNextColumn(); ImGui::Text("%.2f",c.bytes / (1024.0 * 1024.0));
+			ImGui::TableNextColumn(); ImGui::Text("%.2f",c.peakBytes / (1024.0 * 1024.0));
+			ImGui::TableNextColumn(); ImGui::Text("%u(peak %u)",c.objects,c.peakObjects);
+		};
+		for(std::uint32_t r{};r < static_cast<std::uint32_t>(GPUResource::COUNT);r++)
+		{
+			row(resourceName(static_cast<GPUResource>(r)),memory.resources[r]);
+		}
+		row("total",memory.total);
+		ImGui::EndTable();
+	}
+	if(st.callTiming && ImGui::CollapsingHeader("Call times"))
+	{
+		constexpr const char* names[] = {
+			"draw","drawIndexed","drawIndirect","drawIndexedIndirect","drawIndirectCount","drawIndexedIndirectCount",
+			"flushDraws","dispatch","bindPipeline","bindComputePipeline","bindVertexBuffer","bindIndexBuffer",
+			"bindBufferRange","bindTexture","bindFramebuffer"};
+		static_assert(std::size(names) == static_cast<std::size_t>(RendererCall::COUNT));
+		for(std::size_t c{};c < st.callTimes.size();c++)
+		{
+			const auto& h = st.callTimes[c];
+			if(h.calls == 0) continue;
+			float buckets[CALL_TIME_BUCKETS];
+			for(std::uint32_t b{};b < CALL_TIME_BUCKETS;b++) buckets[b] = static_cast<float>(h.buckets[b]);
+			ImGui::Text("%s: %u calls, avg %.0f ns",names[c],h.calls,static_cast<double>(h.totalTime) / h.calls);
+			ImGui::PlotHistogram(names[c],buckets,CALL_TIME_BUCKETS,0,"log2 ns",0.f,FLT_MAX,ImVec2(0,40));
+		}
+	}
+	ImGui::End();
+}
 }
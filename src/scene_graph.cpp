@@ -0,0 +1,154 @@
+#include <BASIS/manager.h>
+#include <BASIS/scene_graph.h>
+
+#include <cmath>
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#define BASIS_SCENE_SSE
+	#include <xmmintrin.h>
+#endif
+
+#include <glm/geometric.hpp>
+
+namespace
+{
+enum DirtyFlags : std::uint8_t
+{
+	LOCAL = 1 << 0,
+	WORLD = 1 << 1,
+};
+// out = a * b, column major
+void multiply(const glm::mat4& a,const glm::mat4& b,glm::mat4& out)
+{
+#ifdef BASIS_SCENE_SSE
+	const float* pa = &a[0][0];
+	const float* pb = &b[0][0];
+	float* po = &out[0][0];
+	const __m128 c0 = _mm_loadu_ps(pa);
+	const __m128 c1 = _mm_loadu_ps(pa + 4);
+	const __m128 c2 = _mm_loadu_ps(pa + 8);
+	const __m128 c3 = _mm_loadu_ps(pa + 12);
+	for(int i{};i < 4;i++)
+	{
+		__m128 r = _mm_mul_ps(c0,_mm_set1_ps(pb[i * 4 + 0]));
+		r = _mm_add_ps(r,_mm_mul_ps(c1,_mm_set1_ps(pb[i * 4 + 1])));
+		r = _mm_add_ps(r,_mm_mul_ps(c2,_mm_set1_ps(pb[i * 4 + 2])));
+		r = _mm_add_ps(r,_mm_mul_ps(c3,_mm_set1_ps(pb[i * 4 + 3])));
+		_mm_storeu_ps(po + i * 4,r);
+	}
+#else
+	out = a * b;
+#endif
+}
+}
+namespace BASIS
+{
+glm::mat4 composeTransform(const glm::vec3& t,const glm::quat& q,const glm::vec3& s)
+{
+	const float xx = q.x * q.x,yy = q.y * q.y,zz = q.z * q.z;
+	const float xy = q.x * q.y,xz = q.x * q.z,yz = q.y * q.z;
+	const float wx = q.w * q.x,wy = q.w * q.y,wz = q.w * q.z;
+	return glm::mat4(
+		glm::vec4(1.f - 2.f * (yy + zz),2.f * (xy + wz),2.f * (xz - wy),0.f) * s.x,
+		glm::vec4(2.f * (xy - wz),1.f - 2.f * (xx + zz),2.f * (yz + wx),0.f) * s.y,
+		glm::vec4(2.f * (xz + wy),2.f * (yz - wx),1.f - 2.f * (xx + yy),0.f) * s.z,
+		glm::vec4(t,1.f));
+}
+void decomposeTransform(const glm::mat4& m,glm::vec3& translation,glm::quat& rotation,glm::vec3& scale)
+{
+	translation = glm::vec3(m[3]);
+	scale = glm::vec3(glm::length(glm::vec3(m[0])),glm::length(glm::vec3(m[1])),glm::length(glm::vec3(m[2])));
+	// mirroring is moved into x scale
+	if(glm::determinant(m) < 0.f) scale.x = -scale.x;
+	glm::mat4 r(1.f);
+	for(int i{};i < 3;i++)
+	{
+		if(scale[i] != 0.f) r[i] = glm::vec4(glm::vec3(m[i]) / scale[i],0.f);
+	}
+	rotation = glm::normalize(glm::quat_cast(r));
+}
+std::uint32_t SceneGraph::addNode(
+	std::int32_t parent,
+	const glm::vec3& translation,
+	const glm::quat& rotation,
+	const glm::vec3& scale,
+	const Node* source)
+{
+	assert(parent < static_cast<std::int32_t>(size()) && "Parent must be added before child");
+	const auto idx = size();
+	m_parents.push_back(parent);
+	m_sources.push_back(source);
+	m_translations.push_back(translation);
+	m_rotations.push_back(rotation);
+	m_scales.push_back(scale);
+	m_localMatrices.emplace_back(1.f);
+	m_worldMatrices.emplace_back(1.f);
+	m_dirty.push_back(LOCAL);
+	m_firstDirty = std::min(m_firstDirty,idx);
+	return idx;
+}
+std::uint32_t SceneGraph::addModel(const GLTFModel& model,std::int32_t parent)
+{
+	const auto first = size();
+	// depth first from every root keeps parents in front of children
+	std::vector<std::pair<std::size_t,std::int32_t>> stack;
+	for(std::size_t i = model.nodes.size();i-- > 0;)
+	{
+		if(model.nodes[i].parent < 0) stack.emplace_back(i,parent);
+	}
+	while(!stack.empty())
+	{
+		const auto [nodeIdx,graphParent] = stack.back();
+		stack.pop_back();
+		const auto& node = model.nodes[nodeIdx];
+		const auto added = static_cast<std::int32_t>(addNode(graphParent,node.translation,node.rotation,node.scale,&node));
+		for(auto it = node.children.rbegin();it != node.children.rend();++it) stack.emplace_back(*it,added);
+	}
+	return first;
+}
+void SceneGraph::markDirty(std::uint32_t node)
+{
+	m_dirty[node] |= LOCAL;
+	m_firstDirty = std::min(m_firstDirty,node);
+}
+void SceneGraph::setTranslation(std::uint32_t node,const glm::vec3& translation)
+{
+	m_translations[node] = translation;
+	markDirty(node);
+}
+void SceneGraph::setRotation(std::uint32_t node,const glm::quat& rotation)
+{
+	m_rotations[node] = rotation;
+	markDirty(node);
+}
+void SceneGraph::setScale(std::uint32_t node,const glm::vec3& scale)
+{
+	m_scales[node] = scale;
+	markDirty(node);
+}
+void SceneGraph::update()
+{
+	const auto count = size();
+	for(std::uint32_t i = m_firstDirty;i < count;i++)
+	{
+		auto flags = m_dirty[i];
+		const auto p = m_parents[i];
+		if(p >= 0 && (m_dirty[p] & WORLD)) flags |= WORLD;
+		if(!flags) continue;
+		if(flags & LOCAL)
+		{
+			m_localMatrices[i] = composeTransform(m_translations[i],m_rotations[i],m_scales[i]);
+			flags |= WORLD;
+		}
+		if(p >= 0) multiply(m_worldMatrices[p],m_localMatrices[i],m_worldMatrices[i]);
+		else m_worldMatrices[i] = m_localMatrices[i];
+		// world bit is kept until the end of the pass so children see it
+		m_dirty[i] = flags;
+	}
+	if(m_firstDirty < count) std::memset(m_dirty.data() + m_firstDirty,0,count - m_firstDirty);
+	m_firstDirty = count;
+}
+}
@@ -0,0 +1,255 @@
+#include <BASIS/manager.h>
+#include <BASIS/scene_graph.h>
+#include <BASIS/thread_pool.h>
+#include <BASIS/software_occlusion.h>
+#include <BASIS/profiler.h>
+
+#include <cmath>
+#include <limits>
+#include <cassert>
+#include <algorithm>
+
+#if defined(__AVX2__)
+	#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#define BASIS_OCCLUSION_SSE
+	#include <xmmintrin.h>
+#endif
+
+#include <glm/vec4.hpp>
+#include <glm/common.hpp>
+
+namespace
+{
+// below this clip w vertex is considered to be at camera plane
+constexpr float minClipW = 1e-5f;
+// items per job of cull()
+constexpr std::size_t itemsPerJob = 256;
+constexpr auto tileWidth = static_cast<std::int32_t>(BASIS::SoftwareOcclusion::TILE_WIDTH);
+constexpr auto tileHeight = static_cast<std::int32_t>(BASIS::SoftwareOcclusion::TILE_HEIGHT);
+}
+namespace BASIS
+{
+SoftwareOcclusion::SoftwareOcclusion(glm::uvec2 resolution) :
+m_tilesX((std::max(resolution.x,1u) + TILE_WIDTH - 1) / TILE_WIDTH),
+m_tilesY((std::max(resolution.y,1u) + TILE_HEIGHT - 1) / TILE_HEIGHT)
+{
+	m_width = m_tilesX * TILE_WIDTH;
+	m_height = m_tilesY * TILE_HEIGHT;
+	m_depth.resize(static_cast<std::size_t>(m_width) * m_height);
+	m_tileMaxDepth.resize(static_cast<std::size_t>(m_tilesX) * m_tilesY);
+	m_bins.resize(m_tileMaxDepth.size());
+	clear();
+}
+void SoftwareOcclusion::clear()
+{
+	std::fill(m_depth.begin(),m_depth.end(),1.f);
+	std::fill(m_tileMaxDepth.begin(),m_tileMaxDepth.end(),1.f);
+	for(auto& bin : m_bins) bin.clear();
+	m_triangles.clear();
+}
+void SoftwareOcclusion::addOccluder(std::span<const glm::vec3> positions,std::span<const std::uint32_t> indices,const glm::mat4& mvp)
+{
+	assert(indices.size() % 3 == 0);
+	const glm::vec2 size(static_cast<float>(m_width),static_cast<float>(m_height));
+	for(std::size_t i{};i + 2 < indices.size();i += 3)
+	{
+		glm::vec3 v[3];
+		bool clipped{};
+		for(int k{};k < 3;k++)
+		{
+			const glm::vec4 clip = mvp * glm::vec4(positions[indices[i + k]],1.f);
+			if(clip.w < minClipW) { clipped = true; break; }
+			const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+			v[k] = glm::vec3((glm::vec2(ndc.x,ndc.y) * 0.5f + 0.5f) * size,ndc.z * 0.5f + 0.5f);
+			// in front of near plane
+			if(v[k].z < 0.f) { clipped = true; break; }
+		}
+		if(clipped) continue;
+
+		float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+		// both windings occlude, make them counter clockwise
+		if(area < 0.f)
+		{
+			std::swap(v[1],v[2]);
+			area = -area;
+		}
+		if(area <= 1e-8f) continue;
+
+		const glm::vec3 lo = glm::min(v[0],glm::min(v[1],v[2]));
+		const glm::vec3 hi = glm::max(v[0],glm::max(v[1],v[2]));
+		if(lo.z > 1.f) continue;
+		Triangle t;
+		t.minX = std::max(static_cast<std::int32_t>(std::floor(lo.x)),0);
+		t.minY = std::max(static_cast<std::int32_t>(std::floor(lo.y)),0);
+		t.maxX = std::min(static_cast<std::int32_t>(std::ceil(hi.x)),static_cast<std::int32_t>(m_width) - 1);
+		t.maxY = std::min(static_cast<std::int32_t>(std::ceil(hi.y)),static_cast<std::int32_t>(m_height) - 1);
+		if(t.minX > t.maxX || t.minY > t.maxY) continue;
+		for(int e{};e < 3;e++)
+		{
+			const auto& a = v[e];
+			const auto& b = v[(e + 1) % 3];
+			t.edgeA[e] = a.y - b.y;
+			t.edgeB[e] = b.x - a.x;
+			t.edgeC[e] = a.x * b.y - a.y * b.x;
+		}
+		const glm::vec3 d1 = v[1] - v[0],d2 = v[2] - v[0];
+		t.zA = (d1.z * d2.y - d2.z * d1.y) / area;
+		t.zB = (d2.z * d1.x - d1.z * d2.x) / area;
+		t.zC = v[0].z - t.zA * v[0].x - t.zB * v[0].y;
+
+		const auto index = static_cast<std::uint32_t>(m_triangles.size());
+		m_triangles.push_back(t);
+		for(auto ty = t.minY / tileHeight;ty <= t.maxY / tileHeight;ty++)
+		{
+			for(auto tx = t.minX / tileWidth;tx <= t.maxX / tileWidth;tx++) m_bins[ty * m_tilesX + tx].push_back(index);
+		}
+	}
+}
+void SoftwareOcclusion::addOccluder(const GLTFModel& model,const Primitive& prim,const glm::mat4& mvp)
+{
+	assert(model.flags & ModelFlagBit::OCCLUDERS);
+	addOccluder(model.occluderPositions,std::span(model.occluderIndices).subspan(prim.firstOccluderIdx,prim.occluderIdxCount),mvp);
+}
+void SoftwareOcclusion::rasterize()
+{
+	BASIS_PROFILE_ZONE("SoftwareOcclusion::rasterize");
+	defaultThreadPool().parallelFor(m_bins.size(),[&](std::size_t tile)
+	{
+		rasterizeTile(static_cast<std::uint32_t>(tile));
+	});
+}
+void SoftwareOcclusion::rasterizeTile(std::uint32_t tile)
+{
+	const auto tileX = static_cast<std::int32_t>(tile % m_tilesX) * tileWidth;
+	const auto tileY = static_cast<std::int32_t>(tile / m_tilesX) * tileHeight;
+	for(auto index : m_bins[tile])
+	{
+		const auto& t = m_triangles[index];
+		// tile x is a multiple of 8, so aligned start never leaves it
+		const std::int32_t x0 = std::max(t.minX,tileX) & ~7;
+		const std::int32_t x1 = std::min(t.maxX + 1,tileX + tileWidth);
+		const std::int32_t y0 = std::max(t.minY,tileY);
+		const std::int32_t y1 = std::min(t.maxY + 1,tileY + tileHeight);
+		for(auto y = y0;y < y1;y++)
+		{
+			const float py = static_cast<float>(y) + 0.5f;
+			float row[3];
+			for(int e{};e < 3;e++) row[e] = t.edgeB[e] * py + t.edgeC[e];
+			const float zRow = t.zB * py + t.zC;
+			float* depth = m_depth.data() + static_cast<std::size_t>(y) * m_width;
+			std::int32_t x = x0;
+#if defined(__AVX2__)
+			const __m256 offsets = _mm256_setr_ps(0.5f,1.5f,2.5f,3.5f,4.5f,5.5f,6.5f,7.5f);
+			for(;x < x1;x += 8)
+			{
+				const __m256 px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)),offsets);
+				__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+				for(int e{};e < 3;e++)
+				{
+					const __m256 ev = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(t.edgeA[e]),px),_mm256_set1_ps(row[e]));
+					inside = _mm256_and_ps(inside,_mm256_cmp_ps(ev,_mm256_setzero_ps(),_CMP_GE_OQ));
+				}
+				const __m256 z = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(t.zA),px),_mm256_set1_ps(zRow));
+				const __m256 old = _mm256_loadu_ps(depth + x);
+				_mm256_storeu_ps(depth + x,_mm256_blendv_ps(old,_mm256_min_ps(old,z),inside));
+			}
+#elif defined(BASIS_OCCLUSION_SSE)
+			const __m128 offsets = _mm_setr_ps(0.5f,1.5f,2.5f,3.5f);
+			for(;x < x1;x += 4)
+			{
+				const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)),offsets);
+				__m128 inside = _mm_cmpeq_ps(px,px);
+				for(int e{};e < 3;e++)
+				{
+					const __m128 ev = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.edgeA[e]),px),_mm_set1_ps(row[e]));
+					inside = _mm_and_ps(inside,_mm_cmpge_ps(ev,_mm_setzero_ps()));
+				}
+				const __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.zA),px),_mm_set1_ps(zRow));
+				const __m128 old = _mm_loadu_ps(depth + x);
+				const __m128 nearer = _mm_min_ps(old,z);
+				_mm_storeu_ps(depth + x,_mm_or_ps(_mm_and_ps(inside,nearer),_mm_andnot_ps(inside,old)));
+			}
+#else
+			for(;x < x1;x++)
+			{
+				const float px = static_cast<float>(x) + 0.5f;
+				bool inside = true;
+				for(int e{};e < 3;e++) inside &= t.edgeA[e] * px + row[e] >= 0.f;
+				if(inside) depth[x] = std::min(depth[x],t.zA * px + zRow);
+			}
+#endif
+		}
+	}
+	float maxDepth{};
+	for(std::int32_t y{};y < tileHeight;y++)
+	{
+		const float* row = m_depth.data() + static_cast<std::size_t>(tileY + y) * m_width + tileX;
+		maxDepth = std::max(maxDepth,*std::max_element(row,row + tileWidth));
+	}
+	m_tileMaxDepth[tile] = maxDepth;
+}
+bool SoftwareOcclusion::isVisible(const glm::vec3& center,const glm::vec3& extent,const glm::mat4& viewProj) const
+{
+	glm::vec2 lo(std::numeric_limits<float>::max()),hi(std::numeric_limits<float>::lowest());
+	float minZ = 1.f;
+	for(int i{};i < 8;i++)
+	{
+		const glm::vec3 corner = center + extent * glm::vec3(i & 1 ? 1.f : -1.f,i & 2 ? 1.f : -1.f,i & 4 ? 1.f : -1.f);
+		const glm::vec4 clip = viewProj * glm::vec4(corner,1.f);
+		// box crosses camera plane, can't be bounded on screen
+		if(clip.w < minClipW) return true;
+		const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		const glm::vec2 screen = (glm::vec2(ndc.x,ndc.y) * 0.5f + 0.5f) * glm::vec2(static_cast<float>(m_width),static_cast<float>(m_height));
+		lo = glm::min(lo,screen);
+		hi = glm::max(hi,screen);
+		minZ = std::min(minZ,ndc.z * 0.5f + 0.5f);
+	}
+	if(minZ < 0.f) return true;
+	// every pixel touched by rect, not only the ones with covered centers
+	const auto x0 = std::max(static_cast<std::int32_t>(std::floor(lo.x)),0);
+	const auto y0 = std::max(static_cast<std::int32_t>(std::floor(lo.y)),0);
+	const auto x1 = std::min(static_cast<std::int32_t>(std::floor(hi.x)),static_cast<std::int32_t>(m_width) - 1);
+	const auto y1 = std::min(static_cast<std::int32_t>(std::floor(hi.y)),static_cast<std::int32_t>(m_height) - 1);
+	if(x0 > x1 || y0 > y1) return false;
+	for(auto ty = y0 / tileHeight;ty <= y1 / tileHeight;ty++)
+	{
+		for(auto tx = x0 / tileWidth;tx <= x1 / tileWidth;tx++)
+		{
+			// whole tile is nearer than box
+			if(minZ > m_tileMaxDepth[ty * m_tilesX + tx]) continue;
+			const auto px0 = std::max(x0,tx * tileWidth);
+			const auto px1 = std::min(x1,(tx + 1) * tileWidth - 1);
+			const auto py0 = std::max(y0,ty * tileHeight);
+			const auto py1 = std::min(y1,(ty + 1) * tileHeight - 1);
+			for(auto y = py0;y <= py1;y++)
+			{
+				const float* row = m_depth.data() + static_cast<std::size_t>(y) * m_width;
+				for(auto x = px0;x <= px1;x++)
+				{
+					if(minZ <= row[x]) return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+void SoftwareOcclusion::cull(const SceneGraph& scene,const glm::mat4& viewProj,std::vector<VisiblePrimitive>& items) const
+{
+	BASIS_PROFILE_ZONE("SoftwareOcclusion::cull");
+	std::vector<std::uint8_t> visible(items.size());
+	defaultThreadPool().parallelFor(items.size(),[&](std::size_t i)
+	{
+		const auto& item = items[i];
+		glm::vec3 center,extent;
+		primitiveWorldBox(scene.world(item.node),scene.source(item.node)->mesh.primitives[item.primitive],center,extent);
+		visible[i] = isVisible(center,extent,viewProj);
+	},itemsPerJob);
+	std::size_t out{};
+	for(std::size_t i{};i < items.size();i++)
+	{
+		if(visible[i]) items[out++] = items[i];
+	}
+	items.resize(out);
+}
+}
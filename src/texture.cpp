@@ -1,9 +1,12 @@
 #include <BASIS/buffer.h>
 #include <BASIS/texture.h>
+#include <BASIS/context.h>
+#include <BASIS/gpu_memory.h>
 #include <BASIS/exception.h>
 
 #include <cstring>
 #include <utility>
+#include <algorithm>
 #include <filesystem>
 
 #include <glad/gl.h>
@@ -112,27 +115,25 @@ Texture::Texture(const TextureCreateInfo& info,std::string_view name) : m_info{i
 	break;
     }
 	glObjectLabel(GL_TEXTURE,m_id,name.size(),name.data());
+	trackGPUObject(GPUResource::TEXTURE,m_id,textureMemorySize(m_info),name);
 }
 Texture::Texture(Texture&& other) noexcept :
 m_info{std::move(other.m_info)},
-m_bindlessHandle{other.m_bindlessHandle}
+m_bindlessHandle{std::exchange(other.m_bindlessHandle,0)}
 {
 	m_id = std::exchange(other.m_id,0);
 }
 Texture& Texture::operator=(Texture&& other) noexcept
 {
 	if(&other == this) return *this;
-	m_info = other.m_info;
-	m_bindlessHandle = std::exchange(m_bindlessHandle,0);
-	m_id = std::exchange(other.m_id,0);
-	return *this;
+	this->~Texture();
+	return *new(this) Texture(std::move(other));
 }
 Sampler& Sampler::operator=(Sampler&& other) noexcept
 {
 	if(&other == this) return *this;
-	m_info = other.m_info;
-	m_id = std::exchange(other.m_id,0);
-	return *this;
+	this->~Sampler();
+	return *new(this) Sampler(std::move(other));
 }
 
 Sampler::Sampler(Sampler&& other) noexcept :
@@ -140,13 +141,17 @@ m_info{std::move(other.m_info)}
 {
 	m_id = std::exchange(other.m_id,0);
 }
-Sampler::Sampler(std::uint32_t id,const SamplerInfo& inf) : m_info{inf}
+Sampler::~Sampler()
 {
-	m_id = id;
+	if(!m_id) return;
+	glDeleteSamplers(1, &m_id);
+	untrackGPUObject(GPUResource::SAMPLER,m_id);
+	notifyObjectDeleted(GLObjectType::SAMPLER,m_id);
 }
-Sampler::Sampler(const SamplerInfo& inf) : m_info{inf}
+Sampler::Sampler(const SamplerInfo& inf,std::string_view name) : m_info{inf}
 {
 	glCreateSamplers(1, &m_id);
+	glObjectLabel(GL_SAMPLER,m_id,name.size(),name.data());
 
     glSamplerParameteri(m_id,GL_TEXTURE_COMPARE_MODE,inf.compareEnable ? GL_COMPARE_REF_TO_TEXTURE : GL_NONE);
     glSamplerParameteri(m_id, GL_TEXTURE_COMPARE_FUNC,enumToGL(inf.compareMode));
@@ -162,10 +167,14 @@ Sampler::Sampler(const SamplerInfo& inf) : m_info{inf}
     glSamplerParameterf(m_id, GL_TEXTURE_LOD_BIAS, inf.lodBias);
     glSamplerParameterf(m_id, GL_TEXTURE_MIN_LOD, inf.minLod);
     glSamplerParameterf(m_id, GL_TEXTURE_MAX_LOD, inf.maxLod);
+	trackGPUObject(GPUResource::SAMPLER,m_id,0,name);
 }
 Texture::~Texture()
 {
+	if(!m_id) return;
 	glDeleteTextures(1, &m_id);
+	untrackGPUObject(GPUResource::TEXTURE,m_id);
+	notifyObjectDeleted(GLObjectType::TEXTURE,m_id);
 }
 static std::uint32_t getBlockCompressedImageSize(
 	Format format, 
@@ -206,6 +215,109 @@ static std::uint32_t getBlockCompressedImageSize(
 		default: return {};
 	}
 }
+// storage size of one texel, drivers may pad 3 component formats
+static std::uint64_t texelSize(Format fmt)
+{
+	using enum Format;
+	switch(fmt)
+	{
+		case R3_G3_B2:
+		case RGBA2: return 1;
+		case RGB4:
+		case RGB5:
+		case RGBA4:
+		case RGB5_A1:
+		case DEPTH_COMPONENT16: return 2;
+		case RGB10:
+		case RGB10_A2:
+		case RGB10_A2UI:
+		case RGB9_E5:
+		case DEPTH_COMPONENT24:
+		case DEPTH_COMPONENT32:
+		case DEPTH_COMPONENT32F:
+		case DEPTH24_STENCIL8: return 4;
+		case RGB12:
+		case RGBA12: return 6;
+		case DEPTH32F_STENCIL8: return 8;
+		default: break;
+	}
+	const std::uint64_t components = formatTo(fmt,BITMASK::SIZE_GL);
+	switch(getFormatType(fmt))
+	{
+		case GL_SHORT:
+		case GL_HALF_FLOAT:
+		case GL_UNSIGNED_SHORT: return components * 2;
+		case GL_INT:
+		case GL_FLOAT:
+		case GL_UNSIGNED_INT: return components * 4;
+		default: return components;
+	}
+}
+std::uint64_t textureMemorySize(const TextureCreateInfo& info)
+{
+	std::uint32_t dimensions = imageTypeTo(info.type,BITMASK::DIMENSIONS);
+	std::uint64_t layers = 1;
+	std::uint64_t samples = 1;
+	switch(info.type)
+	{
+		case ImageType::TAR_1D:
+		case ImageType::TAR_2D:
+		case ImageType::TAR_CUBEMAP:
+		case ImageType::TAR_MSAMPLE_2D:
+			layers = std::max(info.arrayLayers,1u);
+			dimensions--;
+		break;
+		case ImageType::TEX_CUBEMAP:
+			layers = 6;
+			dimensions = 2;
+		break;
+		default: break;
+	}
+	if(info.type == ImageType::TEX_MSAMPLE_2D || info.type == ImageType::TAR_MSAMPLE_2D)
+	{
+		samples = enumToGL(info.samples);
+	}
+	const bool compressed = formatTo(info.fmt,BITMASK::IS_COMPRESSED);
+	std::uint64_t size{};
+	for(std::uint32_t level{};level < std::max(info.mipLevels,1u);level++)
+	{
+		const std::uint32_t width = std::max(info.extent.x >> level,1u);
+		const std::uint32_t height = dimensions > 1 ? std::max(info.extent.y >> level,1u) : 1;
+		const std::uint32_t depth = dimensions > 2 ? std::max(info.extent.z >> level,1u) : 1;
+		size += compressed ?
+			getBlockCompressedImageSize(info.fmt,width,height,depth) :
+			static_cast<std::uint64_t>(width) * height * depth * texelSize(info.fmt);
+	}
+	return size * layers * samples;
+}
+std::uint64_t Texture::memorySize() const noexcept
+{
+	return textureMemorySize(m_info);
+}
+// approximate, row padding isn't counted
+static std::uint64_t uploadSize(const TextureCreateInfo& m_info,const TextureUpdateInfo& info)
+{
+	const std::uint64_t texels = static_cast<std::uint64_t>(std::max(info.extent.x,1)) * std::max(info.extent.y,1) * std::max(info.extent.z,1);
+	if(formatTo(m_info.fmt,BITMASK::IS_COMPRESSED))
+	{
+		return getBlockCompressedImageSize(m_info.fmt,std::max(info.extent.x,1),std::max(info.extent.y,1),std::max(info.extent.z,1));
+	}
+	const std::uint64_t components = formatTo(m_info.fmt,BITMASK::SIZE_GL);
+	const auto type = info.type == UploadType::INFER_TYPE ? getFormatType(m_info.fmt) : enumToGL(info.type);
+	switch(type)
+	{
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE: return texels * components;
+		case GL_SHORT:
+		case GL_HALF_FLOAT:
+		case GL_UNSIGNED_SHORT: return texels * components * 2;
+		case GL_INT:
+		case GL_FLOAT:
+		case GL_UNSIGNED_INT: return texels * components * 4;
+		// packed types hold whole texel
+		default: return texels * 4;
+	}
+}
 static void updateCompressedImageImpl(std::uint32_t m_id,const TextureCreateInfo& m_info,const TextureUpdateInfo& info)
 {
 	const auto format = formatTo(m_info.fmt,BITMASK::FORMAT_GL);
@@ -316,6 +428,8 @@ void copyBufferToTexture(const Buffer& src,Texture& dst,const TextureUpdateInfo&
 }
 void Texture::update(const TextureUpdateInfo& info)
 {
+	flushBatchedDraws();
+	notifyTextureUpload(uploadSize(m_info,info));
 	glBindBuffer(GL_PIXEL_UNPACK_BUFFER,0);
 	if(formatTo(m_info.fmt,BITMASK::IS_COMPRESSED))
 	{
@@ -387,7 +501,7 @@ static ImageType getImageType(ktxTexture2* ktx)
 	return {};
 }
 
-static Texture constructKTX(Format fmt,const std::uint8_t* bytes,std::size_t size,std::string_view file="")
+static DecodedImage decodeKTX(Format fmt,const std::uint8_t* bytes,std::size_t size,std::string_view file="")
 {
 	ktxTexture2* ktx{};
 	KTX_error_code result{};
@@ -400,6 +514,7 @@ static Texture constructKTX(Format fmt,const std::uint8_t* bytes,std::size_t siz
 		result = ktxTexture2_CreateFromNamedFile(file.data(),KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,&ktx);
 	}
 	if(result != KTX_SUCCESS) throw AssetException("Failed to create ktx texture[",ktxErrorString(result),']');
+	std::shared_ptr<void> storage(ktx,[](void* p){ ktxTexture2_Destroy(static_cast<ktxTexture2*>(p)); });
 
 	if(fmt == Format::UNDEFINED)
 	{
@@ -413,36 +528,40 @@ static Texture constructKTX(Format fmt,const std::uint8_t* bytes,std::size_t siz
 		{
 			switch (ktx->vkFormat)
 			{
-				case 131: fmt = Format::COMPRESSED_RGB_S3TC_DXT1_EXT;
-				case 132: fmt = Format::COMPRESSED_SRGB_S3TC_DXT1_EXT;
-				case 133: fmt = Format::COMPRESSED_RGBA_S3TC_DXT1_EXT;
-				case 134: fmt = Format::COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
-				case 135: fmt = Format::COMPRESSED_RGBA_S3TC_DXT3_EXT;
-				case 136: fmt = Format::COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;
-				case 137: fmt = Format::COMPRESSED_RGBA_S3TC_DXT5_EXT;
-				case 138: fmt = Format::COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
-				case 139: fmt = Format::COMPRESSED_RED_RGTC1;
-				case 140: fmt = Format::COMPRESSED_SIGNED_RED_RGTC1;
-				case 141: fmt = Format::COMPRESSED_RG_RGTC2;
-				case 142: fmt = Format::COMPRESSED_SIGNED_RG_RGTC2;
-				case 143: fmt = Format::COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
-				case 144: fmt = Format::COMPRESSED_RGB_BPTC_SIGNED_FLOAT;
-				case 145: fmt = Format::COMPRESSED_RGBA_BPTC_UNORM;
-				case 146: fmt = Format::COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+				case 131: fmt = Format::COMPRESSED_RGB_S3TC_DXT1_EXT; break;
+				case 132: fmt = Format::COMPRESSED_SRGB_S3TC_DXT1_EXT; break;
+				case 133: fmt = Format::COMPRESSED_RGBA_S3TC_DXT1_EXT; break;
+				case 134: fmt = Format::COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT; break;
+				case 135: fmt = Format::COMPRESSED_RGBA_S3TC_DXT3_EXT; break;
+				case 136: fmt = Format::COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT; break;
+				case 137: fmt = Format::COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+				case 138: fmt = Format::COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT; break;
+				case 139: fmt = Format::COMPRESSED_RED_RGTC1; break;
+				case 140: fmt = Format::COMPRESSED_SIGNED_RED_RGTC1; break;
+				case 141: fmt = Format::COMPRESSED_RG_RGTC2; break;
+				case 142: fmt = Format::COMPRESSED_SIGNED_RG_RGTC2; break;
+				case 143: fmt = Format::COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT; break;
+				case 144: fmt = Format::COMPRESSED_RGB_BPTC_SIGNED_FLOAT; break;
+				case 145: fmt = Format::COMPRESSED_RGBA_BPTC_UNORM; break;
+				case 146: fmt = Format::COMPRESSED_SRGB_ALPHA_BPTC_UNORM; break;
 				default:  fmt = Format::UNDEFINED;
 			}
 		}
 	}
 	glm::uvec3 imageExtent = {ktx->baseWidth,ktx->baseHeight,ktx->baseDepth};
-	Texture output = Texture(TextureCreateInfo{
-		.fmt = fmt,
-		.mipLevels = ktx->numLevels,
-		.arrayLayers = ktx->numLayers,
-		.extent = imageExtent,
-		.type = getImageType(ktx),
-		.samples = SampleCount::SAMPLES_1
-	});
-
+	DecodedImage output{
+		.info = {
+			.fmt = fmt,
+			.mipLevels = ktx->numLevels,
+			.arrayLayers = ktx->numLayers,
+			.extent = imageExtent,
+			.type = getImageType(ktx),
+			.samples = SampleCount::SAMPLES_1
+		},
+		.data = ktx->pData,
+		.storage = std::move(storage)
+	};
+	output.regions.reserve(ktx->numLevels * ktx->numFaces);
 	for (std::uint32_t level{}; level < ktx->numLevels; ++level)
 	{
 		std::uint32_t width = std::max(imageExtent.x >> level, 1u);
@@ -454,19 +573,18 @@ static Texture constructKTX(Format fmt,const std::uint8_t* bytes,std::size_t siz
 		{
 			std::size_t offset{};
 			ktxTexture_GetImageOffset(ktxTexture(ktx), level, 0, face, &offset);
-			output.update({
+			output.regions.push_back({
 				.level = level,
-				.offset = {0,0,face},
+				.face = face,
 				.extent = {width,height,depth},
-				.data = ktx->pData + offset
+				.offset = offset
 			});
-
 		}
 	}
 	return output;
 }
 
-static Texture constructSTBI(Format fmt,const unsigned char* bytes,size_t size,std::string_view file="")
+static DecodedImage decodeSTBI(Format fmt,const unsigned char* bytes,size_t size,std::string_view file="")
 {
 	int w{},h{},channels{};
 	auto* px = bytes ? stbi_load_from_memory(bytes,size,&w,&h,&channels,0) : stbi_load(file.data(),&w,&h,&channels,0);
@@ -484,17 +602,23 @@ static Texture constructSTBI(Format fmt,const unsigned char* bytes,size_t size,s
 			case 4: fmt = Format::RGBA8;	break;
 		}
 	}
-
-	auto tex = createTexture2D(glm::uvec2(w,h),fmt);
-	tex.update({
-		.extent = {w,h,1},
+	const glm::uvec3 extent(w,h,1);
+	return DecodedImage{
+		.info = {
+			.fmt = fmt,
+			.mipLevels = 1,
+			.arrayLayers = 1,
+			.extent = extent,
+			.type = ImageType::TEX_2D,
+			.samples = SampleCount::SAMPLES_1
+		},
+		.regions = {{.extent = extent}},
 		.data = px,
-		.type = UploadType::UBYTE,
-	});
-	stbi_image_free(px);
-	return tex;
+		.storage = std::shared_ptr<void>(px,[](void* p){ stbi_image_free(p); }),
+		.uploadType = UploadType::UBYTE
+	};
 }
-Texture loadTexture(std::string_view filePath,Format fmt)
+DecodedImage decodeImage(std::string_view filePath,Format fmt)
 {
 	if(!std::filesystem::exists(filePath)) 
 	{
@@ -507,28 +631,54 @@ Texture loadTexture(std::string_view filePath,Format fmt)
 		case "png"_hash:
 		case "bmp"_hash:
 		case "tga"_hash:
-			return constructSTBI(fmt,nullptr,0,filePath);
+			return decodeSTBI(fmt,nullptr,0,filePath);
 
 		case "ktx"_hash: 
 			throw AssetException("KTX is outdated, please upgrade to KTX2");
 
 		case "ktx2"_hash:
-			return constructKTX(fmt,nullptr,0,filePath);
+			return decodeKTX(fmt,nullptr,0,filePath);
 
 		default : 
 		throw FileException(filePath," unsupported texture format");
 		
 	};	
 }
-
-Texture loadTexture(const std::uint8_t* bytes,std::size_t size,Format fmt)
+DecodedImage decodeImage(const std::uint8_t* bytes,std::size_t size,Format fmt)
 {
 	static constexpr std::uint8_t ktxMagic[12] ={0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
-	if(std::memcmp(ktxMagic,bytes,12) == 0)
+	if(size >= sizeof(ktxMagic) && std::memcmp(ktxMagic,bytes,sizeof(ktxMagic)) == 0)
+	{
+		return decodeKTX(fmt,bytes,size);
+	}
+	return decodeSTBI(fmt,bytes,size);
+}
+DecodedImage decodeImage(const std::byte* bytes,std::size_t size,Format fmt)
+{
+	return decodeImage(reinterpret_cast<const std::uint8_t*>(bytes),size,fmt);
+}
+Texture uploadImage(const DecodedImage& image,std::string_view name)
+{
+	Texture output(image.info,name);
+	for(const auto& region : image.regions)
 	{
-		return constructKTX(fmt,bytes,size);
+		output.update({
+			.level = region.level,
+			.offset = {0,0,region.face},
+			.extent = glm::ivec3(region.extent),
+			.data = image.data + region.offset,
+			.type = image.uploadType
+		});
 	}
-	return constructSTBI(fmt,bytes,size);
+	return output;
+}
+Texture loadTexture(std::string_view filePath,Format fmt)
+{
+	return uploadImage(decodeImage(filePath,fmt));
+}
+Texture loadTexture(const std::uint8_t* bytes,std::size_t size,Format fmt)
+{
+	return uploadImage(decodeImage(bytes,size,fmt));
 }
 Texture loadTexture(const std::byte* bytes,std::size_t size,Format fmt)
 {
@@ -577,6 +727,7 @@ void saveTexture(std::string_view filePath,const Texture& tex,std::int32_t level
 }
 std::uint64_t Texture::makeBindless(const Sampler& sampler) const noexcept
 {
+    assert(GLAD_GL_ARB_bindless_texture && "GL_ARB_bindless_texture is unsupported");
     assert(m_bindlessHandle == 0 && "Bindless handle already present");
     m_bindlessHandle = glGetTextureSamplerHandleARB(m_id, sampler.id());
     assert(m_bindlessHandle != 0 && "Bindless handle creation failed");
@@ -0,0 +1,107 @@
+#include <BASIS/thread_pool.h>
+
+#include <atomic>
+#include <exception>
+#include <algorithm>
+
+namespace BASIS
+{
+ThreadPool::ThreadPool(std::uint32_t threadCount)
+{
+	if(threadCount == 0) threadCount = std::max(std::thread::hardware_concurrency(),1u);
+	m_workers.reserve(threadCount);
+	for(std::uint32_t i{};i < threadCount;i++)
+	{
+		m_workers.emplace_back([this]{ workerLoop(); });
+	}
+}
+ThreadPool::~ThreadPool()
+{
+	{
+		std::scoped_lock lock(m_mutex);
+		m_stop = true;
+	}
+	m_cv.notify_all();
+	for(auto& w : m_workers) w.join();
+}
+void ThreadPool::push(std::function<void()>&& job)
+{
+	{
+		std::scoped_lock lock(m_mutex);
+		m_jobs.push(std::move(job));
+	}
+	m_cv.notify_one();
+}
+void ThreadPool::workerLoop()
+{
+	while(true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock lock(m_mutex);
+			m_cv.wait(lock,[this]{ return m_stop || !m_jobs.empty(); });
+			if(m_stop && m_jobs.empty()) return;
+			job = std::move(m_jobs.front());
+			m_jobs.pop();
+		}
+		job();
+	}
+}
+void ThreadPool::parallelFor(std::size_t count,const std::function<void(std::size_t)>& func,std::size_t grain)
+{
+	if(count == 0) return;
+	grain = std::max<std::size_t>(grain,1);
+	const std::size_t chunks = (count + grain - 1) / grain;
+	if(chunks == 1 || m_workers.empty())
+	{
+		for(std::size_t i{};i < count;i++) func(i);
+		return;
+	}
+	// helpers may outlive this call(if they're picked up late), so state is shared
+	// func is only touched while there are unclaimed chunks, and we wait for all of them
+	struct State
+	{
+		std::atomic<std::size_t> next{};
+		std::atomic<std::size_t> done{};
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::exception_ptr error;
+	};
+	auto state = std::make_shared<State>();
+	auto* fn = &func;
+	auto work = [state,fn,count,grain,chunks]
+	{
+		std::size_t chunk{};
+		while((chunk = state->next.fetch_add(1)) < chunks)
+		{
+			try
+			{
+				const std::size_t end = std::min(count,(chunk + 1) * grain);
+				for(std::size_t i = chunk * grain;i < end;i++) (*fn)(i);
+			}
+			catch(...)
+			{
+				std::scoped_lock lock(state->mutex);
+				if(!state->error) state->error = std::current_exception();
+			}
+			if(state->done.fetch_add(1) + 1 == chunks)
+			{
+				std::scoped_lock lock(state->mutex);
+				state->cv.notify_all();
+			}
+		}
+	};
+	const std::size_t helpers = std::min<std::size_t>(m_workers.size(),chunks - 1);
+	for(std::size_t i{};i < helpers;i++) push(work);
+	work();
+
+	std::unique_lock lock(state->mutex);
+	state->cv.wait(lock,[&]{ return state->done.load() == chunks; });
+	if(state->error) std::rethrow_exception(state->error);
+}
+ThreadPool& defaultThreadPool()
+{
+	static ThreadPool pool;
+	return pool;
+}
+}
@@ -1,8 +1,16 @@
 #include <BASIS/timer.h>
 
+#include <cassert>
 #include <utility>
+#include <algorithm>
 
 #include <glad/gl.h>
+
+namespace
+{
+// gl thread only, shared by all pools so scope ids of released pool never match new one
+std::uint64_t frameTags{};
+}
 CPUTimer::CPUTimer() noexcept
 {
 	m_start = highClock::now();
@@ -41,3 +49,104 @@ std::uint64_t GPUTimer::getTime() const noexcept
     glGetQueryObjectui64v(m_query, GL_QUERY_RESULT, &endTime);
     return endTime - m_start;
 }
+GPUQueryPool::GPUQueryPool(std::uint32_t maxScopes,std::uint32_t latency) :
+m_frames(std::max(latency,1u)),
+m_maxScopes(maxScopes)
+{
+	for(auto& frame : m_frames)
+	{
+		frame.queries.resize(maxScopes * 2);
+		frame.names.resize(maxScopes);
+		frame.depths.resize(maxScopes);
+		glCreateQueries(GL_TIMESTAMP,frame.queries.size(),frame.queries.data());
+	}
+}
+GPUQueryPool::~GPUQueryPool() noexcept
+{
+	release();
+}
+GPUQueryPool& GPUQueryPool::operator=(GPUQueryPool&& other) noexcept
+{
+	if(&other == this) return *this;
+	release();
+	m_frames = std::move(other.m_frames);
+	m_results = std::move(other.m_results);
+	m_maxScopes = other.m_maxScopes;
+	m_frame = other.m_frame;
+	m_depth = other.m_depth;
+	m_inFrame = std::exchange(other.m_inFrame,false);
+	return *this;
+}
+void GPUQueryPool::release() noexcept
+{
+	for(auto& frame : m_frames)
+	{
+		if(!frame.queries.empty()) glDeleteQueries(frame.queries.size(),frame.queries.data());
+		frame.queries.clear();
+	}
+}
+bool GPUQueryPool::beginFrame()
+{
+	assert(!m_inFrame && "GPUQueryPool::beginFrame() called twice");
+	m_inFrame = true;
+	m_depth = 0;
+	auto& frame = m_frames[m_frame];
+	bool resolved{false};
+	if(frame.used > 0)
+	{
+		// nested scopes end out of order, so every end is checked
+		int available{1};
+		for(std::uint32_t i{};i < frame.used && available;i++)
+		{
+			glGetQueryObjectiv(frame.queries[i * 2 + 1],GL_QUERY_RESULT_AVAILABLE,&available);
+		}
+		if(available)
+		{
+			m_results.resize(frame.used);
+			for(std::uint32_t i{};i < frame.used;i++)
+			{
+				std::uint64_t start{},end{};
+				glGetQueryObjectui64v(frame.queries[i * 2],GL_QUERY_RESULT,&start);
+				glGetQueryObjectui64v(frame.queries[i * 2 + 1],GL_QUERY_RESULT,&end);
+				m_results[i] = {.name = frame.names[i],.time = end - start,.start = start,.end = end,.depth = frame.depths[i]};
+			}
+			resolved = true;
+		}
+	}
+	frame.used = 0;
+	frame.frame = ++frameTags;
+	return resolved;
+}
+void GPUQueryPool::endFrame()
+{
+	assert(m_inFrame && "GPUQueryPool::endFrame() without beginFrame()");
+	m_inFrame = false;
+	m_frame = (m_frame + 1) % m_frames.size();
+}
+GPUQueryPool::ScopeId GPUQueryPool::begin(std::string_view name)
+{
+	assert(m_inFrame);
+	auto& frame = m_frames[m_frame];
+	ScopeId id{.idx = m_maxScopes,.slot = m_frame,.frame = frame.frame};
+	if(frame.used == m_maxScopes) return id;
+	id.idx = frame.used++;
+	frame.names[id.idx] = name;
+	frame.depths[id.idx] = m_depth++;
+	glQueryCounter(frame.queries[id.idx * 2],GL_TIMESTAMP);
+	return id;
+}
+void GPUQueryPool::end(const ScopeId& scope)
+{
+	assert(m_inFrame);
+	if(scope.idx >= m_maxScopes || scope.slot >= m_frames.size()) return;
+	auto& frame = m_frames[scope.slot];
+	// slot was reused while scope was open, its begin query belongs to another frame now
+	if(frame.frame != scope.frame || scope.idx >= frame.used) return;
+	glQueryCounter(frame.queries[scope.idx * 2 + 1],GL_TIMESTAMP);
+	if(scope.slot == m_frame) m_depth--;
+}
+std::uint64_t GPUQueryPool::getTime(std::string_view name) const noexcept
+{
+	auto it = std::find_if(m_results.begin(),m_results.end(),[&](const auto& result){ return result.name == name; });
+	return it != m_results.end() ? it->time : 0;
+}
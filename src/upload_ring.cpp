@@ -0,0 +1,65 @@
+#include <BASIS/types.h>
+#include <BASIS/context.h>
+#include <BASIS/rendering.h>
+#include <BASIS/upload_ring.h>
+
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+
+namespace
+{
+std::size_t alignUp(std::size_t value,std::size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+std::size_t uploadAlignment(const BASIS::RenderingContext& context)
+{
+	const auto& limits = context.properties.limits;
+	return static_cast<std::size_t>(std::max({limits.uniformBufferOffsetAlignment,limits.shaderStorageBufferOffsetAlignment,1}));
+}
+}
+namespace BASIS
+{
+UploadRing::UploadRing(const Renderer& renderer,std::size_t frameSize) :
+m_renderer(&renderer),
+m_buffer(
+	alignUp(frameSize,uploadAlignment(*renderer.context)) * MAX_FRAMES_IN_FLIGHT,
+	BufferFlags::WRITE | BufferFlags::PERSISTENT | BufferFlags::COHERENT,
+	"upload ring"),
+m_frameSize(alignUp(frameSize,uploadAlignment(*renderer.context))),
+m_alignment(uploadAlignment(*renderer.context))
+{
+	m_mapped = static_cast<std::byte*>(m_buffer.mapPersistent());
+	assert(m_mapped && "Upload ring mapping failed");
+}
+void UploadRing::beginFrame()
+{
+	const auto& context = *m_renderer->context;
+	// between endFrame() and beginFrame() frameIndex() points to slot gpu may still read
+	assert((context.isRendering || context.isRenderingSuspended) && "UploadRing::beginFrame() outside of Renderer frame");
+	assert(m_frameNumber != m_renderer->frameNumber() && "UploadRing::beginFrame() called twice");
+	m_frameNumber = m_renderer->frameNumber();
+	m_frame = m_renderer->frameIndex();
+	m_offset = 0;
+}
+UploadAllocation UploadRing::allocate(std::size_t size)
+{
+	assert(m_frameNumber == m_renderer->frameNumber() && "UploadRing allocations must follow beginFrame() of current frame");
+	const auto offset = alignUp(m_offset,m_alignment);
+	if(offset + size > m_frameSize)
+	{
+		assert(false && "UploadRing frame overflow, increase frameSize");
+		return {};
+	}
+	m_offset = offset + size;
+	const auto global = m_frame * m_frameSize + offset;
+	return UploadAllocation{.data = m_mapped + global,.offset = global,.size = size};
+}
+UploadAllocation UploadRing::upload(ByteSpan bytes)
+{
+	auto alloc = allocate(bytes.size_bytes());
+	if(alloc.data) std::memcpy(alloc.data,bytes.data(),bytes.size_bytes());
+	return alloc;
+}
+}